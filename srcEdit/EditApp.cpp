@@ -23,6 +23,7 @@
 #include <locale>
 #include <clocale>
 #include <gtksourceview/gtksource.h>
+#include <git2.h>
 
 #include "varsel_config.h"
 #include "EditApp.hpp"
@@ -168,6 +169,7 @@ EditApp::on_startup()
     Gtk::Application::on_startup();
 
     gtk_source_init();
+    git_libgit2_init();     // used for blame
 
     add_action("quit", sigc::mem_fun(*this, &EditApp::on_action_quit));
     add_action("about", sigc::mem_fun(*this, &EditApp::on_action_about));
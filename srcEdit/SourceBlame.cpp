@@ -0,0 +1,269 @@
+/* -*- Mode: c++; c-basic-offset: 4; tab-width: 4; coding: utf-8; -*-  */
+/*
+ * Copyright (C) 2025 RPf
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <psc_i18n.hpp>
+#include <psc_format.hpp>
+
+#include "SourceView.hpp"
+#include "SourceBlame.hpp"
+
+BlameWorker::BlameWorker(const std::string& gitDir, const std::string& path, size_t cursorLine, SourceBlame* sourceBlame)
+: ThreadWorker()
+, m_gitDir{gitDir}
+, m_path{path}
+, m_cursorLine{cursorLine}
+, m_sourceBlame{sourceBlame}
+{
+}
+
+void
+BlameWorker::cancel()
+{
+    m_cancel = true;
+    m_sourceBlame = nullptr;    // as we are called from main thread this is safe
+}
+
+size_t
+BlameWorker::doInBackground()
+{
+    // this is called from thread context, use a own repository
+    psc::git::Repository repository(m_gitDir);
+    size_t lines = repository.getCommittedLines(m_path);
+    if (lines == 0) {
+        return 0;
+    }
+    // blame ranges are 1 based, start with the one that is visible,
+    //   as each blame walks the history, the whole file follows in one go
+    if (lines > CHUNK_LINES) {
+        size_t minLine = std::min(m_cursorLine / CHUNK_LINES * CHUNK_LINES, lines - 1) + 1;
+        size_t maxLine = std::min(minLine + CHUNK_LINES - 1, lines);
+        auto hunks = repository.getBlame(m_path, minLine, maxLine);
+        notify(std::make_shared<std::vector<psc::git::BlameHunk>>(std::move(hunks)));
+    }
+    if (!m_cancel) {
+        auto hunks = repository.getBlame(m_path);
+        notify(std::make_shared<std::vector<psc::git::BlameHunk>>(std::move(hunks)));
+    }
+    return lines;
+}
+
+void
+BlameWorker::process(const std::vector<BlameChunk>& chunks)
+{
+    // here we are back to main thread ...
+    for (auto& chunk : chunks) {
+        if (!m_sourceBlame) {
+            return;
+        }
+        if (m_processed == 0) {
+            m_sourceBlame->addHunks(*chunk);
+        }
+        else {
+            m_sourceBlame->setHunks(*chunk);    // the whole file replaces the range
+        }
+        ++m_processed;
+    }
+}
+
+void
+BlameWorker::done()
+{
+    Glib::ustring msg;
+    size_t lines{0};
+    try {
+        lines = getResult();
+    }
+    catch (const psc::git::GitException& exc) {
+        msg = exc.what();
+    }
+    catch (const std::exception& exc) {
+        msg = exc.what();
+    }
+    if (m_sourceBlame && !m_cancel) {
+        m_sourceBlame->blameDone(lines, msg);
+    }
+}
+
+std::map<std::string, std::vector<psc::git::BlameHunk>> SourceBlame::m_cache;
+
+static void
+blameQueryData(GtkSourceGutterRenderer* renderer
+             , GtkTextIter* start
+             , GtkTextIter* end
+             , GtkSourceGutterRendererState state
+             , gpointer user_data)
+{
+    auto sourceBlame = static_cast<SourceBlame*>(user_data);
+    auto text = sourceBlame->getLineText(gtk_text_iter_get_line(start));
+    gtk_source_gutter_renderer_text_set_text(GTK_SOURCE_GUTTER_RENDERER_TEXT(renderer), text.c_str(), -1);
+}
+
+SourceBlame::SourceBlame(GtkSourceView* sourceView, const Glib::RefPtr<Gio::File>& file, SourceView* sourceWin)
+: m_sourceView{sourceView}
+, m_file{file}
+, m_sourceWin{sourceWin}
+{
+}
+
+SourceBlame::~SourceBlame()
+{
+    hide();
+}
+
+bool
+SourceBlame::show(size_t cursorLine, Glib::ustring& errMsg)
+{
+    auto path = m_file->get_path();
+    auto repository = psc::git::RepositoryCache::get(Glib::path_get_dirname(path));
+    if (!repository) {
+        errMsg = psc::fmt::vformat(_("The file {} is not in a repository"),
+                                   psc::fmt::make_format_args(path));
+        return false;
+    }
+    std::string relPath;
+    std::string gitDir;
+    try {
+        gitDir = repository->getGitDir();
+        auto workdir = repository->getWorkdir();
+        if (!path.starts_with(workdir)) {
+            errMsg = psc::fmt::vformat(_("The file {} is not in the working tree"),
+                                       psc::fmt::make_format_args(path));
+            return false;
+        }
+        relPath = path.substr(workdir.length());
+        // the blame is of HEAD:path so the workdir content is irrelevant
+        m_cacheKey = relPath + "\n" + repository->getHeadId() + "\n" + repository->getCommittedId(relPath);
+    }
+    catch (const psc::git::GitException& ex) {
+        errMsg = ex.what();
+        return false;
+    }
+    if (!m_renderer) {
+        m_renderer = gtk_source_gutter_renderer_text_new();
+        g_signal_connect(m_renderer, "query-data", G_CALLBACK(blameQueryData), this);
+        // the text renderer does not size itself
+        gint width{0};
+        gtk_source_gutter_renderer_text_measure(GTK_SOURCE_GUTTER_RENDERER_TEXT(m_renderer)
+                                               , "01234567 2000-01-01 MMMMMMMMMMMM", &width, nullptr);
+        gtk_source_gutter_renderer_set_size(m_renderer, width);
+        auto gutter = gtk_source_view_get_gutter(m_sourceView, GTK_TEXT_WINDOW_LEFT);
+        gtk_source_gutter_insert(gutter, m_renderer, -10);    // before line numbers
+    }
+    stopWorker();
+    auto cached = m_cache.find(m_cacheKey);
+    if (cached != m_cache.end()) {
+        setHunks(cached->second);
+        return true;
+    }
+    setHunks(std::vector<psc::git::BlameHunk>());
+    m_blameWorker = std::make_shared<BlameWorker>(gitDir, relPath, cursorLine, this);
+    m_blameWorker->execute();
+    return true;
+}
+
+void
+SourceBlame::stopWorker()
+{
+    if (m_blameWorker) {
+        m_blameWorker->cancel();
+        m_blameWorker.reset();
+    }
+}
+
+void
+SourceBlame::hide()
+{
+    stopWorker();
+    if (m_renderer) {
+        auto gutter = gtk_source_view_get_gutter(m_sourceView, GTK_TEXT_WINDOW_LEFT);
+        gtk_source_gutter_remove(gutter, m_renderer);  // releases renderer
+        m_renderer = nullptr;
+    }
+    m_hunks.clear();
+    m_lineHunk.clear();
+}
+
+bool
+SourceBlame::isVisible()
+{
+    return m_renderer != nullptr;
+}
+
+void
+SourceBlame::setHunks(const std::vector<psc::git::BlameHunk>& hunks)
+{
+    m_hunks.clear();
+    m_lineHunk.clear();
+    addHunks(hunks);
+    if (m_hunks.empty()) {
+        gtk_widget_queue_draw(GTK_WIDGET(m_sourceView));
+    }
+}
+
+void
+SourceBlame::addHunks(const std::vector<psc::git::BlameHunk>& hunks)
+{
+    for (auto& hunk : hunks) {
+        m_hunks.push_back(hunk);
+        auto idx = static_cast<uint32_t>(m_hunks.size());
+        size_t end = hunk.startLine - 1 + hunk.lines;
+        if (m_lineHunk.size() < end) {
+            m_lineHunk.resize(end, 0u);
+        }
+        for (size_t line = hunk.startLine - 1; line < end; ++line) {
+            m_lineHunk[line] = idx;
+        }
+    }
+    // make the new range visible
+    gtk_widget_queue_draw(GTK_WIDGET(m_sourceView));
+}
+
+void
+SourceBlame::blameDone(size_t lines, const Glib::ustring& errMsg)
+{
+    m_blameWorker.reset();
+    if (!errMsg.empty()) {
+        m_sourceWin->showMessage(psc::fmt::vformat(_("Error {} blame {}"),
+                                 psc::fmt::make_format_args(errMsg, m_file->get_path())));
+        return;
+    }
+    if (m_cache.size() >= CACHE_SIZE) {
+        m_cache.erase(m_cache.begin());
+    }
+    m_cache.insert_or_assign(m_cacheKey, m_hunks);
+}
+
+Glib::ustring
+SourceBlame::getLineText(int line)
+{
+    if (line < 0
+     || static_cast<size_t>(line) >= m_lineHunk.size()
+     || m_lineHunk[line] == 0u) {
+        return Glib::ustring();
+    }
+    auto& hunk = m_hunks[m_lineHunk[line] - 1];
+    char id[9];
+    git_oid_tostr(id, sizeof(id), &hunk.commit);
+    auto dateTime = Glib::DateTime::create_now_local(hunk.time);
+    Glib::ustring author{hunk.author};
+    if (author.length() > AUTHOR_LENGTH) {
+        author = author.substr(0, AUTHOR_LENGTH);
+    }
+    return Glib::ustring::sprintf("%s %s %-12s", id, dateTime.format("%F"), author);
+}
@@ -0,0 +1,103 @@
+/* -*- Mode: c++; c-basic-offset: 4; tab-width: 4; coding: utf-8; -*-  */
+/*
+ * Copyright (C) 2025 RPf
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gtksourceview/gtksource.h>
+#include <gtkmm.h>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "GitRepository.hpp"
+#include "ThreadWorker.hpp"
+
+class SourceBlame;
+class SourceView;
+
+using BlameChunk = std::shared_ptr<std::vector<psc::git::BlameHunk>>;
+
+/**
+ * blame a file in background,
+ *   libgit2 does not report progress, so the range containing
+ *   the cursor is blamed and shown first, then the whole file
+ *   (each blame walks the history, so not more than two).
+ */
+class BlameWorker
+: public ThreadWorker<BlameChunk, size_t>
+{
+public:
+    BlameWorker(const std::string& gitDir, const std::string& path, size_t cursorLine, SourceBlame* sourceBlame);
+    explicit BlameWorker(const BlameWorker& orig) = delete;
+    virtual ~BlameWorker() = default;
+
+    void cancel();
+    static constexpr size_t CHUNK_LINES{256u};
+protected:
+    size_t doInBackground() override;
+    void process(const std::vector<BlameChunk>& chunks) override;
+    void done() override;
+
+private:
+    std::string m_gitDir;
+    std::string m_path;
+    size_t m_cursorLine;
+    SourceBlame* m_sourceBlame;
+    std::atomic<bool> m_cancel{false};
+    size_t m_processed{0};  // main thread only
+};
+
+/**
+ * show who changed a line last in the gutter of a source view,
+ *   as blame is costly the results are kept by path and HEAD.
+ *   The blame is for the committed version, uncommitted changes
+ *   will shift the lines.
+ */
+class SourceBlame
+{
+public:
+    SourceBlame(GtkSourceView* sourceView, const Glib::RefPtr<Gio::File>& file, SourceView* sourceWin);
+    explicit SourceBlame(const SourceBlame& orig) = delete;
+    virtual ~SourceBlame();
+
+    // cursorLine 0 based as the buffer counts, returns false for files not in a repository
+    bool show(size_t cursorLine, Glib::ustring& errMsg);
+    void hide();
+    bool isVisible();
+    void addHunks(const std::vector<psc::git::BlameHunk>& hunks);
+    void setHunks(const std::vector<psc::git::BlameHunk>& hunks);
+    void blameDone(size_t lines, const Glib::ustring& errMsg);
+    Glib::ustring getLineText(int line);
+
+    static constexpr size_t AUTHOR_LENGTH{12u};
+    static constexpr size_t CACHE_SIZE{32u};
+protected:
+    void stopWorker();
+
+private:
+    GtkSourceView* m_sourceView;
+    Glib::RefPtr<Gio::File> m_file;
+    SourceView* m_sourceWin;
+    GtkSourceGutterRenderer* m_renderer{nullptr};
+    std::vector<psc::git::BlameHunk> m_hunks;
+    std::vector<uint32_t> m_lineHunk;   // index into hunks + 1, 0 not known yet
+    std::shared_ptr<BlameWorker> m_blameWorker;
+    std::string m_cacheKey;
+    static std::map<std::string, std::vector<psc::git::BlameHunk>> m_cache;
+};
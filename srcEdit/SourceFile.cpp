@@ -270,6 +270,27 @@ SourceFile::getWidget()
     return m_scrollView;
 }
 
+void
+SourceFile::toggleBlame()
+{
+    if (m_blame && m_blame->isVisible()) {
+        m_blame->hide();
+        return;
+    }
+    auto file = m_eventItem ? getFile() : Glib::RefPtr<Gio::File>();
+    if (!file) {
+        m_sourceWin->showMessage(_("Blame requires a saved file"));
+        return;
+    }
+    if (!m_blame) {
+        m_blame = std::make_shared<SourceBlame>(m_sourceView, file, m_sourceWin);
+    }
+    Glib::ustring errMsg;
+    if (!m_blame->show(getPosition().getStartLine(), errMsg)) {
+        m_sourceWin->showMessage(errMsg);
+    }
+}
+
 Glib::ustring
 SourceFile::getLanguage()
 {
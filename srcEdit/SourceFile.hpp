@@ -23,6 +23,7 @@
 #include <memory>
 
 #include "EventBus.hpp"
+#include "SourceBlame.hpp"
 
 
 class SourceView;
@@ -48,6 +49,8 @@ public:
     Glib::ustring getText();
     void show(const LspLocation& pos);
     Gtk::Widget* getWidget();
+    // show/hide who changed the lines last
+    void toggleBlame();
 
     static constexpr size_t BUF_SIZE{8u*1024u};
 
@@ -65,6 +68,7 @@ private:
     Glib::RefPtr<Gtk::CssProvider> m_provider;
     Glib::ustring m_language;
     Gtk::ScrolledWindow* m_scrollView{nullptr};
+    std::shared_ptr<SourceBlame> m_blame;
 };
 
 using PtrSourceFile = std::shared_ptr<SourceFile>;
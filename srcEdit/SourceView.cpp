@@ -202,6 +202,8 @@ SourceView::createActions()
     m_loadAction->signal_activate().connect(sigc::mem_fun(*this, &SourceView::load));
     m_closeAction = add_action("close");
     m_closeAction->signal_activate().connect(sigc::mem_fun(*this, &SourceView::close));
+    m_blameAction = add_action("blame");
+    m_blameAction->signal_activate().connect(sigc::mem_fun(*this, &SourceView::blame));
     //auto quitAction = Gio::SimpleAction::create(QUIT_ACTION);
     //refActionGroup->add_action(quitAction);
     //quitAction->signal_activate().connect(sigc::mem_fun(*this, &SourceView::quit));
@@ -234,6 +236,7 @@ SourceView::updateActions()
     m_saveAsAction->property_enabled().set_value(hasCurrentView);
     m_loadAction->property_enabled().set_value(hasCurrentView);
     m_closeAction->property_enabled().set_value(hasCurrentView);
+    m_blameAction->property_enabled().set_value(hasCurrentView);
 }
 
 
@@ -319,6 +322,15 @@ SourceView::close(const Glib::VariantBase& val)
     updateActions();
 }
 
+void
+SourceView::blame(const Glib::VariantBase& val)
+{
+    // validated by action
+    int page = m_notebook->get_current_page();
+    auto srcFile = m_files[page];
+    srcFile->toggleBlame();
+}
+
 void
 SourceView::on_hide()
 {
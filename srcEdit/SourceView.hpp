@@ -74,6 +74,7 @@ public:
     void saveAs(const Glib::VariantBase& val);
     void load(const Glib::VariantBase& val);
     void close(const Glib::VariantBase& val);
+    void blame(const Glib::VariantBase& val);
     void quit(const Glib::VariantBase& val);
     int showMessage(const Glib::ustring& msg, Gtk::MessageType msgType = Gtk::MessageType::MESSAGE_WARNING);
     void changeLabel(SourceFile* sourceFile);
@@ -102,6 +103,7 @@ protected:
     Glib::RefPtr<Gio::SimpleAction> m_saveAsAction;
     Glib::RefPtr<Gio::SimpleAction> m_loadAction;
     Glib::RefPtr<Gio::SimpleAction> m_closeAction;
+    Glib::RefPtr<Gio::SimpleAction> m_blameAction;
 private:
     EditApp* m_application;
     Gtk::Notebook* m_notebook{nullptr};
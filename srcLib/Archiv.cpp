@@ -18,9 +18,13 @@
 
 #include <fcntl.h>
 #include <iostream>
+#include <set>
+#include <array>
+#include <algorithm>
 #include <psc_format.hpp>
 
 #include "Archiv.hpp"
+#include "ArchivSnapshot.hpp"
 
 ArchivEntry::ArchivEntry()
 {
@@ -98,6 +102,14 @@ ArchivEntry::getModeName()
     return stype;
 }
 
+void
+ArchivEntry::dataRead()
+{
+    if (m_readProgress) {
+        m_readProgress->report();
+    }
+}
+
 int
 ArchivEntry::handleContent(struct archive* archiv)
 {
@@ -112,6 +124,7 @@ ArchivEntry::handleContent(struct archive* archiv)
         do {
             ret = archive_read_data_block(archiv, &buff, &len, &offset);
             m_size += len;
+            dataRead();
         } while (ret == ARCHIVE_OK);
         if (ret == ARCHIVE_EOF) {  // end of entry as it seems
             ret = ARCHIVE_OK;
@@ -141,6 +154,50 @@ ArchivException::what() const noexcept
     return m_msg.c_str();
 }
 
+double
+ArchivProgress::getFraction() const
+{
+    if (m_total <= 0) {
+        return -1.0;
+    }
+    return std::min(static_cast<double>(m_consumed) / static_cast<double>(m_total), 1.0);
+}
+
+double
+ArchivProgress::getThroughput() const
+{
+    if (m_elapsedUs <= 0) {
+        return 0.0;
+    }
+    return static_cast<double>(m_consumed) * 1.0e6 / static_cast<double>(m_elapsedUs);
+}
+
+double
+ArchivProgress::getEta() const
+{
+    auto throughput = getThroughput();
+    if (m_total <= 0
+     || throughput <= 0.0) {
+        return -1.0;
+    }
+    return std::max(static_cast<double>(m_total - m_consumed), 0.0) / throughput;
+}
+
+Glib::ustring
+ArchivProgress::format() const
+{
+    Glib::ustring consumed = Glib::format_size(static_cast<guint64>(m_consumed));
+    Glib::ustring throughput = Glib::format_size(static_cast<guint64>(getThroughput()));
+    auto eta = getEta();
+    if (eta < 0.0) {
+        return psc::fmt::vformat(_("{} read, {}/s"), psc::fmt::make_format_args(consumed, throughput));
+    }
+    Glib::ustring total = Glib::format_size(static_cast<guint64>(m_total));
+    auto seconds = static_cast<int>(eta + 0.5);
+    Glib::ustring remain = Glib::ustring::sprintf("%d:%02d", seconds / 60, seconds % 60);
+    return psc::fmt::vformat(_("{} of {}, {}/s, {} left"), psc::fmt::make_format_args(consumed, total, throughput, remain));
+}
+
 static int
 c_read_open(struct archive *a, void *client_data)
 {
@@ -197,6 +254,41 @@ c_write_free(struct archive *a, void *client_data)
     return archivpp->cc_writefree(a);
 }
 
+static la_ssize_t
+c_nested_read(struct archive *a, void *client_data, const void **buff)
+{
+    auto nestedSource = reinterpret_cast<ArchivNestedSource*>(client_data);
+    return nestedSource->cc_read(a, buff);
+}
+
+static struct archive*
+readNew()
+{
+    struct archive* archiv = archive_read_new();
+    archive_read_support_filter_all(archiv);
+    archive_read_support_format_all(archiv);
+    return archiv;
+}
+
+ArchivNestedSource::ArchivNestedSource(struct archive* outer)
+: m_outer{outer}
+, m_buff(Archiv::BUF_SIZE)
+{
+}
+
+la_ssize_t
+ArchivNestedSource::cc_read(struct archive *archiv, const void **ebuff)
+{
+    *ebuff = m_buff.data();
+    la_ssize_t len = archive_read_data(m_outer, m_buff.data(), m_buff.size());
+    if (len < 0) {
+        auto outerErr = archive_error_string(m_outer);
+        archive_set_error(archiv, ARCHIVE_FATAL, "%s", outerErr ? outerErr : _("Error reading outer archiv"));
+        return ARCHIVE_FATAL;
+    }
+    return len;
+}
+
 Archiv::Archiv(Glib::RefPtr<Gio::File> file)
 : m_file{file}
 {
@@ -204,31 +296,166 @@ Archiv::Archiv(Glib::RefPtr<Gio::File> file)
 
 Archiv::~Archiv()
 {
+    closeNested();
     cc_readclose(); // just in case this was left out
     cc_writeclose(nullptr);
 }
 
+std::shared_ptr<Archiv>
+Archiv::create(const Glib::RefPtr<Gio::File>& file)
+{
+    if (ArchivSnapshot::isSnapshot(file)) {
+        return std::make_shared<ArchivSnapshot>(file);
+    }
+    return std::make_shared<Archiv>(file);
+}
+
+void
+Archiv::setNested(const std::vector<Glib::ustring>& nested)
+{
+    m_nested = nested;
+}
+
+bool
+Archiv::isArchivName(const Glib::ustring& name)
+{
+    static const std::vector<const char*> archivExtensions{
+          ".tar", ".tgz", ".tar.gz", ".tbz2", ".tar.bz2", ".txz", ".tar.xz"
+        , ".tar.zst", ".tar.lz", ".zip", ".jar", ".war", ".ear", ".apk"
+        , ".7z", ".cpio", ".iso", ".rpm", ".deb", ".cab", ".rar"};
+    std::string lower = name.lowercase();
+    for (auto ext : archivExtensions) {
+        if (lower.ends_with(ext)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// position the archive at the content of the named member
+int
+Archiv::seekMember(struct archive* archiv, const Glib::ustring& member)
+{
+    struct archive_entry *entry;
+    int ret;
+    while ((ret = archive_read_next_header(archiv, &entry)) == ARCHIVE_OK) {
+        auto path = archive_entry_pathname_utf8(entry);
+        if (path && member == path) {
+            return ARCHIVE_OK;
+        }
+    }
+    if (ret == ARCHIVE_EOF) {
+        archive_set_error(archiv, ARCHIVE_FATAL, "%s", psc::fmt::vformat(_("Nested archiv {} not found"), psc::fmt::make_format_args(member)).c_str());
+        ret = ARCHIVE_FATAL;
+    }
+    return ret;
+}
+
+// open the given archive on the file or if nested on the member of the enclosing archives
+int
+Archiv::openRead(struct archive* archiv)
+{
+    if (m_nested.empty()) {
+        return archive_read_open2(archiv, reinterpret_cast<void*>(this), c_read_open, c_read, c_read_skip, c_read_close);
+    }
+    struct archive* outer = readNew();
+    m_outer.push_back(outer);
+    int ret = archive_read_open2(outer, reinterpret_cast<void*>(this), c_read_open, c_read, c_read_skip, c_read_close);
+    for (size_t i = 0; i < m_nested.size() && ret == ARCHIVE_OK; ++i) {
+        ret = seekMember(outer, m_nested[i]);
+        if (ret == ARCHIVE_OK) {
+            // the innermost is the one we were asked for
+            struct archive* inner = i + 1 < m_nested.size() ? readNew() : archiv;
+            if (inner != archiv) {
+                m_outer.push_back(inner);
+            }
+            auto nestedSource = std::make_unique<ArchivNestedSource>(outer);
+            ret = archive_read_open2(inner, reinterpret_cast<void*>(nestedSource.get()), nullptr, c_nested_read, nullptr, nullptr);
+            m_nestedSources.emplace_back(std::move(nestedSource));
+            outer = inner;
+        }
+    }
+    if (ret != ARCHIVE_OK
+     && outer != archiv) {    // pass the cause to the archive that gets reported
+        auto outerErr = archive_error_string(outer);
+        archive_set_error(archiv, ARCHIVE_FATAL, "%s", outerErr ? outerErr : _("Error opening nested archiv"));
+    }
+    return ret;
+}
+
+void
+Archiv::closeNested()
+{
+    // free inner before outer as the inner are reading from the outer
+    for (auto iter = m_outer.rbegin(); iter != m_outer.rend(); ++iter) {
+        archive_read_free(*iter);
+    }
+    m_outer.clear();
+    m_nestedSources.clear();
+}
+
+ArchivReadProgress::ArchivReadProgress(struct archive* fileArchiv, goffset total, ArchivListener* listener)
+: m_fileArchiv{fileArchiv}
+, m_total{total}
+, m_listener{listener}
+, m_start{g_get_monotonic_time()}
+, m_lastProgress{m_start}
+{
+}
+
+void
+ArchivReadProgress::report(bool force)
+{
+    auto now = g_get_monotonic_time();
+    if (force
+     || now - m_lastProgress >= Archiv::PROGRESS_INTERVAL_US) {
+        // -1 the bytes read from the file (before any decompression)
+        m_listener->archivProgress(ArchivProgress(archive_filter_bytes(m_fileArchiv, -1), m_total, now - m_start));
+        m_lastProgress = now;
+    }
+}
+
+goffset
+Archiv::getReadSize()
+{
+    try {
+        auto info = m_file->query_info(G_FILE_ATTRIBUTE_STANDARD_SIZE);
+        return info->get_size();
+    }
+    catch (const Glib::Error& err) {    // progress will be unknown
+        std::cout << "Archiv::getReadSize " << err.what() << std::endl;
+    }
+    return 0;
+}
+
 void
 Archiv::read(ArchivListener* listener)
 {
-    struct archive* archiv = archive_read_new();
-    archive_read_support_filter_all(archiv);
-    archive_read_support_format_all(archiv);
+    struct archive* archiv = readNew();
     Glib::ustring msg;
     ArchivSummary summary;
-    int ret = archive_read_open2(archiv, reinterpret_cast<void*>(this), c_read_open, c_read, c_read_skip, c_read_close);
+    int ret = openRead(archiv);
     if (ret == ARCHIVE_OK) {
+        // for nested the outermost reads the file
+        struct archive* fileArchiv = m_outer.empty() ? archiv : m_outer.front();
+        ArchivReadProgress readProgress(fileArchiv, getReadSize(), listener);
         struct archive_entry *entry;
         while ((ret = archive_read_next_header(archiv, &entry)) == ARCHIVE_OK) {
             // entry exists as internal structure it doesn't change so no need to free as it seems
             auto archivEntry = listener->createEntry(entry);
             listener->archivUpdate(archivEntry);
+            archivEntry->setReadProgress(&readProgress);
             int ret = archivEntry->handleContent(archiv);
+            archivEntry->setReadProgress(nullptr);     // the entry may be kept
             if (ret != ARCHIVE_OK) {
                 auto archErr = archive_error_string(archiv);
                 msg = archErr ? std::string(archErr) : psc::fmt::vformat(_("Archiv error {}"), psc::fmt::make_format_args(ret));
                 break;
             }
+            readProgress.report();
+        }
+        if (ret == ARCHIVE_EOF) {
+            readProgress.report(true);
         }
         if (ret != ARCHIVE_EOF) {
             auto archErr = archive_error_string(archiv);
@@ -262,6 +489,7 @@ Archiv::read(ArchivListener* listener)
     if (archiv) {
         archive_read_free(archiv);
     }
+    closeNested();
     if (!msg.empty()) { // keep processing do this as last step so we free c-side
         throw ArchivException(msg);
     }
@@ -289,45 +517,76 @@ Archiv::setFormat(struct archive* archiv)
     }
 }
 
-void
-Archiv::write(ArchivProvider* provider)
+bool
+Archiv::isChanged(const std::shared_ptr<ArchivEntry>& srcEntry, const ArchivIndex& index)
+{
+    auto archived = index.find(srcEntry->getPath());
+    if (archived == index.end()) {
+        return true;
+    }
+    return srcEntry->getModified() == 0
+        || srcEntry->getModified() > archived->second.modified
+        || srcEntry->getSize() != archived->second.size;
+}
+
+Glib::ustring
+Archiv::writeEntries(struct archive* archiv, ArchivProvider* provider, const ArchivIndex& index)
 {
-    struct archive* archiv = archive_write_new();
-    setFormat(archiv);
-    int ret = archive_write_open2(archiv, reinterpret_cast<void*>(this), c_write_open, c_write, c_write_close, c_write_free);
     Glib::ustring msg;
-    if (ret == ARCHIVE_OK) {
-        while (true) {
-            auto srcEntry = provider->getNextEntry();
-            if (!srcEntry) {
-                break;
-            }
-            //std::cout << "Archiv::write filename " << srcEntry->getPath() << std::endl;
-            struct archive_entry *entry{nullptr};
-            if (srcEntry->getMode() == AE_IFDIR) {
-                entry = archive_entry_new();
-                archive_entry_set_pathname_utf8(entry, srcEntry->getPath().c_str());
-                archive_entry_set_filetype(entry, srcEntry->getMode());
-                archive_entry_set_perm(entry, srcEntry->getPermission());
+    while (true) {
+        auto srcEntry = provider->getNextEntry();
+        if (!srcEntry) {
+            break;
+        }
+        if (!index.empty()
+         && !isChanged(srcEntry, index)) {
+            continue;
+        }
+        //std::cout << "Archiv::write filename " << srcEntry->getPath() << std::endl;
+        struct archive_entry *entry{nullptr};
+        if (srcEntry->getMode() == AE_IFDIR) {
+            entry = archive_entry_new();
+            archive_entry_set_pathname_utf8(entry, srcEntry->getPath().c_str());
+            archive_entry_set_filetype(entry, srcEntry->getMode());
+            archive_entry_set_perm(entry, srcEntry->getPermission());
+        }
+        else if (srcEntry->getMode() == AE_IFREG) {
+            entry = archive_entry_new();
+            archive_entry_set_pathname_utf8(entry, srcEntry->getPath().c_str());
+            archive_entry_set_filetype(entry, srcEntry->getMode());
+            archive_entry_set_size(entry, srcEntry->getSize());
+            archive_entry_set_perm(entry, srcEntry->getPermission());
+            if (srcEntry->getModified() > 0) {
+                archive_entry_set_mtime(entry, srcEntry->getModified(), 0);
             }
-            else if (srcEntry->getMode() == AE_IFREG) {
-                entry = archive_entry_new();
-                archive_entry_set_pathname_utf8(entry, srcEntry->getPath().c_str());
-                archive_entry_set_filetype(entry, srcEntry->getMode());
-                archive_entry_set_size(entry, srcEntry->getSize());
-                archive_entry_set_perm(entry, srcEntry->getPermission());
-                archive_write_header(archiv, entry);
+            int ret = archive_write_header(archiv, entry);
+            if (ret >= ARCHIVE_WARN) {     // e.g. a attribute that is not supported by the format
                 ret = provider->writeContent(this, archiv, entry);
-                if (ret != ARCHIVE_OK) {
-                    auto archErr = archive_error_string(archiv);
-                    msg = archErr ? std::string(archErr) : psc::fmt::vformat(_("Archiv error {}"), psc::fmt::make_format_args(ret));
-                    break;
-                }
             }
-            if (entry) {
+            if (ret != ARCHIVE_OK) {
+                auto archErr = archive_error_string(archiv);
+                msg = archErr ? std::string(archErr) : psc::fmt::vformat(_("Archiv error {}"), psc::fmt::make_format_args(ret));
                 archive_entry_free(entry);
+                break;
             }
         }
+        if (entry) {
+            archive_entry_free(entry);
+        }
+    }
+    return msg;
+}
+
+void
+Archiv::write(ArchivProvider* provider)
+{
+    struct archive* archiv = archive_write_new();
+    setFormat(archiv);
+    int ret = archive_write_open2(archiv, reinterpret_cast<void*>(this), c_write_open, c_write, c_write_close, c_write_free);
+    Glib::ustring msg;
+    if (ret == ARCHIVE_OK) {
+        ArchivIndex index;  // empty -> write all
+        msg = writeEntries(archiv, provider, index);
         archive_write_close(archiv);
     }
     else {
@@ -343,15 +602,297 @@ Archiv::write(ArchivProvider* provider)
     return;
 }
 
+void
+Archiv::update(ArchivProvider* provider)
+{
+    if (!m_nested.empty()) {
+        throw ArchivException(_("Update of nested archiv is not supported"));
+    }
+    ArchivIndex index;
+    Glib::ustring msg;
+    int format{0};
+    bool compressed{false};
+    la_int64_t endOffset{0};
+    struct archive* archiv = readNew();
+    int ret = openRead(archiv);
+    if (ret == ARCHIVE_OK) {
+        struct archive_entry *entry;
+        while ((ret = archive_read_next_header(archiv, &entry)) == ARCHIVE_OK) {
+            auto path = archive_entry_pathname_utf8(entry);
+            if (path) {
+                ArchivIndexEntry indexEntry;
+                indexEntry.modified = archive_entry_mtime_is_set(entry) ? archive_entry_mtime(entry) : 0;
+                indexEntry.size = archive_entry_size_is_set(entry) ? archive_entry_size(entry) : -1;
+                index[path] = indexEntry;   // later entries replace earlier (as tar does on extract)
+            }
+        }
+        if (ret == ARCHIVE_EOF) {
+            format = archive_format(archiv);
+            // the end of the last entry, so we overwrite the end of archive marker (see bsdtar -r)
+            endOffset = archive_read_header_position(archiv);
+            for (int i = 0; i <  archive_filter_count(archiv); ++i) {
+                if (archive_filter_code(archiv, i) != ARCHIVE_FILTER_NONE) {
+                    compressed = true;
+                }
+            }
+        }
+        else {
+            auto archErr = archive_error_string(archiv);
+            msg = archErr ? std::string(archErr) : psc::fmt::vformat(_("Archiv error {}"), psc::fmt::make_format_args(ret));
+        }
+        archive_read_close(archiv);
+    }
+    else {
+        auto archErr = archive_error_string(archiv);
+        msg = archErr ? std::string(archErr) : psc::fmt::vformat(_("Archiv error {}"), psc::fmt::make_format_args(ret));
+    }
+    archive_read_free(archiv);
+    closeNested();
+    if (!msg.empty()) {
+        throw ArchivException(msg);
+    }
+    if (compressed) {
+        throw ArchivException(_("Update of compressed archiv is not supported"));
+    }
+    if ((format & ARCHIVE_FORMAT_BASE_MASK) == ARCHIVE_FORMAT_TAR) {
+        updateTar(provider, index, format, endOffset);
+    }
+    else if ((format & ARCHIVE_FORMAT_BASE_MASK) == ARCHIVE_FORMAT_ZIP) {
+        updateZip(provider, index);
+    }
+    else {
+        throw ArchivException(psc::fmt::vformat(_("Update of archiv format {} is not supported"), psc::fmt::make_format_args(format)));
+    }
+}
+
+void
+Archiv::updateTar(ArchivProvider* provider, const ArchivIndex& index, int format, la_int64_t endOffset)
+{
+    struct archive* archiv = archive_write_new();
+    Glib::ustring msg;
+    int ret = archive_write_set_format(archiv, format);
+    if (ret == ARCHIVE_OK) {
+        m_appendOffset = endOffset;
+        ret = archive_write_open2(archiv, reinterpret_cast<void*>(this), c_write_open, c_write, c_write_close, c_write_free);
+    }
+    if (ret == ARCHIVE_OK) {
+        msg = writeEntries(archiv, provider, index);
+        archive_write_close(archiv);
+    }
+    else {
+        auto archErr = archive_error_string(archiv);
+        msg = archErr ? std::string(archErr) : psc::fmt::vformat(_("Archiv error {}"), psc::fmt::make_format_args(ret));
+    }
+    archive_write_free(archiv);
+    m_appendOffset = -1;
+    if (!msg.empty()) {
+        throw ArchivException(msg);
+    }
+}
+
+static la_ssize_t
+c_memory_write(struct archive *a, void *client_data, const void *buffer, size_t length)
+{
+    auto memory = reinterpret_cast<std::vector<uint8_t>*>(client_data);
+    auto bytes = reinterpret_cast<const uint8_t*>(buffer);
+    memory->insert(memory->end(), bytes, bytes + length);
+    return static_cast<la_ssize_t>(length);
+}
+
+static uint16_t
+getLe16(const uint8_t* buf)
+{
+    return static_cast<uint16_t>(buf[0] | (buf[1] << 8));
+}
+
+static uint32_t
+getLe32(const uint8_t* buf)
+{
+    return static_cast<uint32_t>(buf[0])
+        | (static_cast<uint32_t>(buf[1]) << 8)
+        | (static_cast<uint32_t>(buf[2]) << 16)
+        | (static_cast<uint32_t>(buf[3]) << 24);
+}
+
+static void
+setLe16(uint8_t* buf, uint16_t val)
+{
+    buf[0] = static_cast<uint8_t>(val);
+    buf[1] = static_cast<uint8_t>(val >> 8);
+}
+
+static void
+setLe32(uint8_t* buf, uint32_t val)
+{
+    buf[0] = static_cast<uint8_t>(val);
+    buf[1] = static_cast<uint8_t>(val >> 8);
+    buf[2] = static_cast<uint8_t>(val >> 16);
+    buf[3] = static_cast<uint8_t>(val >> 24);
+}
+
+static constexpr uint32_t ZIP_CENTRAL_SIGNATURE{0x02014b50u};
+static constexpr uint32_t ZIP_END_SIGNATURE{0x06054b50u};
+static constexpr size_t ZIP_CENTRAL_SIZE{46u};
+static constexpr size_t ZIP_END_SIZE{22u};
+
+// find the end of central directory record in the given tail of a zip file
+static size_t
+findZipEnd(const std::vector<uint8_t>& tail)
+{
+    if (tail.size() >= ZIP_END_SIZE) {
+        for (size_t pos = tail.size() - ZIP_END_SIZE + 1; pos-- > 0; ) {
+            if (getLe32(&tail[pos]) == ZIP_END_SIGNATURE) {
+                return pos;
+            }
+        }
+    }
+    throw ArchivException(_("No zip central directory found"));
+}
+
+// the central directory entries as pairs of (offset, length)
+static std::vector<std::pair<size_t, size_t>>
+splitZipCentral(const std::vector<uint8_t>& central, size_t start, size_t end)
+{
+    std::vector<std::pair<size_t, size_t>> entries;
+    size_t pos{start};
+    while (pos + ZIP_CENTRAL_SIZE <= end) {
+        if (getLe32(&central[pos]) != ZIP_CENTRAL_SIGNATURE) {
+            throw ArchivException(_("Invalid zip central directory"));
+        }
+        size_t len = ZIP_CENTRAL_SIZE
+                   + getLe16(&central[pos + 28])    // name
+                   + getLe16(&central[pos + 30])    // extra
+                   + getLe16(&central[pos + 32]);   // comment
+        if (pos + len > end) {
+            throw ArchivException(_("Invalid zip central directory"));
+        }
+        if (getLe32(&central[pos + 42]) == 0xffffffffu) {
+            throw ArchivException(_("Update of zip64 is not supported"));
+        }
+        entries.push_back(std::make_pair(pos, len));
+        pos += len;
+    }
+    return entries;
+}
+
+static std::string
+getZipName(const std::vector<uint8_t>& central, const std::pair<size_t, size_t>& entry)
+{
+    auto name = reinterpret_cast<const char*>(&central[entry.first + ZIP_CENTRAL_SIZE]);
+    return std::string(name, getLe16(&central[entry.first + 28]));
+}
+
+void
+Archiv::updateZip(ArchivProvider* provider, const ArchivIndex& index)
+{
+    // the changed entries are packed to memory with the usual zip writer
+    std::vector<uint8_t> added;
+    struct archive* archiv = archive_write_new();
+    Glib::ustring msg;
+    int ret = archive_write_set_format_zip(archiv);
+    if (ret == ARCHIVE_OK) {
+        archive_write_set_bytes_per_block(archiv, 0);
+        ret = archive_write_open2(archiv, reinterpret_cast<void*>(&added), nullptr, c_memory_write, nullptr, nullptr);
+    }
+    if (ret == ARCHIVE_OK) {
+        msg = writeEntries(archiv, provider, index);
+        archive_write_close(archiv);
+    }
+    else {
+        auto archErr = archive_error_string(archiv);
+        msg = archErr ? std::string(archErr) : psc::fmt::vformat(_("Archiv error {}"), psc::fmt::make_format_args(ret));
+    }
+    archive_write_free(archiv);
+    if (!msg.empty()) {
+        throw ArchivException(msg);
+    }
+    size_t addedEnd = findZipEnd(added);
+    if (getLe16(&added[addedEnd + 10]) == 0) {
+        return;     // nothing changed, keep file as it is
+    }
+    uint32_t addedCentralOffset = getLe32(&added[addedEnd + 16]);
+    auto addedEntries = splitZipCentral(added, addedCentralOffset, addedEnd);
+    std::set<std::string> replaced;
+    for (auto& entry : addedEntries) {
+        replaced.insert(getZipName(added, entry));
+    }
+    // the central directory is overwritten in place,
+    //   a crash while updating leaves a corrupt zip (no backup is kept)
+    try {
+        auto info = m_file->query_info(G_FILE_ATTRIBUTE_STANDARD_SIZE);
+        goffset fileSize = info->get_size();
+        auto ioStream = m_file->open_readwrite();
+        auto input = ioStream->get_input_stream();
+        // the end record is followed by a comment of up to 64k
+        goffset tailSize = std::min(fileSize, static_cast<goffset>(ZIP_END_SIZE + 0xffff));
+        std::vector<uint8_t> tail(tailSize);
+        gsize bytesRead{};
+        ioStream->seek(fileSize - tailSize, Glib::SeekType::SEEK_TYPE_SET);
+        input->read_all(tail.data(), tail.size(), bytesRead);
+        size_t end = findZipEnd(tail);
+        uint16_t entriesCount = getLe16(&tail[end + 10]);
+        uint32_t centralSize = getLe32(&tail[end + 12]);
+        uint32_t centralOffset = getLe32(&tail[end + 16]);
+        if (entriesCount == 0xffffu
+         || centralSize == 0xffffffffu
+         || centralOffset == 0xffffffffu) {
+            throw ArchivException(_("Update of zip64 is not supported"));
+        }
+        std::vector<uint8_t> central(centralSize);
+        ioStream->seek(centralOffset, Glib::SeekType::SEEK_TYPE_SET);
+        input->read_all(central.data(), central.size(), bytesRead);
+        auto centralEntries = splitZipCentral(central, 0, central.size());
+        std::vector<uint8_t> newCentral;
+        newCentral.reserve(central.size() + (addedEnd - addedCentralOffset));
+        size_t newEntries{0};
+        for (auto& entry : centralEntries) {
+            if (!replaced.contains(getZipName(central, entry))) {
+                newCentral.insert(newCentral.end(), central.begin() + entry.first, central.begin() + entry.first + entry.second);
+                ++newEntries;
+            }
+        }
+        uint64_t addedBase = centralOffset;
+        if (addedBase + addedCentralOffset + newCentral.size() + (addedEnd - addedCentralOffset) >= 0xffffffffu
+         || centralEntries.size() + addedEntries.size() >= 0xffffu) {
+            throw ArchivException(_("Update of zip64 is not supported"));
+        }
+        for (auto& entry : addedEntries) {
+            size_t pos = newCentral.size();
+            newCentral.insert(newCentral.end(), added.begin() + entry.first, added.begin() + entry.first + entry.second);
+            uint32_t localOffset = getLe32(&newCentral[pos + 42]);
+            setLe32(&newCentral[pos + 42], static_cast<uint32_t>(addedBase + localOffset));
+            ++newEntries;
+        }
+        std::array<uint8_t, ZIP_END_SIZE> endRecord{};
+        setLe32(&endRecord[0], ZIP_END_SIGNATURE);
+        setLe16(&endRecord[8], static_cast<uint16_t>(newEntries));
+        setLe16(&endRecord[10], static_cast<uint16_t>(newEntries));
+        setLe32(&endRecord[12], static_cast<uint32_t>(newCentral.size()));
+        setLe32(&endRecord[16], static_cast<uint32_t>(addedBase + addedCentralOffset));
+        // the new members replace the old central directory, the old members stay in place
+        auto output = ioStream->get_output_stream();
+        gsize bytesWritten{};
+        ioStream->seek(centralOffset, Glib::SeekType::SEEK_TYPE_SET);
+        output->write_all(added.data(), addedCentralOffset, bytesWritten);
+        output->write_all(newCentral.data(), newCentral.size(), bytesWritten);
+        output->write_all(endRecord.data(), endRecord.size(), bytesWritten);
+        ioStream->truncate(ioStream->tell());
+        ioStream->close();
+    }
+    catch (const Glib::Error& err) {
+        auto errWhat = std::string(err.what());
+        auto path = m_file->get_path();
+        throw ArchivException(psc::fmt::vformat(_("Error {} updating {}"), psc::fmt::make_format_args(errWhat, path)));
+    }
+}
+
 bool
 Archiv::canRead()
 {
 // see no alternative to opening it ...
     bool has_entries{false};
-    struct archive* archiv = archive_read_new();
-    archive_read_support_filter_all(archiv);
-    archive_read_support_format_all(archiv);
-    int ret = archive_read_open2(archiv, reinterpret_cast<void*>(this), c_read_open, c_read, c_read_skip, c_read_close);
+    struct archive* archiv = readNew();
+    int ret = openRead(archiv);
     if (ret == ARCHIVE_OK) {
         struct archive_entry *entry;
         while (archive_read_next_header(archiv, &entry) == ARCHIVE_OK) {
@@ -361,6 +902,7 @@ Archiv::canRead()
         archive_read_close(archiv);
     }
     archive_read_free(archiv);
+    closeNested();
     //std::cout << "Archiv::canRead " << std::boolalpha << has_entries << std::endl;
     return has_entries;
 }
@@ -446,7 +988,15 @@ int
 Archiv::cc_writeopen(struct archive *archiv)
 {
     try {
-        m_fileOutputstream = m_file->replace("", false, Gio::FileCreateFlags::FILE_CREATE_REPLACE_DESTINATION);
+        if (m_appendOffset >= 0) {
+            m_fileIOstream = m_file->open_readwrite();
+            m_fileIOstream->seek(m_appendOffset, Glib::SeekType::SEEK_TYPE_SET);
+            m_fileIOstream->truncate(m_appendOffset);
+            m_fileOutputstream = m_fileIOstream->get_output_stream();
+        }
+        else {
+            m_fileOutputstream = m_file->replace("", false, Gio::FileCreateFlags::FILE_CREATE_REPLACE_DESTINATION);
+        }
         return ARCHIVE_OK;
     }
     catch (const Glib::Error& err) {    // the expected insight what went wrong is not happening, but at least we get the localisation
@@ -473,6 +1023,10 @@ Archiv::cc_writeclose(struct archive *archiv)
     if (m_fileOutputstream) {
         try {
             m_fileOutputstream->close();
+            if (m_fileIOstream) {
+                m_fileIOstream->close();
+                m_fileIOstream.reset();
+            }
             return ARCHIVE_OK;
         }
         catch (const Glib::Error& err) {
@@ -481,6 +1035,7 @@ Archiv::cc_writeclose(struct archive *archiv)
             }
         }
         m_fileOutputstream.reset();
+        m_fileIOstream.reset();
     }
     return ARCHIVE_FATAL;
 }
@@ -525,6 +1080,7 @@ ArchivFileProvider::getNextEntry()
                 m_entry->setPermission(m_permission);
                 auto info = m_activFile->query_info("*", Gio::FileQueryInfoFlags::FILE_QUERY_INFO_NONE);
                 m_entry->setSize(info->get_size());
+                m_entry->setModified(info->get_modification_date_time().to_unix());
                 return m_entry;
             }
         }
@@ -549,8 +1105,9 @@ ArchivFileProvider::writeContent(Archiv* archiv, struct archive* structarchiv, s
             if (len <= 0) {
                 break;
             }
-            int ret = archive_write_data(structarchiv, buff.get(), len);
-            if (ret != ARCHIVE_OK) {
+            // returns the bytes written
+            if (archive_write_data(structarchiv, buff.get(), len) < 0) {
+                ret = ARCHIVE_FATAL;
                 break;
             }
         }
@@ -20,6 +20,7 @@
 
 #include <archive.h>
 #include <archive_entry.h>
+#include <map>
 #include <glibmm.h>
 #include <giomm.h>
 #include <psc_i18n.hpp>
@@ -32,6 +33,8 @@ enum class LinkType
     , Hard
 };
 
+class ArchivReadProgress;
+
 class ArchivEntry
 {
 public:
@@ -97,6 +100,10 @@ public:
     {
         return m_modified;
     }
+    void setModified(time_t modified)
+    {
+        m_modified = modified;
+    }
     la_int64_t getSize()
     {
         return m_size;
@@ -107,8 +114,17 @@ public:
     }
     virtual int handleContent(struct archive* archiv);
     void setError(struct archive *archiv, const Glib::Error& err, const char* where);
+    void setReadProgress(ArchivReadProgress* readProgress)
+    {
+        m_readProgress = readProgress;
+    }
+
+protected:
+    // call for each data block, so a large member shows progress as well
+    void dataRead();
 
 private:
+    ArchivReadProgress* m_readProgress{nullptr};
     Glib::ustring m_path;
     Glib::ustring m_link;
     LinkType m_linkType{LinkType::None};
@@ -144,6 +160,46 @@ private:
     size_t m_entries{0};
 };
 
+/**
+ * progress of reading a archiv,
+ *   based upon the (compressed) bytes consumed from the file,
+ *   so it is accurate even if the entries are not known in advance.
+ */
+class ArchivProgress
+{
+public:
+    ArchivProgress() = default;
+    ArchivProgress(la_int64_t consumed, goffset total, gint64 elapsedUs)
+    : m_consumed{consumed}
+    , m_total{total}
+    , m_elapsedUs{elapsedUs}
+    {
+    }
+    ArchivProgress(const ArchivProgress& orig) = default;
+    virtual ~ArchivProgress() = default;
+
+    la_int64_t getConsumed() const
+    {
+        return m_consumed;
+    }
+    goffset getTotal() const
+    {
+        return m_total;
+    }
+    // 0...1 or negative if unknown
+    double getFraction() const;
+    // bytes per second
+    double getThroughput() const;
+    // estimated seconds to completion or negative if unknown
+    double getEta() const;
+    // consumed, throughput and eta for display
+    Glib::ustring format() const;
+private:
+    la_int64_t m_consumed{0};
+    goffset m_total{0};
+    gint64 m_elapsedUs{0};
+};
+
 class ArchivEntry;
 
 class ArchivListener
@@ -158,6 +214,10 @@ public:
     }
     virtual void archivUpdate(const PtrArchivEntry& entry) = 0;
     virtual void archivDone(ArchivSummary archivSummary, const Glib::ustring& errMsg) = 0;
+    // reported by reading at most every Archiv::PROGRESS_INTERVAL_US
+    virtual void archivProgress(const ArchivProgress& progress)
+    {
+    }
 protected:
 
 private:
@@ -165,6 +225,24 @@ private:
     friend class Archiv;
 };
 
+// reports the progress while reading, at most every Archiv::PROGRESS_INTERVAL_US
+class ArchivReadProgress
+{
+public:
+    ArchivReadProgress(struct archive* fileArchiv, goffset total, ArchivListener* listener);
+    explicit ArchivReadProgress(const ArchivReadProgress& orig) = delete;
+    virtual ~ArchivReadProgress() = default;
+
+    // @param force report even if the interval has not passed
+    void report(bool force = false);
+private:
+    struct archive* m_fileArchiv;
+    goffset m_total;
+    ArchivListener* m_listener;
+    gint64 m_start;
+    gint64 m_lastProgress;
+};
+
 class ArchivException
 : public std::exception
 {
@@ -179,6 +257,34 @@ private:
 
 class ArchivProvider;
 
+class ArchivIndexEntry
+{
+public:
+    time_t modified{0};
+    la_int64_t size{0};
+};
+
+// path -> the last entry found for it
+using ArchivIndex = std::map<std::string, ArchivIndexEntry>;
+
+/**
+ * feeds the content of a member of a outer archiv
+ *   as stream to a inner archiv,
+ *   so nested archives can be read without temporary files.
+ */
+class ArchivNestedSource
+{
+public:
+    ArchivNestedSource(struct archive* outer);
+    explicit ArchivNestedSource(const ArchivNestedSource& orig) = delete;
+    virtual ~ArchivNestedSource() = default;
+
+    la_ssize_t cc_read(struct archive *archiv, const void **ebuff);
+private:
+    struct archive* m_outer;
+    std::vector<uint8_t> m_buff;
+};
+
 class Archiv
 {
 public:
@@ -198,9 +304,39 @@ public:
      * (the format/filter should have been setup by addFormat)
      * @param provider to enumerate the content of archive
      */
-    void write(ArchivProvider* provider);
+    virtual void write(ArchivProvider* provider);
+    /**
+     * updates a existing archiv with the entries of provider
+     *   that are newer or differ in size from the archived,
+     *   so the cost is proportional to the changes.
+     *   - tar: the changed entries are appended
+     *     (as with tar -u the last entry wins on extraction),
+     *   - zip: the changed entries are appended and the central directory
+     *     is rewritten, unchanged members are kept as they are
+     *     (the space of replaced members is not reclaimed).
+     *   Compressed tars and zip64 are not supported, use write for these.
+     * @param provider to enumerate the content of archive
+     */
+    virtual void update(ArchivProvider* provider);
+    /**
+     * the archiv implementation matching the file
+     *   (a snapshot or any format libarchive supports).
+     */
+    static std::shared_ptr<Archiv> create(const Glib::RefPtr<Gio::File>& file);
 
     bool canRead();
+    /**
+     * read a archive that is contained in this archive
+     *   (any depth is allowed, the outer archives are streamed).
+     * @param nested the member paths starting with the outermost
+     */
+    void setNested(const std::vector<Glib::ustring>& nested);
+    /**
+     * as there is no reliable way to test members of archives
+     *   without reading, use the name as hint.
+     * @return true if name looks like a archive we may read
+     */
+    static bool isArchivName(const Glib::ustring& name);
     /**
      * archive must have been read, to get infos
      * @return the combination of compressions & format used
@@ -215,11 +351,12 @@ public:
      */
     void addWriteFormat(int fmt);
     static constexpr size_t BUF_SIZE{8u*1024u};
+    static constexpr gint64 PROGRESS_INTERVAL_US{250000l};
 
-    int cc_readopen(struct archive *a);
-    la_ssize_t cc_read(struct archive *a, const void **ebuff);
-    la_ssize_t cc_readskip(struct archive *a, off_t request);
-    int cc_readclose();
+    virtual int cc_readopen(struct archive *a);
+    virtual la_ssize_t cc_read(struct archive *a, const void **ebuff);
+    virtual la_ssize_t cc_readskip(struct archive *a, off_t request);
+    virtual int cc_readclose();
 
     int cc_writeopen(struct archive *archiv);
     la_ssize_t cc_write(struct archive *archiv, const void *buffer, size_t length);
@@ -229,17 +366,31 @@ public:
 protected:
     void setError(struct archive *archiv, const Glib::Error& err, const char* where);
     void setFormat(struct archive* archiv);
+    int openRead(struct archive* archiv);
+    Glib::ustring writeEntries(struct archive* archiv, ArchivProvider* provider, const ArchivIndex& index);
+    bool isChanged(const std::shared_ptr<ArchivEntry>& srcEntry, const ArchivIndex& index);
+    void updateTar(ArchivProvider* provider, const ArchivIndex& index, int format, la_int64_t endOffset);
+    void updateZip(ArchivProvider* provider, const ArchivIndex& index);
+    int seekMember(struct archive* archiv, const Glib::ustring& member);
+    void closeNested();
+    // the size the bytes consumed by reading are compared to
+    virtual goffset getReadSize();
     int writeContent(archive* archiv, struct archive_entry *entry, const Glib::RefPtr<Gio::File>& file);
 
-private:
     Glib::RefPtr<Gio::File> m_file;
+private:
     std::vector<std::string> m_readFormats;
     std::vector<int> m_writeFormats;
+    std::vector<Glib::ustring> m_nested;
+    std::vector<struct archive*> m_outer;
+    std::vector<std::unique_ptr<ArchivNestedSource>> m_nestedSources;
 
     // these are the internal "low level" parts
     using BUFFER_ARRAY = std::array<uint8_t, BUF_SIZE>;
     Glib::RefPtr<Gio::FileInputStream> m_fileInputstream;
-    Glib::RefPtr<Gio::FileOutputStream> m_fileOutputstream;
+    Glib::RefPtr<Gio::OutputStream> m_fileOutputstream;
+    Glib::RefPtr<Gio::FileIOStream> m_fileIOstream;
+    goffset m_appendOffset{-1};     // if >= 0 write to existing file at this offset
     std::unique_ptr<BUFFER_ARRAY> buff;
     //std::exception_ptr m_eptr;  // does not really allows deeper error inspection
     friend class ArchivFileProvider;
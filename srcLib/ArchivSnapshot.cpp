@@ -0,0 +1,707 @@
+/* -*- Mode: c++; c-basic-offset: 4; tab-width: 4; coding: utf-8; -*-  */
+/*
+ * Copyright (C) 2025 RPf
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <sstream>
+#include <array>
+#include <algorithm>
+#include <psc_format.hpp>
+
+#include "ArchivSnapshot.hpp"
+
+// the gear table just needs to be random and stable
+static const std::array<uint64_t, 256>&
+gearTable()
+{
+    static const std::array<uint64_t, 256> gear = [] {
+        std::array<uint64_t, 256> table{};
+        uint64_t seed{0x9e3779b97f4a7c15ull};
+        for (auto& val : table) {   // splitmix64
+            seed += 0x9e3779b97f4a7c15ull;
+            uint64_t z = seed;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+            val = z ^ (z >> 31);
+        }
+        return table;
+    }();
+    return gear;
+}
+
+// convert in to out, limit is the size out may reach
+static bool
+convertAll(const Glib::RefPtr<Gio::Converter>& converter
+         , const std::vector<uint8_t>& in
+         , std::vector<uint8_t>& out
+         , size_t limit)
+{
+    out.resize(limit);
+    gsize inPos{0};
+    gsize outPos{0};
+    try {
+        while (true) {
+            gsize bytesRead{0};
+            gsize bytesWritten{0};
+            auto result = converter->convert(in.data() + inPos, in.size() - inPos
+                                           , out.data() + outPos, out.size() - outPos
+                                           , Gio::ConverterFlags::CONVERTER_INPUT_AT_END
+                                           , bytesRead, bytesWritten);
+            inPos += bytesRead;
+            outPos += bytesWritten;
+            if (result == Gio::ConverterResult::CONVERTER_FINISHED) {
+                break;
+            }
+            if (bytesRead == 0 && bytesWritten == 0) {
+                return false;
+            }
+        }
+    }
+    catch (const Gio::Error& err) {
+        if (err.code() == Gio::Error::NO_SPACE) {   // the result would exceed limit
+            return false;
+        }
+        throw;
+    }
+    out.resize(outPos);
+    return true;
+}
+
+static la_ssize_t
+c_chunk_write(struct archive *a, void *client_data, const void *buffer, size_t length)
+{
+    auto chunker = reinterpret_cast<SnapshotChunker*>(client_data);
+    return chunker->cc_write(a, buffer, length);
+}
+
+static la_ssize_t
+c_tar_write(struct archive *a, void *client_data, const void *buffer, size_t length)
+{
+    auto snapshot = reinterpret_cast<ArchivSnapshot*>(client_data);
+    return snapshot->cc_tarwrite(buffer, length);
+}
+
+SnapshotChunker::SnapshotChunker(ArchivSnapshot* snapshot, SnapshotMember& member)
+: m_snapshot{snapshot}
+, m_member{member}
+{
+    m_chunk.reserve(MAX_CHUNK);
+}
+
+la_ssize_t
+SnapshotChunker::cc_write(struct archive *archiv, const void *buffer, size_t length)
+{
+    auto& gear = gearTable();
+    auto bytes = reinterpret_cast<const uint8_t*>(buffer);
+    try {
+        for (size_t i = 0; i < length; ++i) {
+            m_chunk.push_back(bytes[i]);
+            m_hash = (m_hash << 1) + gear[bytes[i]];
+            if ((m_chunk.size() >= MIN_CHUNK && (m_hash & CHUNK_MASK) == 0)
+             || m_chunk.size() >= MAX_CHUNK) {
+                m_snapshot->addChunk(m_chunk, m_member);
+                m_chunk.clear();
+                m_hash = 0;
+            }
+        }
+    }
+    catch (const Glib::Error& err) {
+        std::string errWhat = err.what();
+        archive_set_error(archiv, ARCHIVE_FATAL, "%s error %s", errWhat.c_str(), _("store chunk"));
+        return ARCHIVE_FATAL;
+    }
+    catch (const ArchivException& exc) {
+        archive_set_error(archiv, ARCHIVE_FATAL, "%s", exc.what());
+        return ARCHIVE_FATAL;
+    }
+    return static_cast<la_ssize_t>(length);
+}
+
+void
+SnapshotChunker::finish()
+{
+    if (!m_chunk.empty()) {
+        m_snapshot->addChunk(m_chunk, m_member);
+        m_chunk.clear();
+        m_hash = 0;
+    }
+}
+
+ArchivSnapshot::ArchivSnapshot(Glib::RefPtr<Gio::File> file)
+: Archiv(file)
+{
+}
+
+ArchivSnapshot::~ArchivSnapshot()
+{
+    cc_readclose();     // the base will not reach our implementation
+    try {
+        closePacks();
+    }
+    catch (const Glib::Error& err) {
+        std::cout << "ArchivSnapshot::~ArchivSnapshot " << err.what() << std::endl;
+    }
+}
+
+bool
+ArchivSnapshot::isSnapshot(const Glib::RefPtr<Gio::File>& file)
+{
+    if (!file->get_basename().ends_with(SNAPSHOT_EXT)) {
+        return false;
+    }
+    try {
+        auto stream = file->read();
+        std::array<char, 32> head{};
+        gsize bytesRead{0};
+        stream->read_all(head.data(), head.size(), bytesRead);
+        stream->close();
+        std::string magic{SNAPSHOT_MAGIC};
+        magic += '\n';
+        return std::string(head.data(), bytesRead).starts_with(magic);
+    }
+    catch (const Glib::Error& err) {
+    }
+    return false;
+}
+
+Glib::RefPtr<Gio::File>
+ArchivSnapshot::getRepository()
+{
+    return m_file->get_parent();
+}
+
+Glib::RefPtr<Gio::File>
+ArchivSnapshot::getPack(uint32_t pack)
+{
+    return getRepository()->get_child(PACK_DIR)->get_child(Glib::ustring::sprintf("%08u.pack", pack));
+}
+
+void
+ArchivSnapshot::loadIndex()
+{
+    m_index.clear();
+    m_added.clear();
+    m_pack = 0;
+    auto indexFile = getRepository()->get_child(INDEX_NAME);
+    if (!indexFile->query_exists()) {
+        return;     // first snapshot
+    }
+    try {
+        std::istringstream lines{Glib::file_get_contents(indexFile->get_path())};
+        std::string line;
+        while (std::getline(lines, line)) {
+            std::istringstream fields{line};
+            std::string hash;
+            SnapshotChunk chunk;
+            if (fields >> hash >> chunk.pack >> chunk.offset >> chunk.size >> chunk.length) {
+                m_index[hash] = chunk;
+                m_pack = std::max(m_pack, chunk.pack);
+            }
+        }
+    }
+    catch (const Glib::Error& err) {
+        auto errWhat = std::string(err.what());
+        auto path = indexFile->get_path();
+        throw ArchivException(psc::fmt::vformat(_("Error {} reading {}"), psc::fmt::make_format_args(errWhat, path)));
+    }
+}
+
+void
+ArchivSnapshot::saveIndex()
+{
+    if (m_added.empty()) {
+        return;
+    }
+    std::ostringstream lines;
+    for (auto& hash : m_added) {
+        auto& chunk = m_index[hash];
+        lines << hash
+              << " " << chunk.pack
+              << " " << chunk.offset
+              << " " << chunk.size
+              << " " << chunk.length << "\n";
+    }
+    // append only, so a failed snapshot will not harm the existing
+    auto stream = getRepository()->get_child(INDEX_NAME)->append_to();
+    auto data = lines.str();
+    gsize bytesWritten{0};
+    stream->write_all(data.data(), data.size(), bytesWritten);
+    stream->close();
+    m_added.clear();
+}
+
+std::vector<SnapshotMember>
+ArchivSnapshot::loadManifest()
+{
+    std::vector<SnapshotMember> members;
+    std::string content;
+    try {
+        content = Glib::file_get_contents(m_file->get_path());
+    }
+    catch (const Glib::Error& err) {
+        auto errWhat = std::string(err.what());
+        auto path = m_file->get_path();
+        throw ArchivException(psc::fmt::vformat(_("Error {} reading {}"), psc::fmt::make_format_args(errWhat, path)));
+    }
+    std::istringstream lines{content};
+    std::string line;
+    if (!std::getline(lines, line)
+      || line != SNAPSHOT_MAGIC) {
+        throw ArchivException(_("No snapshot"));
+    }
+    while (std::getline(lines, line)) {
+        if (line.empty()) {
+            continue;
+        }
+        std::vector<std::string> fields;
+        std::istringstream lineStream{line};
+        std::string field;
+        while (std::getline(lineStream, field, '\t')) {
+            fields.push_back(field);
+        }
+        if (fields.size() < 8) {
+            throw ArchivException(psc::fmt::vformat(_("Invalid snapshot entry {}"), psc::fmt::make_format_args(line)));
+        }
+        SnapshotMember member;
+        try {
+            member.mode = static_cast<mode_t>(std::stoul(fields[0]));
+            member.permission = static_cast<mode_t>(std::stoul(fields[1]));
+            member.modified = static_cast<time_t>(std::stoll(fields[2]));
+            member.size = std::stoll(fields[3]);
+        }
+        catch (const std::exception& exc) {
+            throw ArchivException(psc::fmt::vformat(_("Invalid snapshot entry {}"), psc::fmt::make_format_args(line)));
+        }
+        member.user = Glib::strcompress(fields[4]);
+        member.group = Glib::strcompress(fields[5]);
+        member.path = Glib::strcompress(fields[6]);
+        member.link = Glib::strcompress(fields[7]);
+        if (fields.size() > 8) {
+            std::istringstream chunks{fields[8]};
+            std::string hash;
+            while (chunks >> hash) {
+                member.chunks.push_back(hash);
+            }
+        }
+        members.push_back(member);
+    }
+    return members;
+}
+
+void
+ArchivSnapshot::saveManifest(const std::vector<SnapshotMember>& members)
+{
+    std::ostringstream lines;
+    lines << SNAPSHOT_MAGIC << "\n";
+    for (auto& member : members) {
+        lines << member.mode
+              << "\t" << member.permission
+              << "\t" << member.modified
+              << "\t" << member.size
+              << "\t" << Glib::strescape(member.user)
+              << "\t" << Glib::strescape(member.group)
+              << "\t" << Glib::strescape(member.path)
+              << "\t" << Glib::strescape(member.link)
+              << "\t";
+        for (size_t i = 0; i < member.chunks.size(); ++i) {
+            if (i > 0) {
+                lines << " ";
+            }
+            lines << member.chunks[i];
+        }
+        lines << "\n";
+    }
+    std::string etag;
+    m_file->replace_contents(lines.str(), "", etag, false, Gio::FileCreateFlags::FILE_CREATE_REPLACE_DESTINATION);
+}
+
+void
+ArchivSnapshot::openPack()
+{
+    if (m_packOutput) {
+        m_packOutput->close();
+    }
+    auto packDir = getRepository()->get_child(PACK_DIR);
+    if (!packDir->query_exists()) {
+        packDir->make_directory_with_parents();
+    }
+    ++m_pack;   // start a new pack for each snapshot, so existing packs are never modified
+    // a existing file is left from a failed snapshot, as it is not indexed it can be replaced
+    m_packOutput = getPack(m_pack)->replace("", false, Gio::FileCreateFlags::FILE_CREATE_REPLACE_DESTINATION);
+    m_packSize = 0;
+}
+
+void
+ArchivSnapshot::closePacks()
+{
+    if (m_packOutput) {
+        auto packOutput = m_packOutput;
+        m_packOutput.reset();
+        packOutput->close();
+    }
+    for (auto& packInput : m_packInputs) {
+        try {
+            packInput.second->close();
+        }
+        catch (const Glib::Error& err) {    // just reading, so no reason to complain
+        }
+    }
+    m_packInputs.clear();
+}
+
+void
+ArchivSnapshot::addChunk(const std::vector<uint8_t>& data, SnapshotMember& member)
+{
+    Glib::Checksum checksum(Glib::Checksum::ChecksumType::CHECKSUM_SHA256);
+    checksum.update(data.data(), data.size());
+    std::string hash = checksum.get_string();
+    member.chunks.push_back(hash);
+    if (m_index.contains(hash)) {
+        return;
+    }
+    std::vector<uint8_t> compressed;
+    auto compressor = Gio::ZlibCompressor::create(Gio::ZlibCompressorFormat::ZLIB_COMPRESSOR_FORMAT_RAW, -1);
+    // keep the data as it is if compression gives no gain
+    bool useCompressed = convertAll(compressor, data, compressed, data.size() - 1);
+    const auto& stored = useCompressed ? compressed : data;
+    if (!m_packOutput
+     || m_packSize >= MAX_PACK_SIZE) {
+        openPack();
+    }
+    SnapshotChunk chunk;
+    chunk.pack = m_pack;
+    chunk.offset = static_cast<uint64_t>(m_packSize);
+    chunk.size = static_cast<uint32_t>(stored.size());
+    chunk.length = static_cast<uint32_t>(data.size());
+    gsize bytesWritten{0};
+    m_packOutput->write_all(stored.data(), stored.size(), bytesWritten);
+    m_packSize += static_cast<goffset>(bytesWritten);
+    m_index[hash] = chunk;
+    m_added.push_back(hash);
+}
+
+void
+ArchivSnapshot::readChunk(const std::string& hash, std::vector<uint8_t>& data)
+{
+    auto entry = m_index.find(hash);
+    if (entry == m_index.end()) {
+        throw ArchivException(psc::fmt::vformat(_("Snapshot chunk {} not found"), psc::fmt::make_format_args(hash)));
+    }
+    auto& chunk = entry->second;
+    try {
+        auto& input = m_packInputs[chunk.pack];
+        if (!input) {
+            input = getPack(chunk.pack)->read();
+        }
+        input->seek(static_cast<goffset>(chunk.offset), Glib::SeekType::SEEK_TYPE_SET);
+        std::vector<uint8_t> stored(chunk.size);
+        gsize bytesRead{0};
+        input->read_all(stored.data(), stored.size(), bytesRead);
+        if (bytesRead != chunk.size) {
+            throw ArchivException(psc::fmt::vformat(_("Snapshot chunk {} truncated"), psc::fmt::make_format_args(hash)));
+        }
+        if (chunk.size == chunk.length) {
+            data = std::move(stored);
+        }
+        else {
+            auto decompressor = Gio::ZlibDecompressor::create(Gio::ZlibCompressorFormat::ZLIB_COMPRESSOR_FORMAT_RAW);
+            if (!convertAll(decompressor, stored, data, chunk.length)
+              || data.size() != chunk.length) {
+                throw ArchivException(psc::fmt::vformat(_("Snapshot chunk {} damaged"), psc::fmt::make_format_args(hash)));
+            }
+        }
+    }
+    catch (const Glib::Error& err) {
+        auto errWhat = std::string(err.what());
+        throw ArchivException(psc::fmt::vformat(_("Error {} reading chunk {}"), psc::fmt::make_format_args(errWhat, hash)));
+    }
+    Glib::Checksum checksum(Glib::Checksum::ChecksumType::CHECKSUM_SHA256);
+    checksum.update(data.data(), data.size());
+    if (checksum.get_string() != hash) {
+        throw ArchivException(psc::fmt::vformat(_("Snapshot chunk {} damaged"), psc::fmt::make_format_args(hash)));
+    }
+}
+
+void
+ArchivSnapshot::writeMember(ArchivProvider* provider, const std::shared_ptr<ArchivEntry>& srcEntry, SnapshotMember& member)
+{
+    // use the raw format, so the provider may write the content as usual
+    struct archive* archiv = archive_write_new();
+    archive_write_set_format_raw(archiv);
+    archive_write_set_bytes_per_block(archiv, 0);
+    SnapshotChunker chunker(this, member);
+    Glib::ustring msg;
+    int ret = archive_write_open2(archiv, reinterpret_cast<void*>(&chunker), nullptr, c_chunk_write, nullptr, nullptr);
+    if (ret == ARCHIVE_OK) {
+        struct archive_entry *entry = archive_entry_new();
+        archive_entry_set_pathname_utf8(entry, srcEntry->getPath().c_str());
+        archive_entry_set_filetype(entry, AE_IFREG);
+        archive_entry_set_size(entry, srcEntry->getSize());
+        ret = archive_write_header(archiv, entry);
+        if (ret == ARCHIVE_OK) {
+            ret = provider->writeContent(this, archiv, entry);
+        }
+        archive_entry_free(entry);
+    }
+    if (ret == ARCHIVE_OK) {
+        ret = archive_write_close(archiv);
+    }
+    if (ret != ARCHIVE_OK) {
+        auto archErr = archive_error_string(archiv);
+        msg = archErr ? std::string(archErr) : psc::fmt::vformat(_("Archiv error {}"), psc::fmt::make_format_args(ret));
+    }
+    archive_write_free(archiv);
+    if (!msg.empty()) {
+        throw ArchivException(msg);
+    }
+    chunker.finish();
+}
+
+void
+ArchivSnapshot::write(ArchivProvider* provider)
+{
+    loadIndex();
+    std::vector<SnapshotMember> members;
+    try {
+        while (true) {
+            auto srcEntry = provider->getNextEntry();
+            if (!srcEntry) {
+                break;
+            }
+            auto linkType = srcEntry->getLinkType();
+            if (srcEntry->getMode() != AE_IFREG
+             && srcEntry->getMode() != AE_IFLNK
+             && linkType == LinkType::None) {
+                continue;   // as with the other formats the directories are implied
+            }
+            SnapshotMember member;
+            member.mode = srcEntry->getMode();
+            member.permission = srcEntry->getPermission();
+            member.modified = srcEntry->getModified();
+            member.size = srcEntry->getSize();
+            member.user = srcEntry->getUser();
+            member.group = srcEntry->getGroup();
+            member.path = srcEntry->getPath();
+            if (linkType != LinkType::None
+             || srcEntry->getMode() == AE_IFLNK) {
+                // links have no content, a hard link is kept as regular file with the link
+                member.link = srcEntry->getLinkPath();
+                if (member.link.empty()) {
+                    throw ArchivException(psc::fmt::vformat(_("No link target for {}"), psc::fmt::make_format_args(member.path)));
+                }
+                member.mode = linkType == LinkType::Hard ? AE_IFREG : AE_IFLNK;
+                member.size = 0;
+            }
+            else {
+                writeMember(provider, srcEntry, member);
+            }
+            members.push_back(member);
+        }
+        // the manifest must only reference stored chunks
+        closePacks();
+        saveIndex();
+        saveManifest(members);
+    }
+    catch (const Glib::Error& err) {
+        auto errWhat = std::string(err.what());
+        auto path = m_file->get_path();
+        throw ArchivException(psc::fmt::vformat(_("Error {} writing {}"), psc::fmt::make_format_args(errWhat, path)));
+    }
+}
+
+void
+ArchivSnapshot::update(ArchivProvider* provider)
+{
+    write(provider);
+}
+
+goffset
+ArchivSnapshot::getReadSize()
+{
+    goffset size{0};
+    for (auto& member : m_members) {
+        size += member.size;
+    }
+    return size;
+}
+
+int
+ArchivSnapshot::cc_readopen(struct archive *archiv)
+{
+    try {
+        loadIndex();
+        m_members = loadManifest();
+    }
+    catch (const ArchivException& exc) {
+        archive_set_error(archiv, ARCHIVE_FATAL, "%s", exc.what());
+        return ARCHIVE_FATAL;
+    }
+    m_member = 0;
+    m_chunk = 0;
+    m_headerPending = true;
+    m_tarDone = false;
+    m_tarDiscard = false;
+    m_tarWriter = archive_write_new();
+    archive_write_set_format_pax_restricted(m_tarWriter);
+    archive_write_set_bytes_per_block(m_tarWriter, 0);  // pass everything as soon as written
+    int ret = archive_write_open2(m_tarWriter, reinterpret_cast<void*>(this), nullptr, c_tar_write, nullptr, nullptr);
+    if (ret != ARCHIVE_OK) {
+        auto archErr = archive_error_string(m_tarWriter);
+        archive_set_error(archiv, ARCHIVE_FATAL, "%s", archErr ? archErr : _("Error creating tar stream"));
+        return ARCHIVE_FATAL;
+    }
+    return ARCHIVE_OK;
+}
+
+la_ssize_t
+ArchivSnapshot::cc_tarwrite(const void *buffer, size_t length)
+{
+    if (!m_tarDiscard) {
+        auto bytes = reinterpret_cast<const uint8_t*>(buffer);
+        m_tarBuff.insert(m_tarBuff.end(), bytes, bytes + length);
+    }
+    return static_cast<la_ssize_t>(length);
+}
+
+// produce the next part of the tar stream (a header or a chunk)
+int
+ArchivSnapshot::pumpTar(struct archive *archiv)
+{
+    int ret{ARCHIVE_OK};
+    try {
+        if (m_headerPending) {
+            if (m_member >= m_members.size()) {
+                ret = archive_write_close(m_tarWriter);
+                m_tarDone = true;
+            }
+            else {
+                auto& member = m_members[m_member];
+                struct archive_entry *entry = archive_entry_new();
+                archive_entry_set_pathname_utf8(entry, member.path.c_str());
+                archive_entry_set_filetype(entry, member.mode);
+                archive_entry_set_perm(entry, member.permission);
+                archive_entry_set_size(entry, member.mode == AE_IFREG ? member.size : 0);
+                archive_entry_set_mtime(entry, member.modified, 0);
+                if (!member.user.empty()) {
+                    archive_entry_set_uname_utf8(entry, member.user.c_str());
+                }
+                if (!member.group.empty()) {
+                    archive_entry_set_gname_utf8(entry, member.group.c_str());
+                }
+                if (!member.link.empty()) {
+                    if (member.mode == AE_IFLNK) {
+                        archive_entry_set_symlink_utf8(entry, member.link.c_str());
+                    }
+                    else {
+                        archive_entry_set_hardlink_utf8(entry, member.link.c_str());
+                    }
+                }
+                ret = archive_write_header(m_tarWriter, entry);
+                archive_entry_free(entry);
+                m_chunk = 0;
+                m_headerPending = false;
+            }
+        }
+        else if (m_chunk < m_members[m_member].chunks.size()) {
+            readChunk(m_members[m_member].chunks[m_chunk], m_chunkBuff);
+            ++m_chunk;
+            if (archive_write_data(m_tarWriter, m_chunkBuff.data(), m_chunkBuff.size()) < 0) {
+                ret = ARCHIVE_FATAL;
+            }
+        }
+        else {
+            ++m_member;
+            m_headerPending = true;
+        }
+    }
+    catch (const ArchivException& exc) {
+        archive_set_error(archiv, ARCHIVE_FATAL, "%s", exc.what());
+        return ARCHIVE_FATAL;
+    }
+    if (ret < ARCHIVE_WARN) {
+        auto archErr = archive_error_string(m_tarWriter);
+        archive_set_error(archiv, ARCHIVE_FATAL, "%s", archErr ? archErr : _("Error creating tar stream"));
+        return ARCHIVE_FATAL;
+    }
+    return ARCHIVE_OK;
+}
+
+la_ssize_t
+ArchivSnapshot::cc_read(struct archive *archiv, const void **ebuff)
+{
+    m_tarBuff.clear();      // the previous block was consumed
+    while (m_tarBuff.empty()
+        && !m_tarDone) {
+        if (pumpTar(archiv) != ARCHIVE_OK) {
+            return ARCHIVE_FATAL;
+        }
+    }
+    *ebuff = m_tarBuff.data();
+    return static_cast<la_ssize_t>(m_tarBuff.size());
+}
+
+la_ssize_t
+ArchivSnapshot::cc_readskip(struct archive *archiv, off_t request)
+{
+    // whole chunks can be passed without reading them (a listing will not touch the packs),
+    //   the writer is fed with zeros to keep the stream in sync
+    la_ssize_t skipped{0};
+    while (!m_headerPending
+        && m_member < m_members.size()
+        && m_chunk < m_members[m_member].chunks.size()) {
+        auto entry = m_index.find(m_members[m_member].chunks[m_chunk]);
+        if (entry == m_index.end()
+         || skipped + static_cast<la_ssize_t>(entry->second.length) > request) {
+            break;
+        }
+        m_chunkBuff.assign(entry->second.length, 0u);
+        m_tarDiscard = true;
+        auto len = archive_write_data(m_tarWriter, m_chunkBuff.data(), m_chunkBuff.size());
+        m_tarDiscard = false;
+        if (len < 0) {
+            auto archErr = archive_error_string(m_tarWriter);
+            archive_set_error(archiv, ARCHIVE_FATAL, "%s", archErr ? archErr : _("Error creating tar stream"));
+            return ARCHIVE_FATAL;
+        }
+        skipped += static_cast<la_ssize_t>(entry->second.length);
+        ++m_chunk;
+    }
+    return skipped;
+}
+
+int
+ArchivSnapshot::cc_readclose()
+{
+    if (m_tarWriter) {
+        m_tarDiscard = true;
+        archive_write_free(m_tarWriter);
+        m_tarWriter = nullptr;
+        m_tarDiscard = false;
+    }
+    m_members.clear();
+    m_tarBuff.clear();
+    m_chunkBuff.clear();
+    for (auto& packInput : m_packInputs) {
+        try {
+            packInput.second->close();
+        }
+        catch (const Glib::Error& err) {    // just reading, so no reason to complain
+        }
+    }
+    m_packInputs.clear();
+    return ARCHIVE_OK;
+}
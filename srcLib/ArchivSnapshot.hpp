@@ -0,0 +1,154 @@
+/* -*- Mode: c++; c-basic-offset: 4; tab-width: 4; coding: utf-8; -*-  */
+/*
+ * Copyright (C) 2025 RPf
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <map>
+#include <vector>
+
+#include "Archiv.hpp"
+
+// where the content of a chunk is stored
+class SnapshotChunk
+{
+public:
+    uint32_t pack{0};
+    uint64_t offset{0};
+    uint32_t size{0};       // as stored (if equal to length uncompressed)
+    uint32_t length{0};     // of the content
+};
+
+// sha256 (hex) -> chunk
+using SnapshotChunkIndex = std::map<std::string, SnapshotChunk>;
+
+class SnapshotMember
+{
+public:
+    mode_t mode{0};
+    mode_t permission{0};
+    time_t modified{0};
+    la_int64_t size{0};
+    std::string user;
+    std::string group;
+    std::string path;
+    std::string link;       // target of symlink, for regular the hard linked path
+    std::vector<std::string> chunks;
+};
+
+class ArchivSnapshot;
+
+/**
+ * splits the content of a member with content defined chunking
+ *   (a gear hash decides the boundaries, so inserting
+ *   some bytes only changes the chunks around it)
+ *   and stores the chunks not yet known.
+ */
+class SnapshotChunker
+{
+public:
+    SnapshotChunker(ArchivSnapshot* snapshot, SnapshotMember& member);
+    explicit SnapshotChunker(const SnapshotChunker& orig) = delete;
+    virtual ~SnapshotChunker() = default;
+
+    la_ssize_t cc_write(struct archive *archiv, const void *buffer, size_t length);
+    void finish();
+
+    static constexpr size_t MIN_CHUNK{2u*1024u};
+    static constexpr size_t MAX_CHUNK{64u*1024u};
+    // 13 bits gives the average of 8k, use the upper bits as these depend on more input
+    static constexpr uint64_t CHUNK_MASK{0xfff8000000000000ull};
+private:
+    ArchivSnapshot* m_snapshot;
+    SnapshotMember& m_member;
+    std::vector<uint8_t> m_chunk;
+    uint64_t m_hash{0};
+};
+
+/**
+ * a deduplicating backup format,
+ *   the file given is the manifest of a snapshot,
+ *   the chunks are shared by all snapshots in the same directory:
+ *     name.snap        the list of members with the chunks
+ *     chunks.idx       the location of all chunks
+ *     packs/NNNNNNNN.pack  the (compressed) chunk data
+ *   so a repeated snapshot of the same tree
+ *   only stores the changed chunks.
+ *   Reading and writing use the usual listener/provider,
+ *   for reading the members are presented as tar stream.
+ */
+class ArchivSnapshot
+: public Archiv
+{
+public:
+    ArchivSnapshot(Glib::RefPtr<Gio::File> file);
+    explicit ArchivSnapshot(const ArchivSnapshot& orig) = delete;
+    virtual ~ArchivSnapshot();
+
+    void write(ArchivProvider* provider) override;
+    // as only new chunks are stored this is a write
+    void update(ArchivProvider* provider) override;
+
+    int cc_readopen(struct archive *archiv) override;
+    la_ssize_t cc_read(struct archive *archiv, const void **ebuff) override;
+    la_ssize_t cc_readskip(struct archive *archiv, off_t request) override;
+    int cc_readclose() override;
+    la_ssize_t cc_tarwrite(const void *buffer, size_t length);
+
+    static bool isSnapshot(const Glib::RefPtr<Gio::File>& file);
+    static constexpr auto SNAPSHOT_EXT{".snap"};
+    static constexpr auto SNAPSHOT_MAGIC{"varsel-snapshot 1"};
+    static constexpr auto INDEX_NAME{"chunks.idx"};
+    static constexpr auto PACK_DIR{"packs"};
+    static constexpr goffset MAX_PACK_SIZE{64l*1024l*1024l};
+
+    // store chunk if unknown
+    void addChunk(const std::vector<uint8_t>& data, SnapshotMember& member);
+    void readChunk(const std::string& hash, std::vector<uint8_t>& data);
+
+protected:
+    Glib::RefPtr<Gio::File> getRepository();
+    void loadIndex();
+    void saveIndex();
+    std::vector<SnapshotMember> loadManifest();
+    void saveManifest(const std::vector<SnapshotMember>& members);
+    Glib::RefPtr<Gio::File> getPack(uint32_t pack);
+    void openPack();
+    void closePacks();
+    void writeMember(ArchivProvider* provider, const std::shared_ptr<ArchivEntry>& srcEntry, SnapshotMember& member);
+    int pumpTar(struct archive *archiv);
+    // the tar stream is read, so compare to the content
+    goffset getReadSize() override;
+
+private:
+    SnapshotChunkIndex m_index;
+    std::vector<std::string> m_added;   // chunks not in index file
+    uint32_t m_pack{0};
+    Glib::RefPtr<Gio::FileOutputStream> m_packOutput;
+    goffset m_packSize{0};
+    std::map<uint32_t, Glib::RefPtr<Gio::FileInputStream>> m_packInputs;
+    // state of the tar stream presented for reading
+    std::vector<SnapshotMember> m_members;
+    struct archive* m_tarWriter{nullptr};
+    std::vector<uint8_t> m_tarBuff;
+    std::vector<uint8_t> m_chunkBuff;
+    size_t m_member{0};
+    size_t m_chunk{0};
+    bool m_headerPending{true};
+    bool m_tarDone{false};
+    bool m_tarDiscard{false};
+};
@@ -63,8 +63,8 @@ ListFactory::notify(const std::vector<PtrEventItem>& files, Gtk::Menu* gtkMenu)
             createItem(item, gtkMenu);
         }
         else if (type == Gio::FileType::FILE_TYPE_REGULAR) {
-            Archiv archiv{file};
-            if (archiv.canRead()) {
+            auto archiv = Archiv::create(file);
+            if (archiv->canRead()) {
                 if (!allItem) {
                     allItem = Gtk::make_managed<Gtk::MenuItem>(Glib::ustring::sprintf(_("List %s"), "all archives"));
                     gtkMenu->append(*allItem);
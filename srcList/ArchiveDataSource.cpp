@@ -29,10 +29,12 @@
 // use additional listener for processing in main thread
 ArchivListWorker::ArchivListWorker(
               const Glib::RefPtr<Gio::File>& file
+            , const std::vector<Glib::ustring>& nested
             , ArchivListener* archivListener)
 : ThreadWorker()
 , ArchivListener()
 , m_file{file}
+, m_nested{nested}
 , m_archivListener{archivListener}
 {
 }
@@ -51,12 +53,24 @@ ArchivListWorker::archivDone(ArchivSummary archivSummary, const Glib::ustring& m
     m_archivSummary = archivSummary;
 }
 
+void
+ArchivListWorker::archivProgress(const ArchivProgress& progress)
+{
+    // this is called from thread context, the empty entry signals progress
+    {
+        std::lock_guard<std::mutex> lock(m_progressMutex);
+        m_progress = progress;
+    }
+    notify(std::shared_ptr<ArchivEntry>());
+}
+
 ArchivSummary
 ArchivListWorker::doInBackground()
 {
     //std::cout << "ArchivWorker::doInBackground " << m_file->get_path() << std::endl;
-    Archiv archiv(m_file);
-    archiv.read(this);
+    auto archiv = Archiv::create(m_file);
+    archiv->setNested(m_nested);
+    archiv->read(this);
     return m_archivSummary;
 }
 
@@ -66,7 +80,17 @@ ArchivListWorker::process(const std::vector<std::shared_ptr<ArchivEntry>>& entri
     // here we are back to main thread ...
     for (auto entry : entries) {
         //std::cout << "main archiv path " << entry->getPath() << std::endl;
-        m_archivListener->archivUpdate(entry);
+        if (entry) {
+            m_archivListener->archivUpdate(entry);
+        }
+        else {
+            ArchivProgress progress;
+            {
+                std::lock_guard<std::mutex> lock(m_progressMutex);
+                progress = m_progress;
+            }
+            m_archivListener->archivProgress(progress);
+        }
     }
 }
 
@@ -85,17 +109,70 @@ ArchivListWorker::done()
     m_archivListener->archivDone(m_archivSummary, msg);
 }
 
+ArchivNestedLoader::ArchivNestedLoader(
+              ArchiveDataSource* archiveDataSource
+            , const std::shared_ptr<FileTreeNode>& treeNode
+            , const std::vector<Glib::ustring>& nested
+            , ListListener* listListener)
+: ArchivListener()
+, m_archiveDataSource{archiveDataSource}
+, m_treeNode{treeNode}
+, m_nested{nested}
+, m_listListener{listListener}
+{
+}
+
+void
+ArchivNestedLoader::execute(const Glib::RefPtr<Gio::File>& file)
+{
+    m_archivWorker = std::make_shared<ArchivListWorker>(file, m_nested, this);
+    m_archivWorker->execute();
+}
+
+void
+ArchivNestedLoader::archivUpdate(const std::shared_ptr<ArchivEntry>& entry)
+{
+    ++m_entries;
+    m_archiveDataSource->addEntry(entry, m_treeNode, m_nested);
+}
+
+void
+ArchivNestedLoader::archivDone(ArchivSummary archivSummary, const Glib::ustring& errMsg)
+{
+    // the node keeps the listing, so we don't need to read it again
+    if (!errMsg.empty()
+     && m_listListener) {
+        // otherwise a damaged inner archive would show as empty
+        m_listListener->listDone(Severity::Error, Glib::ustring::sprintf(_("Error %s"), errMsg));
+    }
+    m_listListener = nullptr;   // this should no long be used
+    m_done = true;
+    m_archiveDataSource->nestedDone(this);
+}
+
 ArchiveDataSource::ArchiveDataSource(ListApp* application)
 : DataSource::DataSource(application)
 , ArchivListener::ArchivListener()
 {
 }
 
+void
+ArchiveDataSource::nestedDone(ArchivNestedLoader* nestedLoader)
+{
+    // the calling loader is still in use (its worker returns there),
+    //   it will be removed with the next one finished
+    m_nestedLoaders.remove_if(
+        [nestedLoader] (const std::shared_ptr<ArchivNestedLoader>& loader) {
+            return loader->isDone()
+                && loader.get() != nestedLoader;
+        });
+}
+
 bool
 ArchiveDataSource::can_handle(const Glib::RefPtr<Gio::File>& file)
 {
-    Archiv archiv(file);
-    bool ret = archiv.canRead();
+    auto archiv = Archiv::create(file);
+    bool ret = archiv->canRead();
 #   ifdef DEBUG
     std::cout << "ArchiveDataSource::can_handle " << file->get_path() << std::boolalpha << " ret " << ret << std::endl;
 #   endif
@@ -108,25 +185,41 @@ ArchiveDataSource::archivUpdate(const std::shared_ptr<ArchivEntry>& entry)
     // here we are back to main thread ...
     //std::cout << "outer archiv path " << entry->getPath() << std::endl;
     ++m_entries;
-    auto file = Gio::File::create_for_path("/" + entry->getPath()); // make absolute otherwise, local path will be prefixed
+    std::vector<Glib::ustring> nested;
+    addEntry(entry, m_treeItem, nested);
+}
+
+void
+ArchiveDataSource::addEntry(
+          const std::shared_ptr<ArchivEntry>& entry
+        , const std::shared_ptr<FileTreeNode>& rootNode
+        , const std::vector<Glib::ustring>& nested)
+{
+    // nested entries are prefixed by the path of the containing archive
+    Glib::ustring prefix;
+    if (!nested.empty()) {
+        prefix = rootNode->getDirFile()->get_path();
+    }
+    auto file = Gio::File::create_for_path(prefix + "/" + entry->getPath()); // make absolute otherwise, local path will be prefixed
+    auto structFile = Gio::File::create_for_path("/" + entry->getPath());  // the structure within the archive
     Glib::ustring path,name;
     Glib::ustring stype = entry->getModeName();
     if (entry->getMode() > 0) {
         if (entry->getMode() == AE_IFDIR) {
-            path = file->get_parse_name();
+            path = structFile->get_parse_name();
             name = "";
         }
         else {
-            path = file->get_parent()->get_parse_name();
-            name = file->get_basename();
+            path = structFile->get_parent()->get_parse_name();
+            name = structFile->get_basename();
         }
     }
     else {     // for this case we are clueless
         path = "";
-        name = file->get_parse_name();  // represent unstructured?
+        name = structFile->get_parse_name();  // represent unstructured?
     }
 
-    std::shared_ptr<BaseTreeNode> addNode = m_treeItem;
+    std::shared_ptr<BaseTreeNode> addNode = rootNode;
     if (!path.empty()) {
         //std::cout << "ArchiveDataSource::archivUpdate"
         //          << " path " << path << std::endl;
@@ -136,7 +229,7 @@ ArchiveDataSource::archivUpdate(const std::shared_ptr<ArchivEntry>& entry)
             parts.push_front(fspath->get_basename());
             fspath = fspath->get_parent();
         }
-        Glib::ustring path;
+        Glib::ustring path{prefix};
         for (auto iter = parts.begin(); iter != parts.end(); ++iter) {
             auto spart = *iter;
             if (!spart.empty()) {
@@ -172,12 +265,30 @@ ArchiveDataSource::archivUpdate(const std::shared_ptr<ArchivEntry>& entry)
 
         row.set_value(listColumns->m_file, file);   // pass as "virtual" file
         //row.set_value(listColumns->m_fileInfo, fileInfo);
-    }
-
 
+        if (entry->getMode() == AE_IFREG
+         && Archiv::isArchivName(name)
+         && !addNode->findNode(name)) {
+            // represent the nested archive as subtree, that gets listed on selection
+            auto nestedItem = std::make_shared<FileTreeNode>(file, name, addNode->getDepth() + 1);
+            addNode->addChild(nestedItem);
+            m_treeModel->memory_row_inserted(nestedItem);
+            auto members = nested;
+            members.push_back(entry->getPath());
+            m_nested.insert(std::make_pair(file->get_path(), members));
+        }
+    }
 }
 
 // Archiv Listener
+void
+ArchiveDataSource::archivProgress(const ArchivProgress& progress)
+{
+    if (m_listListener) {
+        m_listListener->listProgress(progress.getFraction(), progress.format());
+    }
+}
+
 void
 ArchiveDataSource::archivDone(ArchivSummary archivSummary, const Glib::ustring& errorMsg)
 {
@@ -211,6 +322,17 @@ ArchiveDataSource::update(
         , const Glib::RefPtr<psc::ui::TreeNodeModel>& treeModel
         , ListListener* listListener)
 {
+    if (treeItem) {
+        auto nested = m_nested.find(file->get_path());
+        if (nested != m_nested.end()) {
+            auto nestedNode = std::dynamic_pointer_cast<FileTreeNode>(treeItem);
+            nestedNode->setQueried(true);   // the listing is kept with the node
+            auto nestedLoader = std::make_shared<ArchivNestedLoader>(this, nestedNode, nested->second, listListener);
+            m_nestedLoaders.push_back(nestedLoader);
+            nestedLoader->execute(m_file);
+            return;
+        }
+    }
     m_file = file;
     m_listListener = listListener;
     m_treeModel = treeModel;
@@ -222,7 +344,8 @@ ArchiveDataSource::update(
     auto fileTreeNode = std::dynamic_pointer_cast<FileTreeNode>(treeItem);
     fileTreeNode->setQueried(true);
 
-    m_archivWorker = std::make_shared<ArchivListWorker>(m_file, this);
+    std::vector<Glib::ustring> nested;
+    m_archivWorker = std::make_shared<ArchivListWorker>(m_file, nested, this);
     //std::cout << "ArchiveDataSource::update" << m_archivWorker.get() << std::endl;
     m_archivWorker->execute();
 }
@@ -275,10 +398,44 @@ ArchiveDataSource::distribute(const std::vector<PtrEventItem>& items, Gtk::Menu*
     }
 }
 
+std::vector<Glib::ustring>
+ArchiveDataSource::getNested(const Glib::ustring& path, Glib::ustring& relPath)
+{
+    // use the innermost archive that contains the path
+    std::vector<Glib::ustring> nested;
+    relPath = path;
+    size_t matched{0u};
+    for (auto& entry : m_nested) {
+        auto& nestedPath = entry.first;
+        if (nestedPath.length() > matched
+         && path.length() > nestedPath.length()
+         && path.compare(0, nestedPath.length(), nestedPath) == 0
+         && path[nestedPath.length()] == '/') {
+            matched = nestedPath.length();
+            nested = entry.second;
+            relPath = path.substr(matched);
+        }
+    }
+    return nested;
+}
+
 void
 ArchiveDataSource::do_handle(const std::vector<PtrEventItem>& items, Gtk::Window* win)
 {
-    auto dir = ExtractDialog::show(m_file, items, win);
+    std::vector<Glib::ustring> nested;
+    std::vector<PtrEventItem> extractItems;
+    if (!items.empty()) {
+        Glib::ustring relPath;
+        nested = getNested(items[0]->getFile()->get_path(), relPath);
+        for (auto& item : items) {
+            auto itemNested = getNested(item->getFile()->get_path(), relPath);
+            if (itemNested == nested) {  // extract only items from the same archive
+                extractItems.emplace_back(
+                        std::make_shared<EventItem>(Gio::File::create_for_path(relPath)));
+            }
+        }
+    }
+    auto dir = ExtractDialog::show(m_file, extractItems, nested, win);
     auto varselList = dynamic_cast<VarselList*>(win);
     if (dir && varselList) {
         varselList->showFile(dir);
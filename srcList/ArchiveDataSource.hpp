@@ -20,6 +20,9 @@
 
 #include <memory>
 #include <set>
+#include <map>
+#include <list>
+#include <mutex>
 
 #include "DataSource.hpp"
 #include "Archiv.hpp"
@@ -34,12 +37,14 @@ class ArchivListWorker
 public:
     ArchivListWorker(
               const Glib::RefPtr<Gio::File>& file
+            , const std::vector<Glib::ustring>& nested
             , ArchivListener* archivListener);
     explicit ArchivListWorker(const ArchivListWorker& orig) = delete;
     virtual ~ArchivListWorker() = default;
 
     void archivUpdate(const std::shared_ptr<ArchivEntry>& entry) override;
     void archivDone(ArchivSummary archivSummary, const Glib::ustring& msg) override;
+    void archivProgress(const ArchivProgress& progress) override;
 
 protected:
 
@@ -50,8 +55,47 @@ protected:
 
 private:
     Glib::RefPtr<Gio::File> m_file;
+    std::vector<Glib::ustring> m_nested;
     ArchivListener* m_archivListener;
     ArchivSummary m_archivSummary;
+    std::mutex m_progressMutex;
+    ArchivProgress m_progress;  // passed to main thread by a empty entry
+};
+
+class ArchiveDataSource;
+
+/**
+ * lists a archive contained in the archive
+ *   below the node that represents it.
+ */
+class ArchivNestedLoader
+: public ArchivListener
+{
+public:
+    ArchivNestedLoader(
+              ArchiveDataSource* archiveDataSource
+            , const std::shared_ptr<FileTreeNode>& treeNode
+            , const std::vector<Glib::ustring>& nested
+            , ListListener* listListener);
+    explicit ArchivNestedLoader(const ArchivNestedLoader& orig) = delete;
+    virtual ~ArchivNestedLoader() = default;
+
+    void execute(const Glib::RefPtr<Gio::File>& file);
+    void archivUpdate(const std::shared_ptr<ArchivEntry>& entry) override;
+    void archivDone(ArchivSummary archivSummary, const Glib::ustring& errMsg) override;
+    bool isDone()
+    {
+        return m_done;
+    }
+
+private:
+    ArchiveDataSource* m_archiveDataSource;
+    std::shared_ptr<FileTreeNode> m_treeNode;
+    std::vector<Glib::ustring> m_nested;
+    std::shared_ptr<ArchivListWorker> m_archivWorker;
+    ListListener* m_listListener;
+    size_t m_entries{0u};
+    bool m_done{false};
 };
 
 
@@ -75,6 +119,7 @@ public:
 
     void archivUpdate(const std::shared_ptr<ArchivEntry>& entry)  override;
     void archivDone(ArchivSummary archivSummary, const Glib::ustring& errMsg) override;
+    void archivProgress(const ArchivProgress& progress) override;
     void paste(const std::vector<Glib::ustring>& uris
             , const Glib::RefPtr<Gio::File>& dir
             , bool isMove
@@ -82,6 +127,12 @@ public:
     void distribute(const std::vector<PtrEventItem>& items, Gtk::Menu* menu, Gtk::Window* win) override;
     Gtk::MenuItem* createItem(const std::vector<PtrEventItem>& items, Gtk::Menu* gtkMenu, const Glib::ustring& name, Gtk::Window* win);
     void do_handle(const std::vector<PtrEventItem>& items, Gtk::Window* win);
+    void addEntry(const std::shared_ptr<ArchivEntry>& entry
+                , const std::shared_ptr<FileTreeNode>& rootNode
+                , const std::vector<Glib::ustring>& nested);
+    void nestedDone(ArchivNestedLoader* nestedLoader);
+protected:
+    std::vector<Glib::ustring> getNested(const Glib::ustring& path, Glib::ustring& relPath);
 private:
     Glib::RefPtr<Gio::File> m_file;
     Glib::RefPtr<psc::ui::TreeNodeModel> m_treeModel;
@@ -89,5 +140,8 @@ private:
     std::shared_ptr<ArchivListWorker> m_archivWorker;
     size_t m_entries{0u};
     ListListener* m_listListener{nullptr};
+    // virtual path of nested archive -> member chain
+    std::map<Glib::ustring, std::vector<Glib::ustring>> m_nested;
+    std::list<std::shared_ptr<ArchivNestedLoader>> m_nestedLoaders;
 };
 
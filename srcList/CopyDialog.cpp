@@ -21,227 +21,261 @@
 #include <StringUtils.hpp>
 
 #include "VarselList.hpp"
+#include "ListApp.hpp"
 
 #include "CopyDialog.hpp"
 
-bool
-CopyModeAsk::isOverwrite(
-    const Glib::RefPtr<Gio::File>& src
-    , const Glib::RefPtr<Gio::File>& target)
+CopyDialog::CopyDialog(BaseObjectType* cobject
+        , const Glib::RefPtr<Gtk::Builder>& builder
+        , const std::vector<Glib::ustring>& uris
+        , const Glib::RefPtr<Gio::File>& dirs
+        , bool isMove
+        , VarselList* varselList)
+: Gtk::Dialog(cobject)
+, m_dir{dirs}
+, m_isMove{isMove}
+, m_varselList{varselList}
 {
-    auto msg = Glib::ustring::sprintf(_("Overwrite %s"), target->get_parse_name());
-    Gtk::MessageDialog msgDlg(*m_copyDialog->getWindow(), msg, false, Gtk::MessageType::MESSAGE_QUESTION, Gtk::ButtonsType::BUTTONS_YES_NO, true);
-    auto ret = msgDlg.run();
-    if (ret == Gtk::RESPONSE_NO) {
-        return false;
+    for (auto uri : uris) {
+        m_sources.push_back(Gio::File::create_for_uri(uri));
     }
-    return true;
+    setup(builder);
+    m_apply->signal_clicked().connect(sigc::mem_fun(*this, &CopyDialog::apply));
 }
 
-bool
-CopyModeCheck::isOverwrite(
-    const Glib::RefPtr<Gio::File>& src
-    , const Glib::RefPtr<Gio::File>& target)
+CopyDialog::CopyDialog(BaseObjectType* cobject
+        , const Glib::RefPtr<Gtk::Builder>& builder
+        , const std::shared_ptr<CopyTask>& copyTask
+        , VarselList* varselList)
+: Gtk::Dialog(cobject)
+, m_dir{copyTask->getDir()}
+, m_isMove{copyTask->isMove()}
+, m_varselList{varselList}
+, m_sources{copyTask->getSources()}
+, m_copyTask{copyTask}
 {
-    auto srcInfo = src->query_info("standard::size,time::modified", Gio::FileQueryInfoFlags::FILE_QUERY_INFO_NONE);
-    auto targetInfo = target->query_info("standard::size,time::modified", Gio::FileQueryInfoFlags::FILE_QUERY_INFO_NONE);
-    if (srcInfo->get_modification_date_time()
-     .compare(targetInfo->get_modification_date_time()) > 0) {
-        return true;
-    }
-    if (srcInfo->get_size()
-     != targetInfo->get_size()) {
-        return true;
+    setup(builder);
+    m_apply->set_sensitive(false);
+    m_overwrite->set_active_id(copyTask->getModeId());
+    m_overwrite->set_sensitive(false);
+    if (m_copyTask->getState() == CopyTaskState::Queued) {
+        showText(_("Waiting for the running copy\n"));
     }
-    return false;
+    m_copyTask->attach(this);
 }
 
-CopyItem::CopyItem(const Glib::RefPtr<Gio::File>& src
-            , const Glib::RefPtr<Gio::File>& target
-            , CopyDialog* copyDialog)
-: m_src{src}
-, m_target{target}
-, m_copyDialog{copyDialog}
+void
+CopyDialog::setup(const Glib::RefPtr<Gtk::Builder>& builder)
 {
+    builder->get_widget("target", m_target);
+    builder->get_widget("progress", m_progress);
+    builder->get_widget("text", m_text);
+    builder->get_widget("overwrite", m_overwrite);
+    builder->get_widget("apply", m_apply);
+    builder->get_widget("conflictBox", m_conflictBox);
+    builder->get_widget("conflicts", m_conflictView);
+    m_conflicts = Gtk::ListStore::create(m_conflictColumns);
+    m_conflictView->set_model(m_conflicts);
+    m_conflictView->append_column(_("Name"), m_conflictColumns.m_name);
+    m_conflictView->append_column(_("Source"), m_conflictColumns.m_source);
+    m_conflictView->append_column(_("Target"), m_conflictColumns.m_target);
+    m_conflictView->get_selection()->set_mode(Gtk::SelectionMode::SELECTION_MULTIPLE);
+    Gtk::Button* button;
+    builder->get_widget("overwriteConflicts", button);
+    button->signal_clicked().connect([this] {
+        resolve(std::make_shared<CopyModeAll>());
+    });
+    builder->get_widget("overwriteNewer", button);
+    button->signal_clicked().connect([this] {
+        resolve(std::make_shared<CopyModeNewer>());
+    });
+    builder->get_widget("skipConflicts", button);
+    button->signal_clicked().connect([this] {
+        resolve(std::make_shared<CopyModeNo>());
+    });
+    m_target->set_text(m_dir->get_parse_name());
+    IoScheduler::connect(builder);
 }
 
-void
-CopyItem::copy()
+CopyDialog::~CopyDialog()
 {
-    auto fileType = m_src->query_file_type(Gio::FileQueryInfoFlags::FILE_QUERY_INFO_NONE);
-    if (fileType == Gio::FileType::FILE_TYPE_REGULAR) {
-        copyFile();
-    }
-    else if (fileType == Gio::FileType::FILE_TYPE_DIRECTORY) {
-        copyDir();
-    }
-    else if (fileType == Gio::FileType::FILE_TYPE_SYMBOLIC_LINK) {
-        copySymlink();
+    if (m_copyTask) {
+        m_copyTask->detach(this);   // the copy continues
     }
 }
 
 void
-CopyItem::copyFile()
+CopyDialog::on_response(int response)
 {
-    auto newFile = m_target->get_child(m_src->get_basename());
-    if (newFile->query_exists()) {
-        auto copyMode = m_copyDialog->getCopyMode();
-        if (!copyMode->isOverwrite(m_src, newFile)) {
-            m_copyDialog->showText(Glib::ustring::sprintf(_("Skipped %s\n"), newFile->get_parse_name()));
-            m_copyDialog->next();
-            return;
-        }
+    if (response == Gtk::ResponseType::RESPONSE_CANCEL
+     && m_copyTask) {
+        m_copyTask->cancel();
     }
-    std::cout << "Copy " << m_src->get_parse_name() << " to " << m_target->get_parse_name() << std::endl;
-    m_src->copy_async(newFile
-              , sigc::mem_fun(*m_copyDialog, &CopyDialog::progress)
-              , sigc::mem_fun(*this, &CopyItem::ready)
-              , m_copyDialog->getCancelable()
-              , Gio::FILE_COPY_OVERWRITE);
+    hide();
 }
 
 
 void
-CopyItem::copySymlink()
+CopyDialog::apply()
 {
-    std::cout << "Howto copy symlink " << m_src->get_path() << "?" << std::endl;
-    //dir->make_symbolic_link();
+    m_apply->set_sensitive(false);
+    m_overwrite->set_sensitive(false);
+    auto concurrency = CopyJob::getConcurrency(m_sources, m_dir, m_varselList->getKeyFile());
+    if (m_isMove) {
+        showText(Glib::ustring::sprintf(_("Move with %d concurrent\n"), concurrency));
+    }
+    else {
+        showText(Glib::ustring::sprintf(_("Copy with %d concurrent\n"), concurrency));
+    }
+    auto copyManager = m_varselList->getListApp()->getCopyManager();
+    m_copyTask = copyManager->add(m_sources, m_dir, m_isMove, m_overwrite->get_active_id(), concurrency);
+    if (m_copyTask->getState() == CopyTaskState::Queued) {
+        showText(_("Waiting for the running copy\n"));
+    }
+    m_copyTask->attach(this);
 }
 
-
 void
-CopyItem::copyDir()
+CopyDialog::copyProgress(const CopyProgress& progress)
 {
-    auto targetDir = m_target->get_child(m_src->get_basename());
-    if (!targetDir->query_exists()) {
-        targetDir->make_directory();        // care about permission, user...
+    auto fract = progress.getFraction();
+    if (fract >= 0.0) {
+        m_progress->set_fraction(fract);
     }
-    Glib::RefPtr<Gio::FileEnumerator> enumerat = m_src->enumerate_children(
-              m_copyDialog->getCancelable()
-            , "*"
-            , Gio::FileQueryInfoFlags::FILE_QUERY_INFO_NONE);
-    while (true) {
-        auto fileInfo = enumerat->next_file();
-        if (!fileInfo) {
-            break;
-        }
-        auto childFile = m_src->get_child(fileInfo->get_name());
-        m_copyDialog->addItem(childFile, targetDir);
+    else {
+        m_progress->pulse();    // show as unknown
     }
+    m_progress->set_text(progress.format());
 }
 
-void
-CopyItem::ready(Glib::RefPtr<Gio::AsyncResult>& result)
+VarselList*
+CopyDialog::getWindow()
 {
-    std::cout << "CopyItem::ready " << m_src->get_parse_name() << std::endl;
-    bool success = m_src->copy_finish(result);
-    auto newFile = m_target->get_child(m_src->get_basename());
-    m_copyDialog->notify(newFile, success);
-    // ensure this is the last action here as the reference to this was cleared already
+    return m_varselList;
 }
 
-CopyDialog::CopyDialog(BaseObjectType* cobject
-        , const Glib::RefPtr<Gtk::Builder>& builder
-        , const std::vector<Glib::ustring>& uris
-        , const Glib::RefPtr<Gio::File>& dirs
-        , bool isMove
-        , VarselList* varselList)
-: Gtk::Dialog(cobject)
-, m_dir{dirs}
-, m_isMove{isMove}
-, m_varselList{varselList}
-, m_cancelable{Gio::Cancellable::create()}
+bool
+CopyDialog::isMove()
 {
-    builder->get_widget("target", m_target);
-    builder->get_widget("progress", m_progress);
-    builder->get_widget("text", m_text);
-    builder->get_widget("overwrite", m_overwrite);
-    builder->get_widget("apply", m_apply);
-    m_target->set_text(m_dir->get_parse_name());
-    for (auto uri : uris) {
-        auto file = Gio::File::create_for_uri(uri);
-        addItem(file, m_dir);
-    }
-    m_apply->signal_clicked().connect(sigc::mem_fun(*this, &CopyDialog::apply));
+    return m_isMove;
 }
 
-
 void
-CopyDialog::apply()
+CopyDialog::copyItems(const std::vector<PtrCopyItem>& items)
 {
-    m_apply->set_sensitive(false);
-    auto id = m_overwrite->get_active_id();
-    if (id == "ask") {
-        m_copyMode = std::make_shared<CopyModeAsk>(this);
-    }
-    else if (id == "check") {
-        m_copyMode = std::make_shared<CopyModeCheck>(this);
+    // a single insert for the items, as these may be many
+    Glib::ustring text;
+    for (auto& item : items) {
+        switch (item->getState()) {
+        case CopyState::Copied:
+            if (item->getMessage().empty()) {
+                text += Glib::ustring::sprintf(_("Copied %s (%s)\n")
+                                , item->getTarget()->get_parse_name()
+                                , CopyWorker::getStrategyName(item->getStrategy()));
+            }
+            else {
+                text += Glib::ustring::sprintf(_("Copied %s (%s %s)\n")
+                                , item->getTarget()->get_parse_name()
+                                , CopyWorker::getStrategyName(item->getStrategy())
+                                , item->getMessage());
+            }
+            break;
+        case CopyState::Moved:
+            text += Glib::ustring::sprintf(_("Moved %s (%s)\n")
+                            , item->getTarget()->get_parse_name()
+                            , CopyWorker::getStrategyName(item->getStrategy()));
+            break;
+        case CopyState::Skipped:
+            if (item->getMessage().empty()) {
+                text += Glib::ustring::sprintf(_("Skipped %s\n"), item->getTarget()->get_parse_name());
+            }
+            else {
+                text += Glib::ustring::sprintf(_("Skipped %s %s\n"), item->getTarget()->get_parse_name(), item->getMessage());
+            }
+            break;
+        default:
+            break;
+        }
     }
-    else if (id == "all") {
-        m_copyMode = std::make_shared<CopyModeAll>(this);
+    if (!text.empty()) {
+        showText(text);
     }
-    else {
-        m_copyMode = std::make_shared<CopyModeNo>(this);
-    }
-    next(); // start working
 }
 
-void
-CopyDialog::addItem(const Glib::RefPtr<Gio::File>& src
-        , const Glib::RefPtr<Gio::File>& target)
+Glib::ustring
+CopyDialog::formatInfo(const Glib::RefPtr<Gio::FileInfo>& info)
 {
-    m_copyQueue.emplace(
-            std::make_shared<CopyItem>(src, target, this));
+    if (!info) {
+        return Glib::ustring();
+    }
+    return Glib::ustring::sprintf("%s %s"
+                , Glib::format_size(static_cast<guint64>(info->get_size()))
+                , info->get_modification_date_time().to_local().format("%F %R"));
 }
 
 void
-CopyDialog::progress(goffset current_num_bytes, goffset total_num_bytes)
+CopyDialog::copyConflicts(const std::vector<PtrCopyItem>& items)
 {
-    std::cout << "FileDataSource::progress "
-              << current_num_bytes <<  "/" << total_num_bytes << std::endl;
-    auto part = static_cast<double>(current_num_bytes) / static_cast<double>(total_num_bytes);
-    m_progress->set_fraction(part);
+    for (auto& item : items) {
+        auto iter = m_conflicts->append();
+        auto row = *iter;
+        row.set_value(m_conflictColumns.m_name, item->getTarget()->get_parse_name());
+        row.set_value(m_conflictColumns.m_source, formatInfo(item->getSourceInfo()));
+        row.set_value(m_conflictColumns.m_target, formatInfo(item->getTargetInfo()));
+        row.set_value(m_conflictColumns.m_item, item);
+    }
+    m_conflictBox->show();
 }
 
-VarselList*
-CopyDialog::getWindow()
+void
+CopyDialog::resolve(const PtrCopyMode& decision)
 {
-    return m_varselList;
+    if (!m_copyTask) {
+        return;
+    }
+    std::vector<Gtk::TreeModel::Path> paths = m_conflictView->get_selection()->get_selected_rows();
+    if (paths.empty()) {
+        for (auto& row : m_conflicts->children()) {
+            paths.push_back(m_conflicts->get_path(row));
+        }
+    }
+    std::vector<PtrCopyItem> items;
+    items.reserve(paths.size());
+    // remove from the end, so the paths stay valid
+    for (auto path = paths.rbegin(); path != paths.rend(); ++path) {
+        auto iter = m_conflicts->get_iter(*path);
+        items.push_back(iter->get_value(m_conflictColumns.m_item));
+        m_conflicts->erase(iter);
+    }
+    m_copyTask->resolve(items, decision);
+    if (m_conflicts->children().empty()) {
+        m_conflictBox->hide();
+    }
 }
 
 bool
-CopyDialog::isMove()
-{
-    return m_isMove;
-}
-
-PtrCopyMode
-CopyDialog::getCopyMode()
+CopyDialog::copyFailed(const PtrCopyItem& item)
 {
-    return m_copyMode;
+    auto target = item->getTarget();
+    showText(Glib::ustring::sprintf(_("Error %s writing %s\n"), item->getMessage(), target->get_parse_name()));
+    auto msg = Glib::ustring::sprintf(_("Error writing %s!\nContinue?"), target->get_parse_name());
+    Gtk::MessageDialog msgDlg(*this, msg, false, Gtk::MessageType::MESSAGE_QUESTION, Gtk::ButtonsType::BUTTONS_YES_NO, true);
+    return msgDlg.run() == Gtk::RESPONSE_YES;
 }
 
 void
-CopyDialog::notify(const Glib::RefPtr<Gio::File>& target, bool success)
+CopyDialog::copyDone(const Glib::ustring& msg)
 {
-    if (!success) {
-        auto msg = Glib::ustring::sprintf(_("Error writing %s!\nContinue?"), target->get_parse_name());
-        Gtk::MessageDialog msgDlg(*m_varselList, msg, false, Gtk::MessageType::MESSAGE_QUESTION, Gtk::ButtonsType::BUTTONS_YES_NO, true);
-        if (!msgDlg.run()) {
-            return;
-        }
-        showText(Glib::ustring::sprintf(_("Error %s writing\n"), target->get_parse_name()));
+    if (!msg.empty()) {
+        showText(msg + "\n");
     }
     else {
-        showText(Glib::ustring::sprintf(_("Copied %s\n"), target->get_parse_name()));
+        showText(_("Completed\n"));
+        if (m_isMove) {
+            Gtk::Clipboard::get()->clear();     // the cut sources are gone
+        }
     }
-    next();
-}
-
-Glib::RefPtr<Gio::Cancellable>
-CopyDialog::getCancelable()
-{
-    return m_cancelable;
+    m_progress->set_fraction(1.0);
 }
 
 void
@@ -254,19 +288,17 @@ CopyDialog::showText(const Glib::ustring& text)
 
 
 void
-CopyDialog::next()
+CopyDialog::present(CopyDialog* copyDialog, VarselList* varselList)
 {
-    if (!m_copyQueue.empty()) {
-        m_item = m_copyQueue.front();   // keep the reference around until the next is called
-        m_copyQueue.pop();  // remove the item!
-        m_item->copy();
-    }
-    else {
-        m_item.reset();
-    }
+    copyDialog->set_transient_for(*varselList);
+    varselList->get_application()->add_window(*copyDialog);
+    copyDialog->signal_hide().connect(
+        [copyDialog] {
+            delete copyDialog;
+        });
+    copyDialog->show();
 }
 
-
 void
 CopyDialog::show(
       const std::vector<Glib::ustring>& uris
@@ -279,11 +311,7 @@ CopyDialog::show(
     try {
         builder->add_from_resource(varselList->get_application()->get_resource_base_path() + "/dlgCopy.ui");
         builder->get_widget_derived("dlgCopy", copyDialog, uris, dir, isMove, varselList);
-        copyDialog->set_transient_for(*varselList);
-        if (copyDialog->run() == Gtk::ResponseType::RESPONSE_OK) {
-
-        }
-        delete copyDialog;
+        present(copyDialog, varselList);
     }
     catch (const Glib::Error &ex) {
         //listApp->showMessage(
@@ -294,3 +322,23 @@ CopyDialog::show(
         // , Gtk::MessageType::MESSAGE_WARNING)
     }
 }
+
+void
+CopyDialog::show(
+      const std::shared_ptr<CopyTask>& copyTask
+    , VarselList* varselList)
+{
+    CopyDialog* copyDialog = nullptr;
+    auto builder = Gtk::Builder::create();
+    try {
+        builder->add_from_resource(varselList->get_application()->get_resource_base_path() + "/dlgCopy.ui");
+        builder->get_widget_derived("dlgCopy", copyDialog, copyTask, varselList);
+        present(copyDialog, varselList);
+    }
+    catch (const Glib::Error &ex) {
+        Glib::ustring msg = ex.what();
+        std::cout << psc::fmt::vformat(
+                  _("Error {} loading {}")
+                , psc::fmt::make_format_args(msg, "dlgCopy")) << std::endl;
+    }
+}
@@ -21,132 +21,34 @@
 #include <gtkmm.h>
 #include <memory>
 #include <vector>
-#include <queue>
 
-class VarselList;
-
-class CopyDialog;
-
-class CopyMode
-{
-public:
-    CopyMode(CopyDialog* copyDialog)
-    : m_copyDialog{copyDialog}
-    {
-    }
-    explicit CopyMode(const CopyMode& other) = delete;
-    ~CopyMode() = default;
-
-    virtual bool isOverwrite(
-        const Glib::RefPtr<Gio::File>& src
-        , const Glib::RefPtr<Gio::File>& target) = 0;
-
-protected:
-    CopyDialog* m_copyDialog;
-};
-
-using PtrCopyMode = std::shared_ptr<CopyMode>;
-
-class CopyModeAsk
-: public CopyMode
-{
-public:
-    CopyModeAsk(CopyDialog* copyDialog)
-    : CopyMode(copyDialog)
-    {
-    }
-    explicit CopyModeAsk(const CopyModeAsk& other) = delete;
-    ~CopyModeAsk() = default;
+#include "CopyJob.hpp"
+#include "CopyMode.hpp"
+#include "CopyManager.hpp"
 
-    bool isOverwrite(
-        const Glib::RefPtr<Gio::File>& src
-        , const Glib::RefPtr<Gio::File>& target);
-};
-
-class CopyModeNo
-: public CopyMode
-{
-public:
-    CopyModeNo(CopyDialog* copyDialog)
-    : CopyMode(copyDialog)
-    {
-    }
-    explicit CopyModeNo(const CopyModeNo& other) = delete;
-    ~CopyModeNo() = default;
-
-    bool isOverwrite(
-        const Glib::RefPtr<Gio::File>& src
-        , const Glib::RefPtr<Gio::File>& target) {
-        return false;
-    }
-};
-
-class CopyModeCheck
-: public CopyMode
-{
-public:
-    CopyModeCheck(CopyDialog* copyDialog)
-    : CopyMode(copyDialog)
-    {
-    }
-    explicit CopyModeCheck(const CopyModeCheck& other) = delete;
-    ~CopyModeCheck() = default;
-
-    bool isOverwrite(
-        const Glib::RefPtr<Gio::File>& src
-        , const Glib::RefPtr<Gio::File>& target);
-};
+class VarselList;
 
-class CopyModeAll
-: public CopyMode
+class ConflictColumns
+: public Gtk::TreeModel::ColumnRecord
 {
 public:
-    CopyModeAll(CopyDialog* copyDialog)
-    : CopyMode(copyDialog)
+    ConflictColumns()
     {
+        add(m_name);
+        add(m_source);
+        add(m_target);
+        add(m_item);
     }
-    explicit CopyModeAll(const CopyModeAll& other) = delete;
-    ~CopyModeAll() = default;
 
-    bool isOverwrite(
-        const Glib::RefPtr<Gio::File>& src
-        , const Glib::RefPtr<Gio::File>& target) {
-        return true;
-    }
-};
-
-class CopyItem
-{
-public:
-    CopyItem(const Glib::RefPtr<Gio::File>& src
-            , const Glib::RefPtr<Gio::File>& target
-            , CopyDialog* copyDialog);
-    explicit CopyItem(const CopyItem& other) = delete;
-    ~CopyItem() = default;
-    void copy();
-protected:
-    void ready(Glib::RefPtr<Gio::AsyncResult>& result);
-    void copySymlink();
-    void copyDir();
-    void copyFile();
-
-private:
-    Glib::RefPtr<Gio::File> m_src;
-    Glib::RefPtr<Gio::File> m_target;
-    CopyDialog* m_copyDialog;
-};
-
-using PtrCopyItem = std::shared_ptr<CopyItem>;
-
-enum class Overwrite
-{
-      None
-    , Check
-    , All
+    Gtk::TreeModelColumn<Glib::ustring> m_name;
+    Gtk::TreeModelColumn<Glib::ustring> m_source;
+    Gtk::TreeModelColumn<Glib::ustring> m_target;
+    Gtk::TreeModelColumn<PtrCopyItem> m_item;
 };
 
 class CopyDialog
 : public Gtk::Dialog
+, public CopyListener
 {
 public:
     CopyDialog(BaseObjectType* cobject
@@ -155,40 +57,54 @@ public:
         , const Glib::RefPtr<Gio::File>& dir
         , bool isMove
         , VarselList* varselList);
+    // show a running copy
+    CopyDialog(BaseObjectType* cobject
+        , const Glib::RefPtr<Gtk::Builder>& builder
+        , const std::shared_ptr<CopyTask>& copyTask
+        , VarselList* varselList);
     explicit CopyDialog(const CopyDialog& orig) = delete;
-    virtual ~CopyDialog() = default;
+    virtual ~CopyDialog();
 
-    void next();
-    void notify(const Glib::RefPtr<Gio::File>& target, bool success);
-    Glib::RefPtr<Gio::Cancellable> getCancel();
-    void addItem(const Glib::RefPtr<Gio::File>& src
-        , const Glib::RefPtr<Gio::File>& target);
+    void copyItems(const std::vector<PtrCopyItem>& items) override;
+    void copyProgress(const CopyProgress& progress) override;
+    void copyConflicts(const std::vector<PtrCopyItem>& items) override;
+    bool copyFailed(const PtrCopyItem& item) override;
+    void copyDone(const Glib::ustring& msg) override;
     static void show(
           const std::vector<Glib::ustring>& uris
         , const Glib::RefPtr<Gio::File>& dir
         , bool isMove
         , VarselList* varselList);
-    void progress(goffset current_num_bytes, goffset total_num_bytes);
+    static void show(
+          const std::shared_ptr<CopyTask>& copyTask
+        , VarselList* varselList);
     VarselList* getWindow();
-    Glib::RefPtr<Gio::Cancellable> getCancelable();
     void showText(const Glib::ustring& text);
     bool isMove();
-    PtrCopyMode getCopyMode();
 protected:
+    void setup(const Glib::RefPtr<Gtk::Builder>& builder);
     void apply();
+    void on_response(int response) override;
+    // the dialog stays until closed, the copy continues without
+    static void present(CopyDialog* copyDialog, VarselList* varselList);
+    // for the selected conflicts, or all if none is selected
+    void resolve(const PtrCopyMode& decision);
+    static Glib::ustring formatInfo(const Glib::RefPtr<Gio::FileInfo>& info);
 
     Glib::RefPtr<Gio::File> m_dir;
     const bool m_isMove;
     VarselList* m_varselList;
-    Glib::RefPtr<Gio::Cancellable> m_cancelable;
+    std::vector<Glib::RefPtr<Gio::File>> m_sources;
     Gtk::Label* m_target;
     Gtk::ProgressBar* m_progress;
     Gtk::TextView* m_text;
     Gtk::ComboBoxText* m_overwrite;
     Gtk::Button* m_apply;
-    std::queue<PtrCopyItem> m_copyQueue;
-    PtrCopyItem m_item;
-    PtrCopyMode m_copyMode;
+    Gtk::Box* m_conflictBox;
+    Gtk::TreeView* m_conflictView;
+    ConflictColumns m_conflictColumns;
+    Glib::RefPtr<Gtk::ListStore> m_conflicts;
+    std::shared_ptr<CopyTask> m_copyTask;
 private:
 
 };
@@ -0,0 +1,1685 @@
+/* -*- Mode: c++; c-basic-offset: 4; tab-width: 4; coding: utf-8; -*-  */
+/*
+ * Copyright (C) 2025 RPf
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <algorithm>
+#include <vector>
+#include <cerrno>
+#include <cstring>
+#include <psc_i18n.hpp>
+#include <psc_format.hpp>
+#ifdef __linux__
+#include <fcntl.h>
+#include <linux/fs.h>       // FICLONE
+#include <cstdio>           // renameat2
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <sys/xattr.h>
+#include <unistd.h>
+#endif
+
+#include "CopyMode.hpp"
+#include "CopyJob.hpp"
+
+[[noreturn]] static void
+throwErrno(const Glib::ustring& msg, int err)
+{
+    throw Glib::Error(G_IO_ERROR
+                    , g_io_error_from_errno(err)
+                    , msg + " " + std::strerror(err));
+}
+
+#ifdef __linux__
+static void
+copyXattr(int in, int out)
+{
+    auto size = flistxattr(in, nullptr, 0);
+    if (size <= 0) {
+        return;
+    }
+    std::vector<char> names(static_cast<size_t>(size));
+    size = flistxattr(in, names.data(), names.size());
+    std::vector<char> value;
+    for (ssize_t i = 0; i < size; i += static_cast<ssize_t>(std::strlen(&names[i])) + 1) {
+        const char* name = &names[i];
+        auto len = fgetxattr(in, name, nullptr, 0);
+        if (len < 0) {
+            continue;
+        }
+        value.resize(static_cast<size_t>(len));
+        len = fgetxattr(in, name, value.data(), value.size());
+        if (len >= 0
+         && fsetxattr(out, name, value.data(), static_cast<size_t>(len), 0) != 0) {
+            // e.g. security.* requires privileges, keep what we can
+        }
+    }
+}
+
+// owner, mode, times and xattrs, by descriptor so the target is not looked up again
+static void
+applyAttributes(int in, int out, const GStatBuf& stat)
+{
+    if (fchown(out, stat.st_uid, stat.st_gid) != 0
+     && fchown(out, static_cast<uid_t>(-1), stat.st_gid) != 0) {
+        // as a user only our own groups are allowed
+    }
+    fchmod(out, stat.st_mode & 07777);      // after chown as this may clear set-id
+    struct timespec times[2];
+    times[0] = stat.st_atim;
+    times[1] = stat.st_mtim;
+    futimens(out, times);
+    copyXattr(in, out);
+}
+
+// errors that let us try the next strategy
+static bool
+isUnsupported(int err)
+{
+    return err == EOPNOTSUPP
+        || err == ENOTTY
+        || err == EXDEV
+        || err == EINVAL
+        || err == ENOSYS
+        || err == EBADF;
+}
+#endif
+
+CopyItem::CopyItem(const Glib::RefPtr<Gio::File>& src
+            , const Glib::RefPtr<Gio::File>& targetDir
+            , bool move
+            , const std::shared_ptr<CopyItem>& parent)
+: m_src{src}
+, m_targetDir{targetDir}
+, m_target{targetDir->get_child(src->get_basename())}
+, m_move{move}
+, m_parent{parent}
+, m_fresh{parent && parent->isTargetNew()}
+{
+}
+
+void
+CopyItem::copy(CopyWorker* copyWorker)
+{
+    try {
+        if (m_target->equal(m_src)) {
+            m_state = CopyState::Failed;
+            m_message = _("Source and target are the same");
+        }
+        else if (m_target->has_prefix(m_src)) {
+            m_state = CopyState::Failed;
+            m_message = _("Unable to copy a directory into itself");
+        }
+        else if (m_move
+         && !m_decision
+         && rename(copyWorker, false)) {
+            // moved with anything below
+        }
+        else {
+            copyType(copyWorker);
+        }
+    }
+    catch (const Glib::Error& err) {
+        m_state = CopyState::Failed;
+        m_message = err.what();
+    }
+    if (m_state != CopyState::Conflict) {   // the decision will add it again
+        childDone(m_state == CopyState::Moved
+               || m_state == CopyState::Copied
+               || m_state == CopyState::Created);
+    }
+}
+
+void
+CopyItem::copyType(CopyWorker* copyWorker)
+{
+    auto fileType = Gio::FileType::FILE_TYPE_UNKNOWN;
+#   ifdef __linux__
+    if (m_src->is_native()) {
+        // a single stat for the type, the content and the attributes
+        auto srcPath = m_src->get_path();
+        if (g_lstat(srcPath.c_str(), &m_stat) != 0) {
+            throwErrno(srcPath, errno);
+        }
+        m_statValid = true;
+        fileType = S_ISREG(m_stat.st_mode)
+                    ? Gio::FileType::FILE_TYPE_REGULAR
+                    : S_ISDIR(m_stat.st_mode)
+                    ? Gio::FileType::FILE_TYPE_DIRECTORY
+                    : S_ISLNK(m_stat.st_mode)
+                    ? Gio::FileType::FILE_TYPE_SYMBOLIC_LINK
+                    : Gio::FileType::FILE_TYPE_SPECIAL;
+    }
+#   endif
+    if (!m_statValid) {
+        fileType = m_src->query_file_type(Gio::FileQueryInfoFlags::FILE_QUERY_INFO_NOFOLLOW_SYMLINKS);
+    }
+    if (fileType == Gio::FileType::FILE_TYPE_REGULAR) {
+        copyFile(copyWorker);
+    }
+    else if (fileType == Gio::FileType::FILE_TYPE_DIRECTORY) {
+        copyDir(copyWorker);
+    }
+    else if (fileType == Gio::FileType::FILE_TYPE_SYMBOLIC_LINK) {
+        copySymlink(copyWorker);
+    }
+    else {
+        m_state = CopyState::Skipped;
+        m_message = _("Not a regular file");
+    }
+}
+
+void
+CopyItem::copyFile(CopyWorker* copyWorker)
+{
+    bool existed = !m_fresh
+                && isTargetPresent();
+    if (!checkOverwrite(copyWorker, existed)) {
+        return;
+    }
+    Glib::RefPtr<Gio::FileInfo> before;
+    if (m_move) {
+        if (existed
+         && rename(copyWorker, true)) {     // as decided to overwrite
+            return;
+        }
+        before = m_src->query_info(G_FILE_ATTRIBUTE_STANDARD_SIZE "," G_FILE_ATTRIBUTE_TIME_MODIFIED
+                                 , Gio::FileQueryInfoFlags::FILE_QUERY_INFO_NOFOLLOW_SYMLINKS);
+    }
+    bool claimed{false};
+    if (m_statValid
+     && m_stat.st_nlink > 1
+     && m_target->is_native()) {
+        auto linkTarget = copyWorker->getLinks()->claim(m_stat.st_dev, m_stat.st_ino, m_target->get_path());
+        claimed = linkTarget.empty();
+        if (!claimed
+         && copyLink(copyWorker, linkTarget, existed)) {
+            if (m_move) {
+                verifyMove(before, existed);
+            }
+            return;
+        }
+    }
+    try {
+        if (existed
+         && m_src->is_native()
+         && m_target->is_native()
+         && copyWorker->getCopyMode()->isDelta()
+         && copyDelta(copyWorker)) {
+            m_state = CopyState::Copied;
+        }
+        else if (m_src->is_native()
+         && m_target->is_native()
+         && copyKernel(copyWorker)) {
+            m_state = CopyState::Copied;
+        }
+        else {
+            copyGio(copyWorker);
+            m_state = CopyState::Copied;
+        }
+        if (claimed) {
+            copyWorker->getLinks()->ready(m_stat.st_dev, m_stat.st_ino, true);
+        }
+    }
+    catch (const Glib::Error&) {
+        if (claimed) {
+            copyWorker->getLinks()->ready(m_stat.st_dev, m_stat.st_ino, false);
+        }
+        if (!existed
+         && isTargetPresent()) {
+            m_target->remove();         // don't keep incomplete result
+        }
+        throw;
+    }
+    if (m_move) {
+        verifyMove(before, existed);
+    }
+}
+
+void
+CopyItem::copyGio(CopyWorker* copyWorker)
+{
+    m_strategy = CopyStrategy::Gio;
+    // as the kernel copy, only replace the target if the copy completed
+    auto part = getPartFile();
+    goffset copied{0};
+    try {
+        m_src->copy(part
+                  , [&] (goffset current, goffset total) {
+                        copyWorker->addBytes(current - copied);
+                        copyWorker->throttle(current - copied);
+                        copied = current;
+                    }
+                  , copyWorker->getCancellable()
+                  , Gio::FILE_COPY_OVERWRITE | Gio::FILE_COPY_NOFOLLOW_SYMLINKS | Gio::FILE_COPY_ALL_METADATA);
+        part->move(m_target
+                 , Gio::FILE_COPY_OVERWRITE | Gio::FILE_COPY_NOFOLLOW_SYMLINKS);
+    }
+    catch (const Glib::Error&) {
+        if (part->query_exists()) {
+            part->remove();
+        }
+        throw;
+    }
+}
+
+bool
+CopyItem::checkOverwrite(CopyWorker* copyWorker, bool existed)
+{
+    if (!existed) {
+        return true;
+    }
+    if (copyWorker->isResume()) {
+        auto part = getPartFile();
+        if (part->query_exists()) {
+            // this was in flight when the copy stopped, so complete it regardless of the mode
+            part->remove();
+            m_message = _("incomplete before");
+            return true;
+        }
+    }
+    if (copyWorker->isResume()
+     && isComplete()) {
+        if (m_move) {
+            m_src->remove();    // the copy was verified, but the source kept
+            m_state = CopyState::Moved;
+        }
+        else {
+            m_state = CopyState::Skipped;
+            m_message = _("completed before");
+        }
+        copyWorker->addBytes(getSize());    // count as done
+        return false;
+    }
+    auto copyMode = m_decision
+                    ? m_decision
+                    : copyWorker->getCopyMode();
+    if (copyMode->isInteractive()) {
+        // what is needed for the decision, as the main thread shall not wait for io
+        m_srcInfo = m_src->query_info(G_FILE_ATTRIBUTE_STANDARD_SIZE "," G_FILE_ATTRIBUTE_TIME_MODIFIED
+                                    , Gio::FileQueryInfoFlags::FILE_QUERY_INFO_NOFOLLOW_SYMLINKS);
+        m_targetInfo = m_target->query_info(G_FILE_ATTRIBUTE_STANDARD_SIZE "," G_FILE_ATTRIBUTE_TIME_MODIFIED
+                                    , Gio::FileQueryInfoFlags::FILE_QUERY_INFO_NOFOLLOW_SYMLINKS);
+        m_state = CopyState::Conflict;
+        copyWorker->hold();     // the decision will add this again
+        return false;
+    }
+    if (!copyMode->isOverwrite(m_src, m_target)) {
+        m_state = CopyState::Skipped;
+        copyWorker->addBytes(getSize());    // count as done
+        return false;
+    }
+    return true;
+}
+
+bool
+CopyItem::isTargetPresent()
+{
+    return m_target->query_file_type(Gio::FileQueryInfoFlags::FILE_QUERY_INFO_NOFOLLOW_SYMLINKS)
+            != Gio::FileType::FILE_TYPE_UNKNOWN;
+}
+
+Glib::RefPtr<Gio::File>
+CopyItem::getPartFile()
+{
+    return m_targetDir->get_child("." + m_src->get_basename() + PART_SUFFIX);
+}
+
+bool
+CopyItem::isComplete()
+{
+#   ifdef __linux__
+    GStatBuf targetStat;
+    if (m_statValid
+     && m_target->is_native()
+     && g_lstat(m_target->get_path().c_str(), &targetStat) == 0) {
+        // the times are set after the content, so equal times tell it was completed
+        return targetStat.st_size == m_stat.st_size
+            && targetStat.st_mtim.tv_sec == m_stat.st_mtim.tv_sec
+            && targetStat.st_mtim.tv_nsec == m_stat.st_mtim.tv_nsec;
+    }
+#   endif
+    return false;
+}
+
+bool
+CopyItem::copyLink(CopyWorker* copyWorker, const std::string& linkTarget, bool existed)
+{
+#   ifdef __linux__
+    auto targetPath = m_target->get_path();
+    if (existed) {
+        unlink(targetPath.c_str());
+    }
+    if (link(linkTarget.c_str(), targetPath.c_str()) != 0) {
+        if (errno == EXDEV
+         || errno == EPERM
+         || errno == EMLINK) {
+            return false;   // copy the content
+        }
+        throwErrno(targetPath, errno);
+    }
+    copyWorker->addBytes(m_stat.st_size);
+    m_strategy = CopyStrategy::Link;
+    m_state = CopyState::Copied;
+    return true;
+#   else
+    return false;
+#   endif
+}
+
+void
+CopyItem::verifyMove(const Glib::RefPtr<Gio::FileInfo>& before, bool existed)
+{
+    auto after = m_src->query_info(G_FILE_ATTRIBUTE_STANDARD_SIZE "," G_FILE_ATTRIBUTE_TIME_MODIFIED
+                                 , Gio::FileQueryInfoFlags::FILE_QUERY_INFO_NOFOLLOW_SYMLINKS);
+    auto target = m_target->query_info(G_FILE_ATTRIBUTE_STANDARD_SIZE
+                                     , Gio::FileQueryInfoFlags::FILE_QUERY_INFO_NOFOLLOW_SYMLINKS);
+    if (target->get_size() != before->get_size()
+     || after->get_size() != before->get_size()
+     || after->get_modification_date_time().compare(before->get_modification_date_time()) != 0) {
+        // roll back this item, the source stays as it was
+        if (!existed) {
+            m_target->remove();
+        }
+        m_state = CopyState::Failed;
+        m_message = _("Changed while moving, the source was kept");
+        return;
+    }
+    m_src->remove();
+    m_state = CopyState::Moved;
+}
+
+bool
+CopyItem::rename(CopyWorker* copyWorker, bool overwrite)
+{
+#   ifdef __linux__
+    if (!m_src->is_native()
+     || !m_target->is_native()) {
+        return renameGio(copyWorker, overwrite);
+    }
+    auto srcPath = m_src->get_path();
+    auto targetPath = m_target->get_path();
+    int ret = renameat2(AT_FDCWD, srcPath.c_str()
+                      , AT_FDCWD, targetPath.c_str()
+                      , overwrite ? 0 : RENAME_NOREPLACE);
+    if (ret != 0
+     && !overwrite
+     && (errno == EINVAL || errno == ENOSYS)) {
+        // the filesystem is unable to check for us
+        if (m_target->query_exists()) {
+            return false;
+        }
+        ret = ::rename(srcPath.c_str(), targetPath.c_str());
+    }
+    if (ret == 0) {
+        m_state = CopyState::Moved;
+        m_strategy = CopyStrategy::Rename;
+        return true;
+    }
+    int err = errno;
+    if (err == EXDEV            // copy between filesystems
+     || err == EEXIST           // decide or merge
+     || err == ENOTEMPTY
+     || err == EISDIR
+     || err == ENOTDIR) {
+        return false;
+    }
+    throwErrno(targetPath, err);
+#   else
+    return renameGio(copyWorker, overwrite);
+#   endif
+}
+
+bool
+CopyItem::renameGio(CopyWorker* copyWorker, bool overwrite)
+{
+    auto flags = Gio::FILE_COPY_NO_FALLBACK_FOR_MOVE | Gio::FILE_COPY_NOFOLLOW_SYMLINKS;
+    if (overwrite) {
+        flags |= Gio::FILE_COPY_OVERWRITE;
+    }
+    try {
+        m_src->move(m_target, copyWorker->getCancellable(), flags);
+    }
+    catch (const Gio::Error& err) {
+        if (err.code() == Gio::Error::NOT_SUPPORTED
+         || err.code() == Gio::Error::EXISTS
+         || err.code() == Gio::Error::IS_DIRECTORY
+         || err.code() == Gio::Error::WOULD_MERGE
+         || err.code() == Gio::Error::WOULD_RECURSE) {
+            return false;
+        }
+        throw;
+    }
+    m_state = CopyState::Moved;
+    m_strategy = CopyStrategy::Rename;
+    return true;
+}
+
+void
+CopyItem::childDone(bool success)
+{
+    if (!success) {
+        m_incomplete = true;
+    }
+    if (--m_pending > 0) {
+        return;
+    }
+    // the item and all below are done
+    if (m_state == CopyState::Created) {
+        applyDirAttributes();   // now the children no longer change it
+    }
+    if (m_move
+     && m_state == CopyState::Created
+     && !m_incomplete) {
+        try {
+            m_src->remove();    // now empty
+        }
+        catch (const Glib::Error& err) {
+            std::cout << "CopyItem::childDone error " << err.what() << std::endl;
+            m_incomplete = true;
+        }
+    }
+    if (m_parent) {
+        m_parent->childDone(!m_incomplete);
+        m_parent.reset();       // release the tree as we go
+    }
+}
+
+void
+CopyItem::applyDirAttributes()
+{
+#   ifdef __linux__
+    if (!m_statValid
+     || !m_target->is_native()) {
+        return;
+    }
+    auto srcPath = m_src->get_path();
+    auto targetPath = m_target->get_path();
+    int in = open(srcPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    int out = open(targetPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (in >= 0
+     && out >= 0) {
+        applyAttributes(in, out, m_stat);
+    }
+    if (in >= 0) {
+        close(in);
+    }
+    if (out >= 0) {
+        close(out);
+    }
+#   endif
+}
+
+bool
+CopyItem::copyKernel(CopyWorker* copyWorker)
+{
+#   ifdef __linux__
+    auto strategy = copyWorker->getStrategy();
+    if (strategy >= CopyStrategy::Gio) {
+        return false;
+    }
+    if (!m_statValid) {
+        return false;
+    }
+    auto srcPath = m_src->get_path();
+    int in = open(srcPath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in < 0) {
+        throwErrno(srcPath, errno);
+    }
+    const auto& srcStat = m_stat;
+    auto targetPath = m_target->get_path();
+    // write beside, so a existing target (or where a link points to) is kept until complete
+    auto partPath = getPartFile()->get_path();
+    unlink(partPath.c_str());   // left by a interrupted copy
+    int out = open(partPath.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, srcStat.st_mode & 0777);
+    if (out < 0) {
+        int err = errno;
+        close(in);
+        throwErrno(partPath, err);
+    }
+    auto cancellable = copyWorker->getCancellable();
+    off_t offset{0};
+    int err{0};
+    if (strategy == CopyStrategy::Reflink) {
+        if (ioctl(out, FICLONE, in) == 0) {
+            offset = srcStat.st_size;
+            copyWorker->addBytes(offset);
+            m_strategy = CopyStrategy::Reflink;
+        }
+        else if (isUnsupported(errno)) {
+            copyWorker->unsupported(CopyStrategy::Reflink);
+            strategy = CopyStrategy::CopyRange;
+        }
+        else {
+            err = errno;
+        }
+    }
+    if (strategy == CopyStrategy::CopyRange
+     && err == 0
+     && m_strategy == CopyStrategy::None) {
+        while (offset < srcStat.st_size
+            && !cancellable->is_cancelled()) {
+            auto chunk = copyWorker->getChunk(CopyWorker::KERNEL_CHUNK);
+            copyWorker->throttle(static_cast<goffset>(chunk));
+            auto len = copy_file_range(in, nullptr, out, nullptr, chunk, 0);
+            if (len < 0) {
+                if (offset == 0
+                 && isUnsupported(errno)) {
+                    copyWorker->unsupported(CopyStrategy::CopyRange);
+                    strategy = CopyStrategy::Sendfile;
+                }
+                else {
+                    err = errno;
+                }
+                break;
+            }
+            if (len == 0) {     // the source was truncated
+                break;
+            }
+            offset += len;
+            copyWorker->addBytes(len);
+            m_strategy = CopyStrategy::CopyRange;
+        }
+    }
+    if (strategy == CopyStrategy::Sendfile
+     && err == 0
+     && m_strategy == CopyStrategy::None) {
+        while (offset < srcStat.st_size
+            && !cancellable->is_cancelled()) {
+            auto chunk = copyWorker->getChunk(CopyWorker::KERNEL_CHUNK);
+            copyWorker->throttle(static_cast<goffset>(chunk));
+            auto len = sendfile(out, in, &offset, chunk);
+            if (len < 0) {
+                if (offset == 0
+                 && isUnsupported(errno)) {
+                    copyWorker->unsupported(CopyStrategy::Sendfile);
+                    strategy = CopyStrategy::Gio;
+                }
+                else {
+                    err = errno;
+                }
+                break;
+            }
+            if (len == 0) {
+                break;
+            }
+            copyWorker->addBytes(len);
+            m_strategy = CopyStrategy::Sendfile;
+        }
+    }
+    if (srcStat.st_size == 0
+     && err == 0
+     && strategy < CopyStrategy::Gio) {
+        m_strategy = strategy;      // nothing to copy, created is fine
+    }
+    if (err == 0
+     && m_strategy != CopyStrategy::None) {
+        applyAttributes(in, out, srcStat);
+    }
+    close(in);
+    if (close(out) != 0
+     && err == 0) {
+        err = errno;
+    }
+    if (err == 0
+     && m_strategy != CopyStrategy::None
+     && !cancellable->is_cancelled()
+     && ::rename(partPath.c_str(), targetPath.c_str()) != 0) {
+        err = errno;    // replaces a link, not what it points to
+    }
+    if (err != 0
+     || cancellable->is_cancelled()
+     || m_strategy == CopyStrategy::None) {
+        unlink(partPath.c_str());       // only what this copy created
+        if (err != 0) {
+            throwErrno(targetPath, err);
+        }
+        if (cancellable->is_cancelled()) {
+            throw Gio::Error(Gio::Error::CANCELLED, _("Copy canceled"));
+        }
+    }
+    return m_strategy != CopyStrategy::None;
+#   else
+    return false;
+#   endif
+}
+
+bool
+CopyItem::copyDelta(CopyWorker* copyWorker)
+{
+#   ifdef __linux__
+    if (!m_statValid) {
+        return false;
+    }
+    auto srcPath = m_src->get_path();
+    int in = open(srcPath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in < 0) {
+        throwErrno(srcPath, errno);
+    }
+    const auto& srcStat = m_stat;
+    auto targetPath = m_target->get_path();
+    GStatBuf targetStat;
+    if (g_lstat(targetPath.c_str(), &targetStat) != 0
+     || !S_ISREG(targetStat.st_mode)
+     || targetStat.st_nlink > 1) {
+        close(in);
+        return false;   // e.g. a link or hard linked (would change the other names), is replaced by the kernel copy
+    }
+    int out = open(targetPath.c_str(), O_RDWR | O_NOFOLLOW | O_CLOEXEC);
+    if (out < 0) {
+        int err = errno;
+        close(in);
+        if (err == EACCES
+         || err == EPERM
+         || err == ELOOP) {
+            return false;   // e.g. read only, the kernel copy replaces it with a new file
+        }
+        throwErrno(targetPath, err);
+    }
+    // the target is updated in place, mark it so a resume completes it
+    auto partPath = getPartFile()->get_path();
+    int mark = open(partPath.c_str(), O_WRONLY | O_CREAT | O_NOFOLLOW | O_CLOEXEC, 0600);
+    if (mark >= 0) {
+        close(mark);
+    }
+    posix_fadvise(in, 0, 0, POSIX_FADV_SEQUENTIAL);
+    posix_fadvise(out, 0, 0, POSIX_FADV_SEQUENTIAL);
+    // both are local, so comparing the blocks is cheaper than
+    //   checksums, memcmp is vectorized by the libc
+    std::vector<char> srcBlock(CopyWorker::DELTA_BLOCK);
+    std::vector<char> targetBlock(CopyWorker::DELTA_BLOCK);
+    auto cancellable = copyWorker->getCancellable();
+    off_t offset{0};
+    goffset written{0};
+    int err{0};
+    while (offset < srcStat.st_size
+        && !cancellable->is_cancelled()) {
+        copyWorker->throttle(static_cast<goffset>(srcBlock.size() + targetBlock.size()));  // both are read
+        auto len = pread(in, srcBlock.data(), srcBlock.size(), offset);
+        if (len <= 0) {
+            err = len < 0 ? errno : 0;
+            break;
+        }
+        auto targetLen = pread(out, targetBlock.data(), static_cast<size_t>(len), offset);
+        if (targetLen < 0) {
+            err = errno;
+            break;
+        }
+        if (targetLen != len
+         || std::memcmp(srcBlock.data(), targetBlock.data(), static_cast<size_t>(len)) != 0) {
+            if (pwrite(out, srcBlock.data(), static_cast<size_t>(len), offset) != len) {
+                err = errno != 0 ? errno : EIO;
+                break;
+            }
+            written += len;
+        }
+        offset += len;
+        copyWorker->addBytes(len);
+    }
+    if (err == 0
+     && !cancellable->is_cancelled()) {
+        if (ftruncate(out, srcStat.st_size) != 0) {     // if it was longer
+            err = errno;
+        }
+        else {
+            // keep the modification, so a unchanged file is skipped next time
+            applyAttributes(in, out, srcStat);
+        }
+    }
+    close(in);
+    if (close(out) != 0
+     && err == 0) {
+        err = errno;
+    }
+    if (err != 0) {
+        throwErrno(targetPath, err);    // the target is partially updated, so report it as failed
+    }
+    if (cancellable->is_cancelled()) {
+        throw Gio::Error(Gio::Error::CANCELLED, _("Copy canceled"));
+    }
+    unlink(partPath.c_str());
+    m_strategy = CopyStrategy::Delta;
+    m_message = Glib::ustring::sprintf(_("%s written"), Glib::format_size(static_cast<guint64>(written)));
+    return true;
+#   else
+    return false;
+#   endif
+}
+
+void
+CopyItem::copySymlink(CopyWorker* copyWorker)
+{
+    // a link that points nowhere exists as well
+    bool existed = !m_fresh
+                && m_target->query_file_type(Gio::FileQueryInfoFlags::FILE_QUERY_INFO_NOFOLLOW_SYMLINKS) != Gio::FileType::FILE_TYPE_UNKNOWN;
+    if (!checkOverwrite(copyWorker, existed)) {
+        return;
+    }
+    auto info = m_src->query_info(G_FILE_ATTRIBUTE_STANDARD_SYMLINK_TARGET
+                                , Gio::FileQueryInfoFlags::FILE_QUERY_INFO_NOFOLLOW_SYMLINKS);
+    if (existed) {
+        m_target->remove();
+    }
+    m_target->make_symbolic_link(info->get_symlink_target());
+#   ifdef __linux__
+    if (m_statValid
+     && m_target->is_native()) {
+        auto targetPath = m_target->get_path();
+        if (lchown(targetPath.c_str(), m_stat.st_uid, m_stat.st_gid) != 0) {
+            // as a user keep our own
+        }
+        struct timespec times[2];
+        times[0] = m_stat.st_atim;
+        times[1] = m_stat.st_mtim;
+        utimensat(AT_FDCWD, targetPath.c_str(), times, AT_SYMLINK_NOFOLLOW);
+    }
+#   endif
+    if (m_move) {
+        m_src->remove();
+        m_state = CopyState::Moved;
+    }
+    else {
+        m_state = CopyState::Copied;
+    }
+}
+
+void
+CopyItem::copyDir(CopyWorker* copyWorker)
+{
+    if (m_fresh
+     || !m_target->query_exists()) {
+        // the attributes are set when the children are done,
+        //   so a read only directory can be filled
+        m_target->make_directory();
+        m_targetNew = true;
+    }
+    // the children are added when the target exists
+    auto enumerat = m_src->enumerate_children(
+              copyWorker->getCancellable()
+            , G_FILE_ATTRIBUTE_STANDARD_NAME
+            , Gio::FileQueryInfoFlags::FILE_QUERY_INFO_NOFOLLOW_SYMLINKS);
+    while (true) {
+        auto fileInfo = enumerat->next_file();
+        if (!fileInfo) {
+            break;
+        }
+        ++m_pending;    // before it may complete
+        copyWorker->add(m_src->get_child(fileInfo->get_name()), shared_from_this());
+    }
+    enumerat->close();
+    m_state = CopyState::Created;
+}
+
+Glib::RefPtr<Gio::File>
+CopyItem::getSource()
+{
+    return m_src;
+}
+
+Glib::RefPtr<Gio::File>
+CopyItem::getTarget()
+{
+    return m_target;
+}
+
+CopyState
+CopyItem::getState()
+{
+    return m_state;
+}
+
+CopyStrategy
+CopyItem::getStrategy()
+{
+    return m_strategy;
+}
+
+const Glib::ustring&
+CopyItem::getMessage()
+{
+    return m_message;
+}
+
+goffset
+CopyItem::getSize()
+{
+    try {
+        auto info = m_src->query_info(G_FILE_ATTRIBUTE_STANDARD_SIZE
+                                    , Gio::FileQueryInfoFlags::FILE_QUERY_INFO_NOFOLLOW_SYMLINKS);
+        return info->get_size();
+    }
+    catch (const Glib::Error& err) {
+        std::cout << "CopyItem::getSize error " << err.what() << std::endl;
+    }
+    return 0;
+}
+
+void
+CopyItem::setDecision(const PtrCopyMode& decision)
+{
+    m_decision = decision;
+    m_state = CopyState::Pending;
+}
+
+Glib::RefPtr<Gio::FileInfo>
+CopyItem::getSourceInfo()
+{
+    return m_srcInfo;
+}
+
+Glib::RefPtr<Gio::FileInfo>
+CopyItem::getTargetInfo()
+{
+    return m_targetInfo;
+}
+
+bool
+CopyItem::isMove()
+{
+    return m_move;
+}
+
+bool
+CopyItem::isTargetNew()
+{
+    return m_targetNew;
+}
+
+std::string
+CopyLinks::claim(guint64 dev, guint64 ino, const std::string& target)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    auto key = std::pair(dev, ino);
+    auto entry = m_links.find(key);
+    if (entry == m_links.end()) {
+        Link link;
+        link.target = target;
+        m_links.insert(std::pair(key, link));
+        return std::string();
+    }
+    // the claiming worker is copying, so this will not wait long
+    m_condition.wait(lock, [&] {
+        return m_links[key].ready;
+    });
+    auto& link = m_links[key];
+    return link.success ? link.target : std::string();
+}
+
+void
+CopyLinks::ready(guint64 dev, guint64 ino, bool success)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto& link = m_links[std::pair(dev, ino)];
+        link.ready = true;
+        link.success = success;
+    }
+    m_condition.notify_all();
+}
+
+void
+CopyQueue::push(const PtrCopyItem& item)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_items.push_back(item);
+        ++m_added;
+    }
+    m_condition.notify_one();
+}
+
+PtrCopyItem
+CopyQueue::pop()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    // a item in work may still add its children
+    m_condition.wait(lock, [&] {
+        return m_cancel || !m_items.empty() || m_active == 0;
+    });
+    if (m_cancel
+     || m_items.empty()) {
+        m_condition.notify_all();   // let the others end as well
+        return PtrCopyItem();
+    }
+    auto item = m_items.front();
+    m_items.pop_front();
+    ++m_active;
+    return item;
+}
+
+void
+CopyQueue::done()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        --m_active;
+    }
+    m_condition.notify_all();
+}
+
+void
+CopyQueue::hold()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_active;
+}
+
+void
+CopyQueue::release()
+{
+    done();
+}
+
+void
+CopyQueue::cancel()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_cancel = true;
+        m_items.clear();
+    }
+    m_condition.notify_all();
+}
+
+size_t
+CopyQueue::getAdded()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_added;
+}
+
+void
+CopyQueue::addBytes(goffset bytes)
+{
+    m_bytes += bytes;
+}
+
+goffset
+CopyQueue::getBytes()
+{
+    return m_bytes;
+}
+
+CopyWorker::CopyWorker(const std::shared_ptr<CopyQueue>& queue
+             , const std::shared_ptr<CopyLinks>& links
+             , const PtrCopyMode& copyMode
+             , const Glib::RefPtr<Gio::Cancellable>& cancellable
+             , bool resume
+             , CopyJob* copyJob)
+: ThreadWorker()
+, m_queue{queue}
+, m_links{links}
+, m_copyMode{copyMode}
+, m_cancellable{cancellable}
+, m_resume{resume}
+, m_ioScheduler{IoScheduler::get()}
+, m_copyJob{copyJob}
+{
+}
+
+void
+CopyWorker::detach()
+{
+    m_copyJob = nullptr;    // as we are called from main thread this is safe
+}
+
+void
+CopyWorker::add(const Glib::RefPtr<Gio::File>& src
+           , const std::shared_ptr<CopyItem>& parent)
+{
+    m_queue->push(std::make_shared<CopyItem>(src, parent->getTarget(), parent->isMove(), parent));
+}
+
+void
+CopyWorker::hold()
+{
+    m_queue->hold();
+}
+
+void
+CopyWorker::addBytes(goffset bytes)
+{
+    m_queue->addBytes(bytes);
+}
+
+PtrCopyMode
+CopyWorker::getCopyMode()
+{
+    return m_copyMode;
+}
+
+Glib::RefPtr<Gio::Cancellable>
+CopyWorker::getCancellable()
+{
+    return m_cancellable;
+}
+
+std::shared_ptr<CopyLinks>
+CopyWorker::getLinks()
+{
+    return m_links;
+}
+
+bool
+CopyWorker::isResume()
+{
+    return m_resume;
+}
+
+size_t
+CopyWorker::getChunk(size_t preferred)
+{
+    return m_ioScheduler->getChunk(preferred);
+}
+
+void
+CopyWorker::throttle(goffset bytes)
+{
+    m_ioScheduler->acquire(bytes, m_cancellable);
+}
+
+CopyStrategy
+CopyWorker::getStrategy()
+{
+    return m_strategy;
+}
+
+void
+CopyWorker::unsupported(CopyStrategy strategy)
+{
+    // a job copies mostly between the same filesystems,
+    //   so don't try again for each item
+    if (strategy >= m_strategy) {
+        m_strategy = static_cast<CopyStrategy>(static_cast<int>(strategy) + 1);
+    }
+}
+
+const char*
+CopyWorker::getStrategyName(CopyStrategy strategy)
+{
+    switch (strategy) {
+    case CopyStrategy::Rename:
+        return "rename";
+    case CopyStrategy::Delta:
+        return "delta";
+    case CopyStrategy::Link:
+        return "hardlink";
+    case CopyStrategy::Reflink:
+        return "reflink";
+    case CopyStrategy::CopyRange:
+        return "copy_file_range";
+    case CopyStrategy::Sendfile:
+        return "sendfile";
+    case CopyStrategy::Gio:
+        return "gio";
+    default:
+        break;
+    }
+    return "";
+}
+
+size_t
+CopyWorker::doInBackground()
+{
+    size_t count{0};
+    while (true) {
+        auto item = m_queue->pop();
+        if (!item) {
+            break;
+        }
+        item->copy(this);
+        notify(item);
+        m_queue->done();
+        ++count;
+    }
+    return count;
+}
+
+void
+CopyWorker::process(const std::vector<PtrCopyItem>& items)
+{
+    // here we are back to main thread ...
+    if (m_copyJob) {
+        m_copyJob->itemsDone(items);
+    }
+}
+
+void
+CopyWorker::done()
+{
+    Glib::ustring msg;
+    size_t count{0};
+    try {
+        count = getResult();
+    }
+    catch (const Glib::Error& err) {
+        msg = err.what();
+    }
+    catch (const std::exception& exc) {
+        msg = exc.what();
+    }
+    if (m_copyJob) {
+        m_copyJob->workerDone(count, msg);
+    }
+}
+
+void
+CopyScan::add(const Glib::RefPtr<Gio::File>& file)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_dirs.push_back(file);
+    }
+    m_condition.notify_one();
+}
+
+Glib::RefPtr<Gio::File>
+CopyScan::pop()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_condition.wait(lock, [&] {
+        return m_cancel || !m_dirs.empty() || m_active == 0;
+    });
+    if (m_cancel
+     || m_dirs.empty()) {
+        m_condition.notify_all();
+        return Glib::RefPtr<Gio::File>();
+    }
+    auto dir = m_dirs.front();
+    m_dirs.pop_front();
+    ++m_active;
+    return dir;
+}
+
+void
+CopyScan::done()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        --m_active;
+    }
+    m_condition.notify_all();
+}
+
+void
+CopyScan::cancel()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_cancel = true;
+        m_dirs.clear();
+    }
+    m_condition.notify_all();
+}
+
+void
+CopyScan::count(size_t files, goffset bytes)
+{
+    m_files += files;
+    m_bytes += bytes;
+}
+
+size_t
+CopyScan::getFiles()
+{
+    return m_files;
+}
+
+goffset
+CopyScan::getBytes()
+{
+    return m_bytes;
+}
+
+CopyScanWorker::CopyScanWorker(const std::shared_ptr<CopyScan>& scan
+                 , const Glib::RefPtr<Gio::Cancellable>& cancellable
+                 , CopyJob* copyJob)
+: ThreadWorker()
+, m_scan{scan}
+, m_cancellable{cancellable}
+, m_copyJob{copyJob}
+{
+}
+
+void
+CopyScanWorker::detach()
+{
+    m_copyJob = nullptr;    // as we are called from main thread this is safe
+}
+
+size_t
+CopyScanWorker::doInBackground()
+{
+    size_t count{0};
+    while (true) {
+        auto dir = m_scan->pop();
+        if (!dir) {
+            break;
+        }
+        size_t files{0};
+        goffset bytes{0};
+        try {
+            auto enumerat = dir->enumerate_children(
+                      m_cancellable
+                    , G_FILE_ATTRIBUTE_STANDARD_NAME "," G_FILE_ATTRIBUTE_STANDARD_TYPE "," G_FILE_ATTRIBUTE_STANDARD_SIZE
+                    , Gio::FileQueryInfoFlags::FILE_QUERY_INFO_NOFOLLOW_SYMLINKS);
+            while (true) {
+                auto fileInfo = enumerat->next_file();
+                if (!fileInfo) {
+                    break;
+                }
+                ++files;
+                if (fileInfo->get_file_type() == Gio::FileType::FILE_TYPE_DIRECTORY) {
+                    m_scan->add(dir->get_child(fileInfo->get_name()));
+                }
+                else if (fileInfo->get_file_type() == Gio::FileType::FILE_TYPE_REGULAR) {
+                    bytes += fileInfo->get_size();
+                }
+                if (files >= COUNT_BATCH) {
+                    m_scan->count(files, bytes);
+                    count += files;
+                    files = 0;
+                    bytes = 0;
+                }
+            }
+            enumerat->close();
+        }
+        catch (const Glib::Error& err) {    // the copy will report
+            std::cout << "CopyScanWorker::doInBackground error " << err.what() << std::endl;
+        }
+        m_scan->count(files, bytes);
+        count += files;
+        m_scan->done();
+    }
+    return count;
+}
+
+void
+CopyScanWorker::process(const std::vector<int>& dummy)
+{
+    // the counts are read with the progress
+}
+
+void
+CopyScanWorker::done()
+{
+    size_t count{0};
+    try {
+        count = getResult();
+    }
+    catch (const std::exception& exc) {
+        std::cout << "CopyScanWorker::done error " << exc.what() << std::endl;
+    }
+    if (m_copyJob) {
+        m_copyJob->scanDone(count);
+    }
+}
+
+double
+CopyProgress::getFraction() const
+{
+    if (bytesTotal > 0) {
+        return std::min(static_cast<double>(bytesDone) / static_cast<double>(bytesTotal), 1.0);
+    }
+    if (filesTotal > 0) {
+        return std::min(static_cast<double>(filesDone) / static_cast<double>(filesTotal), 1.0);
+    }
+    return -1.0;
+}
+
+double
+CopyProgress::getThroughput() const
+{
+    if (elapsedUs <= 0) {
+        return 0.0;
+    }
+    return static_cast<double>(bytesDone) * 1.0e6 / static_cast<double>(elapsedUs);
+}
+
+double
+CopyProgress::getFilesPerSecond() const
+{
+    if (elapsedUs <= 0) {
+        return 0.0;
+    }
+    return static_cast<double>(filesDone) * 1.0e6 / static_cast<double>(elapsedUs);
+}
+
+double
+CopyProgress::getEta() const
+{
+    if (!totalComplete) {
+        return -1.0;
+    }
+    // small files are limited by their count, large by the bytes
+    double eta{-1.0};
+    auto throughput = getThroughput();
+    if (bytesTotal > 0
+     && throughput > 0.0) {
+        eta = std::max(static_cast<double>(bytesTotal - bytesDone), 0.0) / throughput;
+    }
+    auto filesPerSecond = getFilesPerSecond();
+    if (filesTotal > 0
+     && filesPerSecond > 0.0) {
+        eta = std::max(eta, static_cast<double>(filesTotal - std::min(filesDone, filesTotal)) / filesPerSecond);
+    }
+    return eta;
+}
+
+Glib::ustring
+CopyProgress::format() const
+{
+    Glib::ustring done = Glib::format_size(static_cast<guint64>(bytesDone));
+    Glib::ustring throughput = Glib::format_size(static_cast<guint64>(getThroughput()));
+    auto filesPerSecond = static_cast<int>(getFilesPerSecond() + 0.5);
+    auto eta = getEta();
+    if (eta < 0.0) {
+        return psc::fmt::vformat(_("{} files {}, {}/s, {} files/s")
+                    , psc::fmt::make_format_args(filesDone, done, throughput, filesPerSecond));
+    }
+    Glib::ustring total = Glib::format_size(static_cast<guint64>(bytesTotal));
+    auto seconds = static_cast<int>(eta + 0.5);
+    Glib::ustring remain = Glib::ustring::sprintf("%d:%02d", seconds / 60, seconds % 60);
+    auto text = psc::fmt::vformat(_("{} of {} files {} of {}, {}/s, {} files/s, {} left")
+                    , psc::fmt::make_format_args(filesDone, filesTotal, done, total, throughput, filesPerSecond, remain));
+    if (conflicts > 0) {
+        text += psc::fmt::vformat(_(", {} conflicts"), psc::fmt::make_format_args(conflicts));
+    }
+    return text;
+}
+
+CopyJob::CopyJob(const std::vector<Glib::RefPtr<Gio::File>>& sources
+          , const Glib::RefPtr<Gio::File>& dir
+          , bool move
+          , const PtrCopyMode& copyMode
+          , CopyListener* copyListener)
+: m_sources{sources}
+, m_dir{dir}
+, m_move{move}
+, m_copyMode{copyMode}
+, m_copyListener{copyListener}
+, m_queue{std::make_shared<CopyQueue>()}
+, m_links{std::make_shared<CopyLinks>()}
+, m_cancellable{Gio::Cancellable::create()}
+, m_scan{std::make_shared<CopyScan>()}
+{
+}
+
+CopyJob::~CopyJob()
+{
+    m_progressConnection.disconnect();
+    for (auto& worker : m_workers) {
+        worker->detach();
+    }
+    for (auto& scanWorker : m_scanWorkers) {
+        scanWorker->detach();
+    }
+    cancel();
+}
+
+void
+CopyJob::startScan()
+{
+    // a move on the same device is a rename, and needs no scan
+    if (m_move) {
+        bool sameDevice{true};
+        for (auto& src : m_sources) {
+            sameDevice = sameDevice && isSameDevice(src, m_dir);
+        }
+        if (sameDevice) {
+            return;
+        }
+    }
+    bool dirs{false};
+    for (auto& src : m_sources) {
+        try {
+            auto info = src->query_info(G_FILE_ATTRIBUTE_STANDARD_TYPE "," G_FILE_ATTRIBUTE_STANDARD_SIZE
+                                      , Gio::FileQueryInfoFlags::FILE_QUERY_INFO_NOFOLLOW_SYMLINKS);
+            if (info->get_file_type() == Gio::FileType::FILE_TYPE_DIRECTORY) {
+                m_scan->add(src);
+                dirs = true;
+                m_scan->count(1u, 0);
+            }
+            else {
+                m_scan->count(1u, info->get_file_type() == Gio::FileType::FILE_TYPE_REGULAR
+                                  ? info->get_size()
+                                  : 0);
+            }
+        }
+        catch (const Glib::Error& err) {    // the copy will report
+            std::cout << "CopyJob::startScan error " << err.what() << std::endl;
+        }
+    }
+    if (!dirs) {
+        m_scanComplete = true;
+        return;
+    }
+    for (size_t i = 0; i < SCAN_WORKERS; ++i) {
+        auto scanWorker = std::make_shared<CopyScanWorker>(m_scan, m_cancellable, this);
+        m_scanWorkers.push_back(scanWorker);
+        ++m_scanning;
+        scanWorker->execute();
+    }
+}
+
+void
+CopyJob::scanDone(size_t count)
+{
+    --m_scanning;
+    if (m_scanning == 0) {
+        m_scanComplete = true;
+    }
+}
+
+void
+CopyJob::setResume(bool resume)
+{
+    m_resume = resume;
+}
+
+void
+CopyJob::start(size_t concurrency)
+{
+    m_startTime = g_get_monotonic_time();
+    startScan();
+    for (auto& src : m_sources) {
+        m_queue->push(std::make_shared<CopyItem>(src, m_dir, m_move));
+    }
+    m_started = true;
+    concurrency = std::clamp(concurrency, static_cast<size_t>(1u), MAX_CONCURRENCY);
+    for (size_t i = 0; i < concurrency; ++i) {
+        auto worker = std::make_shared<CopyWorker>(m_queue, m_links, m_copyMode, m_cancellable, m_resume, this);
+        m_workers.push_back(worker);
+        ++m_running;
+        worker->execute();
+    }
+    m_progressConnection = Glib::signal_timeout().connect(
+            sigc::mem_fun(*this, &CopyJob::showProgress), PROGRESS_INTERVAL_MS);
+}
+
+void
+CopyJob::cancel()
+{
+    m_cancellable->cancel();
+    m_queue->cancel();
+    m_scan->cancel();
+}
+
+bool
+CopyJob::isRunning()
+{
+    return m_running > 0;
+}
+
+void
+CopyJob::itemsDone(const std::vector<PtrCopyItem>& items)
+{
+    std::vector<PtrCopyItem> conflicts;
+    for (auto& item : items) {
+        auto state = item->getState();
+        if (state == CopyState::Conflict) {
+            m_conflicts.insert(item);
+            conflicts.push_back(item);
+        }
+        else if (state == CopyState::Failed) {
+            m_failed.push_back(item);
+        }
+        else {
+            ++m_done;
+        }
+    }
+    if (m_copyListener) {
+        m_copyListener->copyItems(items);
+        if (!conflicts.empty()) {
+            m_copyListener->copyConflicts(conflicts);
+        }
+    }
+    reportFailed();
+}
+
+void
+CopyJob::resolve(const std::vector<PtrCopyItem>& items, const PtrCopyMode& decision)
+{
+    for (auto& item : items) {
+        if (m_conflicts.erase(item) == 0) {
+            continue;   // decided before
+        }
+        // the workers check this with the decision, so nothing is read here
+        item->setDecision(decision);
+        m_queue->push(item);
+        m_queue->release();
+    }
+}
+
+std::vector<PtrCopyItem>
+CopyJob::getConflicts()
+{
+    return std::vector<PtrCopyItem>(m_conflicts.begin(), m_conflicts.end());
+}
+
+void
+CopyJob::reportFailed()
+{
+    // a prompt runs a loop, so we may be called while asking
+    if (m_prompting) {
+        return;
+    }
+    m_prompting = true;
+    while (!m_failed.empty()) {
+        auto item = m_failed.front();
+        m_failed.pop_front();
+        ++m_done;
+        if (!m_cancellable->is_cancelled()
+         && m_copyListener
+         && !m_copyListener->copyFailed(item)) {
+            cancel();
+        }
+    }
+    m_prompting = false;
+    checkDone();
+}
+
+void
+CopyJob::workerDone(size_t count, const Glib::ustring& msg)
+{
+    --m_running;
+    if (!msg.empty()) {
+        std::cout << "CopyJob::workerDone error " << msg << std::endl;
+        m_errMsg = msg;
+    }
+    checkDone();
+}
+
+void
+CopyJob::checkDone()
+{
+    if (!m_started
+     || m_running > 0
+     || m_prompting) {
+        return;
+    }
+    m_started = false;      // report once
+    m_progressConnection.disconnect();
+    showProgress();
+    if (m_errMsg.empty()
+     && m_cancellable->is_cancelled()) {
+        m_errMsg = _("Canceled");   // so a move keeps the clipboard
+    }
+    if (m_copyListener) {
+        m_copyListener->copyDone(m_errMsg);
+    }
+}
+
+bool
+CopyJob::showProgress()
+{
+    if (m_copyListener) {
+        CopyProgress progress;
+        progress.filesDone = m_done;
+        progress.filesTotal = std::max(m_scan->getFiles(), m_queue->getAdded());
+        progress.bytesDone = m_queue->getBytes();
+        progress.bytesTotal = std::max(m_scan->getBytes(), progress.bytesDone);
+        progress.conflicts = m_conflicts.size();
+        progress.totalComplete = m_scanComplete;
+        progress.elapsedUs = g_get_monotonic_time() - m_startTime;
+        m_copyListener->copyProgress(progress);
+    }
+    return true;
+}
+
+bool
+CopyJob::isSameDevice(const Glib::RefPtr<Gio::File>& src, const Glib::RefPtr<Gio::File>& dir)
+{
+    try {
+        auto srcInfo = src->query_info(G_FILE_ATTRIBUTE_UNIX_DEVICE, Gio::FileQueryInfoFlags::FILE_QUERY_INFO_NOFOLLOW_SYMLINKS);
+        auto dirInfo = dir->query_info(G_FILE_ATTRIBUTE_UNIX_DEVICE, Gio::FileQueryInfoFlags::FILE_QUERY_INFO_NONE);
+        if (srcInfo->has_attribute(G_FILE_ATTRIBUTE_UNIX_DEVICE)
+         && dirInfo->has_attribute(G_FILE_ATTRIBUTE_UNIX_DEVICE)) {
+            return srcInfo->get_attribute_uint32(G_FILE_ATTRIBUTE_UNIX_DEVICE)
+                == dirInfo->get_attribute_uint32(G_FILE_ATTRIBUTE_UNIX_DEVICE);
+        }
+    }
+    catch (const Glib::Error& err) {
+        std::cout << "CopyJob::isSameDevice error " << err.what() << std::endl;
+    }
+    return false;   // e.g. remote
+}
+
+size_t
+CopyJob::getConcurrency(
+              const std::vector<Glib::RefPtr<Gio::File>>& sources
+            , const Glib::RefPtr<Gio::File>& dir
+            , const std::shared_ptr<VarselConfig>& config)
+{
+    bool sameDevice = !sources.empty();
+    for (auto& src : sources) {
+        if (!isSameDevice(src, dir)) {
+            sameDevice = false;
+            break;
+        }
+    }
+    int concurrency = static_cast<int>(sameDevice
+                                        ? SAME_DEVICE_CONCURRENCY
+                                        : CROSS_DEVICE_CONCURRENCY);
+    if (config) {
+        concurrency = config->getInteger(CONFIG_GRP
+                                       , sameDevice ? CONFIG_SAME_DEVICE : CONFIG_CROSS_DEVICE
+                                       , concurrency);
+    }
+    return static_cast<size_t>(std::max(concurrency, 1));
+}
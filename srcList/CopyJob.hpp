@@ -0,0 +1,453 @@
+/* -*- Mode: c++; c-basic-offset: 4; tab-width: 4; coding: utf-8; -*-  */
+/*
+ * Copyright (C) 2025 RPf
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gtkmm.h>
+#include <glib/gstdio.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+#include <VarselConfig.hpp>
+
+#include "ThreadWorker.hpp"
+#include "IoScheduler.hpp"
+
+class CopyMode;
+class CopyWorker;
+class CopyJob;
+
+using PtrCopyMode = std::shared_ptr<CopyMode>;
+
+enum class CopyState
+{
+      Pending
+    , Copied
+    , Moved
+    , Created       // directory
+    , Skipped
+    , Conflict      // the target exists, the user decides
+    , Failed
+};
+
+// how the content of a file was copied, in the order tried
+enum class CopyStrategy
+{
+      Rename        // a move on the same filesystem
+    , Delta         // only the changed blocks of the existing target
+    , Link          // a hardlink to a copied file
+    , Reflink       // the blocks are shared, btrfs, xfs
+    , CopyRange     // copy_file_range in kernel, offloaded by some filesystems
+    , Sendfile      // in kernel, also between filesystems
+    , Gio           // any other e.g. remote
+    , None
+};
+
+/**
+ * a source to copy or move into a target directory,
+ *   a move is a rename if possible, otherwise a copy
+ *   that is verified before the source is removed.
+ *   The children report to their parent, so the attributes
+ *   of a directory are set when all below are done
+ *   and a moved directory is removed when all its children
+ *   were moved.
+ */
+class CopyItem
+: public std::enable_shared_from_this<CopyItem>
+{
+public:
+    CopyItem(const Glib::RefPtr<Gio::File>& src
+            , const Glib::RefPtr<Gio::File>& targetDir
+            , bool move
+            , const std::shared_ptr<CopyItem>& parent = nullptr);
+    explicit CopyItem(const CopyItem& other) = delete;
+    ~CopyItem() = default;
+
+    // this is called from worker thread
+    void copy(CopyWorker* copyWorker);
+    Glib::RefPtr<Gio::File> getSource();
+    Glib::RefPtr<Gio::File> getTarget();
+    CopyState getState();
+    CopyStrategy getStrategy();
+    const Glib::ustring& getMessage();
+    // of the source, 0 if unknown
+    goffset getSize();
+    // the decision for a conflict, the item is checked again by this mode
+    void setDecision(const PtrCopyMode& decision);
+    // of a conflict, as found by the worker
+    Glib::RefPtr<Gio::FileInfo> getSourceInfo();
+    Glib::RefPtr<Gio::FileInfo> getTargetInfo();
+    bool isMove();
+    // the target was created by this copy, so any child is new
+    bool isTargetNew();
+
+    static constexpr auto PART_SUFFIX{".varsel-part"};
+protected:
+    void copyType(CopyWorker* copyWorker);
+    // @return true to write the target, otherwise the state is set
+    bool checkOverwrite(CopyWorker* copyWorker, bool existed);
+    // the target was completed by a interrupted copy
+    bool isComplete();
+    // @return true if linked to a previous copy of the same inode
+    bool copyLink(CopyWorker* copyWorker, const std::string& linkTarget, bool existed);
+    void applyDirAttributes();
+    // anything at the target path, a link is not followed
+    bool isTargetPresent();
+    // the content is written to this, and renamed to the target when complete
+    Glib::RefPtr<Gio::File> getPartFile();
+    // @return true if moved, false to copy
+    bool rename(CopyWorker* copyWorker, bool overwrite);
+    bool renameGio(CopyWorker* copyWorker, bool overwrite);
+    // remove the source if the copy is complete
+    void verifyMove(const Glib::RefPtr<Gio::FileInfo>& before, bool existed);
+    // a child or the item itself was handled
+    void childDone(bool success);
+    void copySymlink(CopyWorker* copyWorker);
+    void copyDir(CopyWorker* copyWorker);
+    void copyFile(CopyWorker* copyWorker);
+    // @return false if the filesystems support none of the kernel copies,
+    //   a existing target is only replaced if the copy completed
+    bool copyKernel(CopyWorker* copyWorker);
+    // @return false if unable to update the target in place (e.g. a link, hard linked
+    //   or read only), the target is then replaced by a complete copy
+    bool copyDelta(CopyWorker* copyWorker);
+    // the fallback for targets that are not local, copies to a part file as well
+    void copyGio(CopyWorker* copyWorker);
+
+private:
+    Glib::RefPtr<Gio::File> m_src;
+    Glib::RefPtr<Gio::File> m_targetDir;
+    Glib::RefPtr<Gio::File> m_target;
+    CopyState m_state{CopyState::Pending};
+    CopyStrategy m_strategy{CopyStrategy::None};
+    Glib::ustring m_message;
+    PtrCopyMode m_decision;
+    Glib::RefPtr<Gio::FileInfo> m_srcInfo;
+    Glib::RefPtr<Gio::FileInfo> m_targetInfo;
+    const bool m_move;
+    std::shared_ptr<CopyItem> m_parent;
+    std::atomic<size_t> m_pending{1u};      // the item itself and the children in work
+    std::atomic<bool> m_incomplete{false};  // some child was kept
+    bool m_fresh{false};        // the target directory was created empty
+    bool m_targetNew{false};
+    GStatBuf m_stat{};          // the source stat, read once for local files
+    bool m_statValid{false};
+};
+
+/**
+ * keeps hardlinks as links,
+ *   the first item of a inode copies the content,
+ *   the others wait for it and link to its target.
+ */
+class CopyLinks
+{
+public:
+    CopyLinks() = default;
+    explicit CopyLinks(const CopyLinks& orig) = delete;
+    ~CopyLinks() = default;
+
+    // @return empty if the caller copies the content, otherwise the path to link to
+    std::string claim(guint64 dev, guint64 ino, const std::string& target);
+    // the content of a claimed inode was copied
+    void ready(guint64 dev, guint64 ino, bool success);
+
+private:
+    class Link
+    {
+    public:
+        std::string target;
+        bool ready{false};
+        bool success{false};
+    };
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::map<std::pair<guint64, guint64>, Link> m_links;
+};
+
+using PtrCopyItem = std::shared_ptr<CopyItem>;
+
+/**
+ * the items shared by the copy workers,
+ *   a directory adds its children after the target directory
+ *   was created, so any item finds its target.
+ *   The workers end when the queue is empty and no item
+ *   is in work or held for a decision.
+ */
+class CopyQueue
+{
+public:
+    CopyQueue() = default;
+    explicit CopyQueue(const CopyQueue& orig) = delete;
+    ~CopyQueue() = default;
+
+    void push(const PtrCopyItem& item);
+    // waits for the next item, nullptr if completed or canceled
+    PtrCopyItem pop();
+    // the item taken by pop is finished
+    void done();
+    // keep the workers running until the item is released
+    void hold();
+    void release();
+    void cancel();
+    size_t getAdded();
+    void addBytes(goffset bytes);
+    goffset getBytes();
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::deque<PtrCopyItem> m_items;
+    size_t m_active{0};     // in work or held
+    size_t m_added{0};
+    bool m_cancel{false};
+    std::atomic<goffset> m_bytes{0};
+};
+
+// copies the items of the queue, a job runs some of these concurrently
+class CopyWorker
+: public ThreadWorker<PtrCopyItem, size_t>
+{
+public:
+    CopyWorker(const std::shared_ptr<CopyQueue>& queue
+             , const std::shared_ptr<CopyLinks>& links
+             , const PtrCopyMode& copyMode
+             , const Glib::RefPtr<Gio::Cancellable>& cancellable
+             , bool resume
+             , CopyJob* copyJob);
+    explicit CopyWorker(const CopyWorker& orig) = delete;
+    virtual ~CopyWorker() = default;
+
+    // no longer report to the job
+    void detach();
+    // these are used by the items from worker thread
+    void add(const Glib::RefPtr<Gio::File>& src
+           , const std::shared_ptr<CopyItem>& parent);
+    void hold();
+    void addBytes(goffset bytes);
+    PtrCopyMode getCopyMode();
+    Glib::RefPtr<Gio::Cancellable> getCancellable();
+    std::shared_ptr<CopyLinks> getLinks();
+    // continue a interrupted copy, the completed targets are kept
+    bool isResume();
+    // the size to copy at once, as the io limit allows
+    size_t getChunk(size_t preferred);
+    // wait until the bytes may be read/written
+    void throttle(goffset bytes);
+    // the first strategy worth trying
+    CopyStrategy getStrategy();
+    // skip a strategy that failed as unsupported for the following items
+    void unsupported(CopyStrategy strategy);
+    static const char* getStrategyName(CopyStrategy strategy);
+
+    // reported and checked for cancel after each chunk
+    static constexpr size_t KERNEL_CHUNK{16u * 1024u * 1024u};
+    // the unit compared and rewritten by a delta copy
+    static constexpr size_t DELTA_BLOCK{256u * 1024u};
+protected:
+    size_t doInBackground() override;
+    void process(const std::vector<PtrCopyItem>& items) override;
+    void done() override;
+
+private:
+    std::shared_ptr<CopyQueue> m_queue;
+    std::shared_ptr<CopyLinks> m_links;
+    PtrCopyMode m_copyMode;
+    Glib::RefPtr<Gio::Cancellable> m_cancellable;
+    const bool m_resume;
+    std::shared_ptr<IoScheduler> m_ioScheduler;
+    CopyJob* m_copyJob;
+    CopyStrategy m_strategy{CopyStrategy::Reflink};
+};
+
+/**
+ * counts the items and bytes of the sources ahead of the copy,
+ *   the directories are shared by some workers
+ *   so large trees are read in parallel.
+ */
+class CopyScan
+{
+public:
+    CopyScan() = default;
+    explicit CopyScan(const CopyScan& orig) = delete;
+    ~CopyScan() = default;
+
+    void add(const Glib::RefPtr<Gio::File>& file);
+    // waits for the next directory, nullptr if completed or canceled
+    Glib::RefPtr<Gio::File> pop();
+    void done();
+    void cancel();
+    void count(size_t files, goffset bytes);
+    size_t getFiles();
+    goffset getBytes();
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::deque<Glib::RefPtr<Gio::File>> m_dirs;
+    size_t m_active{0};
+    bool m_cancel{false};
+    std::atomic<size_t> m_files{0};
+    std::atomic<goffset> m_bytes{0};
+};
+
+class CopyScanWorker
+: public ThreadWorker<int, size_t>
+{
+public:
+    CopyScanWorker(const std::shared_ptr<CopyScan>& scan
+                 , const Glib::RefPtr<Gio::Cancellable>& cancellable
+                 , CopyJob* copyJob);
+    explicit CopyScanWorker(const CopyScanWorker& orig) = delete;
+    virtual ~CopyScanWorker() = default;
+
+    void detach();
+    // the counts are passed in batches to keep the atomics calm
+    static constexpr size_t COUNT_BATCH{256u};
+protected:
+    size_t doInBackground() override;
+    void process(const std::vector<int>& dummy) override;
+    void done() override;
+
+private:
+    std::shared_ptr<CopyScan> m_scan;
+    Glib::RefPtr<Gio::Cancellable> m_cancellable;
+    CopyJob* m_copyJob;
+};
+
+// the state of a copy job
+class CopyProgress
+{
+public:
+    size_t filesDone{0};
+    size_t filesTotal{0};       // the scanned, or as far as known while scanning
+    goffset bytesDone{0};       // copied or skipped
+    goffset bytesTotal{0};
+    size_t conflicts{0};        // waiting for a decision
+    bool totalComplete{false};  // the scan is completed
+    gint64 elapsedUs{0};
+
+    // 0...1 or negative if unknown
+    double getFraction() const;
+    // bytes per second
+    double getThroughput() const;
+    double getFilesPerSecond() const;
+    // estimated seconds to completion or negative if unknown
+    double getEta() const;
+    Glib::ustring format() const;
+};
+
+class CopyListener
+{
+public:
+    virtual ~CopyListener() = default;
+
+    // the completed items
+    virtual void copyItems(const std::vector<PtrCopyItem>& items) = 0;
+    virtual void copyProgress(const CopyProgress& progress) = 0;
+    // the items with a existing target, that wait for a decision
+    virtual void copyConflicts(const std::vector<PtrCopyItem>& items) = 0;
+    // @return true to continue after the failed item
+    virtual bool copyFailed(const PtrCopyItem& item) = 0;
+    virtual void copyDone(const Glib::ustring& msg) = 0;
+};
+
+/**
+ * copy or move files and directories into a directory,
+ *   with some items copied concurrently, so small files
+ *   are not limited by the latency of each copy.
+ *   Conflicts are collected while the workers continue
+ *   with the other items, and copied when decided.
+ */
+class CopyJob
+{
+public:
+    CopyJob(const std::vector<Glib::RefPtr<Gio::File>>& sources
+          , const Glib::RefPtr<Gio::File>& dir
+          , bool move
+          , const PtrCopyMode& copyMode
+          , CopyListener* copyListener);
+    explicit CopyJob(const CopyJob& orig) = delete;
+    virtual ~CopyJob();
+
+    // for a interrupted job, keep the completed targets
+    void setResume(bool resume);
+    void start(size_t concurrency);
+    void cancel();
+    bool isRunning();
+    // from the workers in main thread
+    void itemsDone(const std::vector<PtrCopyItem>& items);
+    void workerDone(size_t count, const Glib::ustring& msg);
+    void scanDone(size_t count);
+    // copy the conflicting items as the decision allows
+    void resolve(const std::vector<PtrCopyItem>& items, const PtrCopyMode& decision);
+    std::vector<PtrCopyItem> getConflicts();
+
+    static bool isSameDevice(const Glib::RefPtr<Gio::File>& src, const Glib::RefPtr<Gio::File>& dir);
+    // the count of concurrent copies as configured for the devices
+    static size_t getConcurrency(
+              const std::vector<Glib::RefPtr<Gio::File>>& sources
+            , const Glib::RefPtr<Gio::File>& dir
+            , const std::shared_ptr<VarselConfig>& config);
+
+    static constexpr auto CONFIG_GRP{"Copy"};
+    static constexpr auto CONFIG_SAME_DEVICE{"concurrencySameDevice"};
+    static constexpr auto CONFIG_CROSS_DEVICE{"concurrencyCrossDevice"};
+    // on a single device more requests mostly add seeks,
+    //   between devices reading and writing overlap
+    static constexpr size_t SAME_DEVICE_CONCURRENCY{4u};
+    static constexpr size_t CROSS_DEVICE_CONCURRENCY{8u};
+    static constexpr size_t MAX_CONCURRENCY{64u};
+    static constexpr size_t SCAN_WORKERS{4u};
+    static constexpr unsigned int PROGRESS_INTERVAL_MS{200u};
+protected:
+    void startScan();
+    void reportFailed();
+    void checkDone();
+    bool showProgress();
+
+private:
+    std::vector<Glib::RefPtr<Gio::File>> m_sources;
+    Glib::RefPtr<Gio::File> m_dir;
+    const bool m_move;
+    PtrCopyMode m_copyMode;
+    CopyListener* m_copyListener;
+    std::shared_ptr<CopyQueue> m_queue;
+    std::shared_ptr<CopyLinks> m_links;
+    Glib::RefPtr<Gio::Cancellable> m_cancellable;
+    std::vector<std::shared_ptr<CopyWorker>> m_workers;
+    std::shared_ptr<CopyScan> m_scan;
+    std::vector<std::shared_ptr<CopyScanWorker>> m_scanWorkers;
+    size_t m_scanning{0};
+    bool m_scanComplete{false};
+    gint64 m_startTime{0};
+    std::deque<PtrCopyItem> m_failed;       // waiting for the user
+    bool m_prompting{false};
+    std::set<PtrCopyItem> m_conflicts;      // held until decided
+    bool m_resume{false};
+    size_t m_running{0};
+    size_t m_done{0};
+    bool m_started{false};
+    Glib::ustring m_errMsg;
+    sigc::connection m_progressConnection;
+};
@@ -0,0 +1,414 @@
+/* -*- Mode: c++; c-basic-offset: 4; tab-width: 4; coding: utf-8; -*-  */
+/*
+ * Copyright (C) 2025 RPf
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <psc_i18n.hpp>
+#ifdef __linux__
+#include <signal.h>
+#include <unistd.h>
+#endif
+
+#include "ListApp.hpp"
+#include "CopyDialog.hpp"
+#include "CopyManager.hpp"
+
+CopyTask::CopyTask(const std::vector<Glib::RefPtr<Gio::File>>& sources
+                 , const Glib::RefPtr<Gio::File>& dir
+                 , bool move
+                 , const Glib::ustring& modeId
+                 , size_t concurrency
+                 , CopyManager* copyManager)
+: m_sources{sources}
+, m_dir{dir}
+, m_move{move}
+, m_modeId{modeId}
+, m_concurrency{concurrency}
+, m_copyManager{copyManager}
+{
+}
+
+void
+CopyTask::setResume(bool resume)
+{
+    m_resume = resume;
+}
+
+void
+CopyTask::start()
+{
+    std::vector<Glib::RefPtr<Gio::File>> sources;
+    for (auto& src : m_sources) {
+        // a interrupted move may have finished some
+        if (!m_resume
+         || src->query_exists()) {
+            sources.push_back(src);
+        }
+    }
+    m_state = CopyTaskState::Running;
+    m_copyJob = std::make_shared<CopyJob>(sources, m_dir, m_move, CopyMode::create(m_modeId), this);
+    m_copyJob->setResume(m_resume);
+    m_copyJob->start(m_concurrency);
+}
+
+void
+CopyTask::cancel()
+{
+    if (m_copyJob) {
+        m_copyJob->cancel();
+    }
+    else if (m_state == CopyTaskState::Queued) {
+        copyDone(_("Canceled"));
+    }
+}
+
+void
+CopyTask::attach(CopyListener* copyListener)
+{
+    m_copyListener = copyListener;
+    if (m_state == CopyTaskState::Done) {
+        m_copyListener->copyDone(m_errMsg);
+        return;
+    }
+    if (m_copyJob) {
+        auto conflicts = m_copyJob->getConflicts();
+        if (!conflicts.empty()) {
+            m_copyListener->copyConflicts(conflicts);
+        }
+        m_copyListener->copyProgress(m_progress);
+    }
+}
+
+void
+CopyTask::detach(CopyListener* copyListener)
+{
+    if (m_copyListener == copyListener) {
+        m_copyListener = nullptr;
+        if (m_copyJob) {
+            skipConflicts(m_copyJob->getConflicts());
+        }
+    }
+}
+
+void
+CopyTask::skipConflicts(const std::vector<PtrCopyItem>& items)
+{
+    // with no window left, the held conflicts would keep the task (and the application) forever
+    if (!items.empty()) {
+        std::cout << "CopyTask::skipConflicts " << items.size() << " kept in " << m_dir->get_parse_name() << std::endl;
+        resolve(items, CopyMode::create(SKIP_MODE));
+    }
+}
+
+void
+CopyTask::resolve(const std::vector<PtrCopyItem>& items, const PtrCopyMode& decision)
+{
+    if (m_copyJob) {
+        m_copyJob->resolve(items, decision);
+    }
+}
+
+CopyTaskState
+CopyTask::getState()
+{
+    return m_state;
+}
+
+const std::vector<Glib::RefPtr<Gio::File>>&
+CopyTask::getSources()
+{
+    return m_sources;
+}
+
+Glib::RefPtr<Gio::File>
+CopyTask::getDir()
+{
+    return m_dir;
+}
+
+bool
+CopyTask::isMove()
+{
+    return m_move;
+}
+
+const Glib::ustring&
+CopyTask::getModeId()
+{
+    return m_modeId;
+}
+
+size_t
+CopyTask::getConcurrency()
+{
+    return m_concurrency;
+}
+
+void
+CopyTask::copyItems(const std::vector<PtrCopyItem>& items)
+{
+    if (m_copyListener) {
+        m_copyListener->copyItems(items);
+    }
+}
+
+void
+CopyTask::copyProgress(const CopyProgress& progress)
+{
+    m_progress = progress;
+    if (m_copyListener) {
+        m_copyListener->copyProgress(progress);
+    }
+}
+
+void
+CopyTask::copyConflicts(const std::vector<PtrCopyItem>& items)
+{
+    // the job holds these until decided by the dialog, without a dialog the targets are kept
+    if (m_copyListener) {
+        m_copyListener->copyConflicts(items);
+    }
+    else {
+        skipConflicts(items);
+    }
+}
+
+bool
+CopyTask::copyFailed(const PtrCopyItem& item)
+{
+    if (m_copyListener) {
+        return m_copyListener->copyFailed(item);
+    }
+    // nobody to ask, keep the others going
+    std::cout << "CopyTask::copyFailed " << item->getMessage() << " writing " << item->getTarget()->get_parse_name() << std::endl;
+    return true;
+}
+
+void
+CopyTask::copyDone(const Glib::ustring& msg)
+{
+    m_state = CopyTaskState::Done;
+    m_errMsg = msg;
+    if (m_copyListener) {
+        m_copyListener->copyDone(msg);
+    }
+    m_copyManager->taskDone(this);
+}
+
+CopyManager::CopyManager(ListApp* listApp)
+: m_listApp{listApp}
+{
+}
+
+std::shared_ptr<CopyTask>
+CopyManager::add(
+          const std::vector<Glib::RefPtr<Gio::File>>& sources
+        , const Glib::RefPtr<Gio::File>& dir
+        , bool move
+        , const Glib::ustring& modeId
+        , size_t concurrency)
+{
+    auto copyTask = std::make_shared<CopyTask>(sources, dir, move, modeId, concurrency, this);
+    m_tasks.push_back(copyTask);
+    save();
+    next();
+    return copyTask;
+}
+
+size_t
+CopyManager::resume()
+{
+    size_t count{0};
+    std::vector<std::string> paths;
+    try {
+        Glib::Dir dir(Glib::get_user_config_dir());
+        for (auto name : dir) {
+            if (!Glib::str_has_prefix(name, JOURNAL_PREFIX)
+             || !Glib::str_has_suffix(name, JOURNAL_SUFFIX)) {
+                continue;
+            }
+            auto pid = std::atoi(name.c_str() + std::strlen(JOURNAL_PREFIX));
+            if (pid != getProcessId()
+             && !isAlive(pid)) {
+                paths.push_back(Glib::build_filename(Glib::get_user_config_dir(), name));
+            }
+        }
+    }
+    catch (const Glib::FileError& err) {
+        std::cout << "CopyManager::resume error " << err.what() << std::endl;
+    }
+    for (auto& path : paths) {
+        count += load(path);
+    }
+    if (count > 0) {
+        save();     // now ours
+    }
+    for (auto& path : paths) {
+        try {
+            Gio::File::create_for_path(path)->remove();
+        }
+        catch (const Glib::Error& err) {
+            std::cout << "CopyManager::resume error " << err.what() << std::endl;
+        }
+    }
+    if (count > 0) {
+        next();
+    }
+    return count;
+}
+
+size_t
+CopyManager::load(const std::string& path)
+{
+    size_t count{0};
+    try {
+        Glib::KeyFile journal;
+        journal.load_from_file(path);
+        for (auto& grp : journal.get_groups()) {
+            std::vector<Glib::RefPtr<Gio::File>> sources;
+            for (auto& uri : journal.get_string_list(grp, "sources")) {
+                sources.push_back(Gio::File::create_for_uri(uri));
+            }
+            auto dir = Gio::File::create_for_uri(journal.get_string(grp, "target"));
+            auto copyTask = std::make_shared<CopyTask>(
+                                  sources
+                                , dir
+                                , journal.get_boolean(grp, "move")
+                                , journal.get_string(grp, "mode")
+                                , static_cast<size_t>(journal.get_integer(grp, "concurrency"))
+                                , this);
+            copyTask->setResume(true);
+            m_tasks.push_back(copyTask);
+            ++count;
+        }
+    }
+    catch (const Glib::Error& err) {    // the copies are lost, but the targets will tell
+        std::cout << "CopyManager::load error " << err.what() << std::endl;
+    }
+    return count;
+}
+
+std::vector<std::shared_ptr<CopyTask>>
+CopyManager::getTasks()
+{
+    return std::vector<std::shared_ptr<CopyTask>>(m_tasks.begin(), m_tasks.end());
+}
+
+void
+CopyManager::taskDone(CopyTask* copyTask)
+{
+    // called from the job, so keep it until it returned
+    Glib::signal_idle().connect_once(sigc::mem_fun(*this, &CopyManager::next));
+}
+
+void
+CopyManager::next()
+{
+    auto size = m_tasks.size();
+    m_tasks.remove_if([] (const std::shared_ptr<CopyTask>& copyTask) {
+        return copyTask->getState() == CopyTaskState::Done;
+    });
+    if (size != m_tasks.size()) {
+        save();
+    }
+    // one at a time, as parallel copies mostly compete for the same disks
+    bool running{false};
+    for (auto& copyTask : m_tasks) {
+        if (copyTask->getState() == CopyTaskState::Running) {
+            running = true;
+        }
+        else if (!running
+              && copyTask->getState() == CopyTaskState::Queued) {
+            copyTask->start();
+            running = true;
+        }
+    }
+    // keep the application while copying, even if all windows were closed
+    if (!m_tasks.empty()
+     && !m_hold) {
+        m_listApp->hold();
+        m_hold = true;
+    }
+    else if (m_tasks.empty()
+          && m_hold) {
+        m_hold = false;
+        m_listApp->release();
+    }
+}
+
+std::string
+CopyManager::getJournalPath(int pid)
+{
+    auto name = Glib::ustring::sprintf("%s%d%s", JOURNAL_PREFIX, pid, JOURNAL_SUFFIX);
+    return Glib::build_filename(Glib::get_user_config_dir(), name);
+}
+
+int
+CopyManager::getProcessId()
+{
+#   ifdef __linux__
+    return static_cast<int>(getpid());
+#   else
+    return 0;
+#   endif
+}
+
+bool
+CopyManager::isAlive(int pid)
+{
+#   ifdef __linux__
+    return kill(static_cast<pid_t>(pid), 0) == 0
+        || errno == EPERM;
+#   else
+    return false;
+#   endif
+}
+
+void
+CopyManager::save()
+{
+    auto path = getJournalPath(getProcessId());
+    try {
+        if (m_tasks.empty()) {
+            if (Glib::file_test(path, Glib::FileTest::FILE_TEST_EXISTS)) {
+                Gio::File::create_for_path(path)->remove();
+            }
+            return;
+        }
+        Glib::KeyFile journal;
+        size_t n{0};
+        for (auto& copyTask : m_tasks) {
+            auto grp = Glib::ustring::sprintf("%s%d", JOURNAL_GRP, n++);
+            std::vector<Glib::ustring> uris;
+            for (auto& src : copyTask->getSources()) {
+                uris.push_back(src->get_uri());
+            }
+            journal.set_string_list(grp, "sources", uris);
+            journal.set_string(grp, "target", copyTask->getDir()->get_uri());
+            journal.set_boolean(grp, "move", copyTask->isMove());
+            journal.set_string(grp, "mode", copyTask->getModeId());
+            journal.set_integer(grp, "concurrency", static_cast<int>(copyTask->getConcurrency()));
+        }
+        Glib::file_set_contents(path, journal.to_data());
+    }
+    catch (const Glib::Error& err) {    // the copy works without
+        std::cout << "CopyManager::save error " << err.what() << std::endl;
+    }
+}
@@ -0,0 +1,141 @@
+/* -*- Mode: c++; c-basic-offset: 4; tab-width: 4; coding: utf-8; -*-  */
+/*
+ * Copyright (C) 2025 RPf
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gtkmm.h>
+#include <list>
+#include <memory>
+#include <vector>
+
+#include "CopyJob.hpp"
+
+class ListApp;
+class CopyManager;
+
+enum class CopyTaskState
+{
+      Queued
+    , Running
+    , Done
+};
+
+/**
+ * a copy as requested by paste, run by the manager,
+ *   a dialog may attach to show the progress and decide the conflicts.
+ *   Conflicts without a dialog attached are skipped (the targets are kept).
+ */
+class CopyTask
+: public CopyListener
+{
+public:
+    CopyTask(const std::vector<Glib::RefPtr<Gio::File>>& sources
+           , const Glib::RefPtr<Gio::File>& dir
+           , bool move
+           , const Glib::ustring& modeId
+           , size_t concurrency
+           , CopyManager* copyManager);
+    explicit CopyTask(const CopyTask& orig) = delete;
+    virtual ~CopyTask() = default;
+
+    // continue a copy of a previous session
+    void setResume(bool resume);
+    void start();
+    void cancel();
+    // replays the state, so the listener may attach any time
+    void attach(CopyListener* copyListener);
+    void detach(CopyListener* copyListener);
+    void resolve(const std::vector<PtrCopyItem>& items, const PtrCopyMode& decision);
+    CopyTaskState getState();
+    const std::vector<Glib::RefPtr<Gio::File>>& getSources();
+    Glib::RefPtr<Gio::File> getDir();
+    bool isMove();
+    const Glib::ustring& getModeId();
+    size_t getConcurrency();
+    static constexpr auto SKIP_MODE{"no"};
+
+    void copyItems(const std::vector<PtrCopyItem>& items) override;
+    void copyProgress(const CopyProgress& progress) override;
+    void copyConflicts(const std::vector<PtrCopyItem>& items) override;
+    bool copyFailed(const PtrCopyItem& item) override;
+    void copyDone(const Glib::ustring& msg) override;
+
+protected:
+    void skipConflicts(const std::vector<PtrCopyItem>& items);
+
+private:
+    std::vector<Glib::RefPtr<Gio::File>> m_sources;
+    Glib::RefPtr<Gio::File> m_dir;
+    const bool m_move;
+    Glib::ustring m_modeId;
+    size_t m_concurrency;
+    CopyManager* m_copyManager;
+    CopyTaskState m_state{CopyTaskState::Queued};
+    bool m_resume{false};
+    std::shared_ptr<CopyJob> m_copyJob;
+    CopyListener* m_copyListener{nullptr};
+    CopyProgress m_progress;
+    Glib::ustring m_errMsg;
+};
+
+/**
+ * runs the copies of the application one after the other,
+ *   independent of the dialogs and windows.
+ *   The unfinished copies are kept in a journal per process,
+ *   so a interrupted copy is continued on next start,
+ *   but not while the process that wrote it is running.
+ *   The journal keeps the request only, on resume the completed
+ *   targets are recognized by size and modification, so these
+ *   are copied again if the target does not keep the time (e.g. remote).
+ */
+class CopyManager
+{
+public:
+    CopyManager(ListApp* listApp);
+    explicit CopyManager(const CopyManager& orig) = delete;
+    virtual ~CopyManager() = default;
+
+    std::shared_ptr<CopyTask> add(
+              const std::vector<Glib::RefPtr<Gio::File>>& sources
+            , const Glib::RefPtr<Gio::File>& dir
+            , bool move
+            , const Glib::ustring& modeId
+            , size_t concurrency);
+    // start the copies left by a previous session
+    // @return the count of continued copies
+    size_t resume();
+    std::vector<std::shared_ptr<CopyTask>> getTasks();
+    void taskDone(CopyTask* copyTask);
+
+    static constexpr auto JOURNAL_PREFIX{"va_copy-"};
+    static constexpr auto JOURNAL_SUFFIX{".journal"};
+    static constexpr auto JOURNAL_GRP{"Copy"};
+protected:
+    // removes the completed, starts the next
+    void next();
+    void save();
+    size_t load(const std::string& path);
+    static std::string getJournalPath(int pid);
+    static int getProcessId();
+    static bool isAlive(int pid);
+
+private:
+    ListApp* m_listApp;
+    std::list<std::shared_ptr<CopyTask>> m_tasks;   // queued, running and resumed
+    bool m_hold{false};
+};
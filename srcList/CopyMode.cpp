@@ -0,0 +1,87 @@
+/* -*- Mode: c++; c-basic-offset: 4; tab-width: 4; coding: utf-8; -*-  */
+/*
+ * Copyright (C) 2025 RPf
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CopyMode.hpp"
+
+PtrCopyMode
+CopyMode::create(const Glib::ustring& id)
+{
+    if (id == "ask") {
+        return std::make_shared<CopyModeAsk>();
+    }
+    if (id == "check") {
+        return std::make_shared<CopyModeCheck>();
+    }
+    if (id == "delta") {
+        return std::make_shared<CopyModeDelta>();
+    }
+    if (id == "all") {
+        return std::make_shared<CopyModeAll>();
+    }
+    return std::make_shared<CopyModeNo>();
+}
+
+bool
+CopyModeAsk::isOverwrite(
+    const Glib::RefPtr<Gio::File>& src
+    , const Glib::RefPtr<Gio::File>& target)
+{
+    return false;   // not used as interactive, see CopyDialog::resolve
+}
+
+bool
+CopyModeCheck::isOverwrite(
+    const Glib::RefPtr<Gio::File>& src
+    , const Glib::RefPtr<Gio::File>& target)
+{
+    auto srcInfo = src->query_info("standard::size,time::modified", Gio::FileQueryInfoFlags::FILE_QUERY_INFO_NONE);
+    auto targetInfo = target->query_info("standard::size,time::modified", Gio::FileQueryInfoFlags::FILE_QUERY_INFO_NONE);
+    if (srcInfo->get_modification_date_time()
+     .compare(targetInfo->get_modification_date_time()) > 0) {
+        return true;
+    }
+    if (srcInfo->get_size()
+     != targetInfo->get_size()) {
+        return true;
+    }
+    return false;
+}
+
+bool
+CopyModeNewer::isOverwrite(
+    const Glib::RefPtr<Gio::File>& src
+    , const Glib::RefPtr<Gio::File>& target)
+{
+    auto srcInfo = src->query_info("time::modified", Gio::FileQueryInfoFlags::FILE_QUERY_INFO_NONE);
+    auto targetInfo = target->query_info("time::modified", Gio::FileQueryInfoFlags::FILE_QUERY_INFO_NONE);
+    return srcInfo->get_modification_date_time()
+            .compare(targetInfo->get_modification_date_time()) > 0;
+}
+
+bool
+CopyModeDelta::isOverwrite(
+    const Glib::RefPtr<Gio::File>& src
+    , const Glib::RefPtr<Gio::File>& target)
+{
+    // the delta copy keeps the modification, so a unchanged file is skipped
+    auto srcInfo = src->query_info("standard::size,time::modified", Gio::FileQueryInfoFlags::FILE_QUERY_INFO_NONE);
+    auto targetInfo = target->query_info("standard::size,time::modified", Gio::FileQueryInfoFlags::FILE_QUERY_INFO_NONE);
+    return srcInfo->get_size() != targetInfo->get_size()
+        || srcInfo->get_modification_date_time()
+            .compare(targetInfo->get_modification_date_time()) != 0;
+}
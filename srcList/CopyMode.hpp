@@ -0,0 +1,159 @@
+/* -*- Mode: c++; c-basic-offset: 4; tab-width: 4; coding: utf-8; -*-  */
+/*
+ * Copyright (C) 2025 RPf
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <giomm.h>
+#include <memory>
+
+#include "CopyJob.hpp"
+
+class CopyMode
+{
+public:
+    CopyMode() = default;
+    explicit CopyMode(const CopyMode& other) = delete;
+    ~CopyMode() = default;
+
+    virtual bool isOverwrite(
+        const Glib::RefPtr<Gio::File>& src
+        , const Glib::RefPtr<Gio::File>& target) = 0;
+    // a interactive mode is asked from main thread,
+    //   the others are used from the copy workers
+    virtual bool isInteractive() {
+        return false;
+    }
+    // update a existing target by the changed blocks
+    virtual bool isDelta() {
+        return false;
+    }
+    // for the ids of the dialog choice, also used by the journal
+    static PtrCopyMode create(const Glib::ustring& id);
+};
+
+// the conflicts are listed, and copied when decided
+class CopyModeAsk
+: public CopyMode
+{
+public:
+    CopyModeAsk()
+    : CopyMode()
+    {
+    }
+    explicit CopyModeAsk(const CopyModeAsk& other) = delete;
+    ~CopyModeAsk() = default;
+
+    bool isOverwrite(
+        const Glib::RefPtr<Gio::File>& src
+        , const Glib::RefPtr<Gio::File>& target);
+    bool isInteractive() override {
+        return true;
+    }
+};
+
+class CopyModeNo
+: public CopyMode
+{
+public:
+    CopyModeNo()
+    : CopyMode()
+    {
+    }
+    explicit CopyModeNo(const CopyModeNo& other) = delete;
+    ~CopyModeNo() = default;
+
+    bool isOverwrite(
+        const Glib::RefPtr<Gio::File>& src
+        , const Glib::RefPtr<Gio::File>& target) {
+        return false;
+    }
+};
+
+class CopyModeCheck
+: public CopyMode
+{
+public:
+    CopyModeCheck()
+    : CopyMode()
+    {
+    }
+    explicit CopyModeCheck(const CopyModeCheck& other) = delete;
+    ~CopyModeCheck() = default;
+
+    bool isOverwrite(
+        const Glib::RefPtr<Gio::File>& src
+        , const Glib::RefPtr<Gio::File>& target);
+};
+
+/**
+ * refresh the targets that differ in size or modification,
+ *   by rewriting the blocks that changed.
+ */
+class CopyModeDelta
+: public CopyMode
+{
+public:
+    CopyModeDelta()
+    : CopyMode()
+    {
+    }
+    explicit CopyModeDelta(const CopyModeDelta& other) = delete;
+    ~CopyModeDelta() = default;
+
+    bool isOverwrite(
+        const Glib::RefPtr<Gio::File>& src
+        , const Glib::RefPtr<Gio::File>& target);
+    bool isDelta() override {
+        return true;
+    }
+};
+
+// used to decide conflicts, a target that is older is overwritten
+class CopyModeNewer
+: public CopyMode
+{
+public:
+    CopyModeNewer()
+    : CopyMode()
+    {
+    }
+    explicit CopyModeNewer(const CopyModeNewer& other) = delete;
+    ~CopyModeNewer() = default;
+
+    bool isOverwrite(
+        const Glib::RefPtr<Gio::File>& src
+        , const Glib::RefPtr<Gio::File>& target);
+};
+
+class CopyModeAll
+: public CopyMode
+{
+public:
+    CopyModeAll()
+    : CopyMode()
+    {
+    }
+    explicit CopyModeAll(const CopyModeAll& other) = delete;
+    ~CopyModeAll() = default;
+
+    bool isOverwrite(
+        const Glib::RefPtr<Gio::File>& src
+        , const Glib::RefPtr<Gio::File>& target) {
+        return true;
+    }
+};
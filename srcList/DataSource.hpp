@@ -28,6 +28,7 @@
 
 class TreeNodeModel;
 class ListApp;
+class VarselConfig;
 
 
 class BaseTreeNode
@@ -106,6 +107,12 @@ public:
 
     virtual void nodeAdded(const std::shared_ptr<BaseTreeNode>& baseTreeNode) = 0;
     virtual void listDone(Severity severity, const Glib::ustring& msg) = 0;
+    // fraction 0...1 or negative if unknown
+    virtual void listProgress(double fraction, const Glib::ustring& msg)
+    {
+    }
+    // the configuration of the window
+    virtual std::shared_ptr<VarselConfig> getKeyFile() = 0;
 protected:
     ListListener() = default;
 };
@@ -180,6 +187,18 @@ public:
                 , VarselList* win) = 0;
     virtual void distribute(const std::vector<PtrEventItem>& items, Gtk::Menu* menu, Gtk::Window* win) = 0;
     void open(std::vector<Glib::RefPtr<Gio::File>>& files);
+    // the window is closed, stop any background work
+    virtual void close()
+    {
+    }
+    // the end of the tree is visible, for sources that read in pages
+    virtual void requestMore()
+    {
+    }
+    // columns shown after the name, the values are provided by the nodes
+    virtual void appendTreeColumns(Gtk::TreeView* treeView)
+    {
+    }
 
     std::shared_ptr<TreeColumns> m_treeColumns;
     ListApp* m_application;
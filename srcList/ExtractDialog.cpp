@@ -16,18 +16,23 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+#include <cstring>
+#include <sstream>
 #include <psc_i18n.hpp>
 #include <psc_format.hpp>
 #include <StringUtils.hpp>
 
 #include "varsel_config.h"
 #include "ExtractDialog.hpp"
+#include "IoScheduler.hpp"
 #include "ListApp.hpp"
 #include "VarselList.hpp"
 
-ArchivExtractEntry::ArchivExtractEntry(struct archive_entry *entry, const Glib::RefPtr<Gio::File>& dir)
+ArchivExtractEntry::ArchivExtractEntry(struct archive_entry *entry, const Glib::RefPtr<Gio::File>& dir, ExtractMode mode)
 : ArchivEntry::ArchivEntry(entry)
 , m_dir{dir}
+, m_mode{mode}
 {
 }
 
@@ -77,81 +82,354 @@ ArchivExtractEntry::handleContent(struct archive* archiv)
         }
     }
     else if (getMode() == AE_IFREG) {
-        auto dir = file->get_parent();
-        bool remove{false};
-        try {
-            if (!dir->query_exists()) {
-                // if any part exists as file will throw "Error creating directory ... Not a directory"
-                dir->make_directory_with_parents();
-            }
-            Glib::RefPtr<Gio::FileOutputStream> stream;
-            if (file->query_exists()) {
-                stream = file->replace();
-            }
-            else {
-                stream = file->create_file(Gio::FileCreateFlags::FILE_CREATE_NONE);
+        if (m_mode != ExtractMode::Replace
+         && file->query_exists()) {
+            ret = extractChanged(archiv, file);
+        }
+        else {
+            ret = extractFile(archiv, file);
+        }
+    }
+    else {
+        std::cout << "ArchivExtractEntry::handleContent unhandeld mode " << getMode() << std::endl;
+    }
+    return ret;
+}
+
+int
+ArchivExtractEntry::extractFile(struct archive* archiv, const Glib::RefPtr<Gio::File>& file)
+{
+    int ret{ARCHIVE_OK};
+    auto dir = file->get_parent();
+    bool remove{false};
+    try {
+        if (!dir->query_exists()) {
+            // if any part exists as file will throw "Error creating directory ... Not a directory"
+            dir->make_directory_with_parents();
+        }
+        Glib::RefPtr<Gio::FileOutputStream> stream;
+        if (file->query_exists()) {
+            stream = file->replace();
+        }
+        else {
+            stream = file->create_file(Gio::FileCreateFlags::FILE_CREATE_NONE);
+        }
+        const void *buff;
+        size_t len{0l};
+        off_t offset{0l};
+        do {
+            ret = archive_read_data_block(archiv, &buff, &len, &offset);
+            if (ret == ARCHIVE_OK) {
+                IoScheduler::get()->acquire(static_cast<goffset>(len));
+                dataRead();
+                stream->seek(offset, Glib::SeekType::SEEK_TYPE_SET);
+                auto wsize = stream->write(buff, len);
+                if (static_cast<size_t>(wsize) != len) {
+                    ret = ARCHIVE_FAILED;
+                    remove = true;
+                }
             }
-            const void *buff;
-            size_t len{0l};
-            off_t offset{0l};
-            do {
-                ret = archive_read_data_block(archiv, &buff, &len, &offset);
-                if (ret == ARCHIVE_OK) {
-                    stream->seek(offset, Glib::SeekType::SEEK_TYPE_SET);
-                    auto wsize = stream->write(buff, len);
-                    if (static_cast<size_t>(wsize) != len) {
-                        ret = ARCHIVE_FAILED;
-                        remove = true;
+        } while (ret == ARCHIVE_OK);
+        if (ret == ARCHIVE_EOF) {  // end of entry as it seems
+            ret = ARCHIVE_OK;
+        }
+        stream->flush();
+        stream->close();
+        if (ret == ARCHIVE_OK) {
+            restoreAttributes(file);
+        }
+    }
+    catch (const Glib::Error& err) {
+        setError(archiv, err, _("Writing content"));
+        ret = ARCHIVE_FAILED;
+        remove = true;
+    }
+    //std::cout << "   ret " << ret
+    //          << " remove " << std::boolalpha << remove << std::endl;
+    if (remove) {       // don't keep incomplete result
+        file->remove();
+    }
+    return ret;
+}
+
+// compare the next bytes of input, without buff with zeros (a sparse gap)
+static bool
+isSame(const Glib::RefPtr<Gio::InputStream>& input, const void* buff, size_t len, std::vector<uint8_t>& existing)
+{
+    if (len == 0) {
+        return true;
+    }
+    existing.resize(len);
+    gsize bytesRead{0};
+    input->read_all(existing.data(), len, bytesRead);
+    if (bytesRead != len) {
+        return false;
+    }
+    if (buff) {
+        return std::memcmp(existing.data(), buff, len) == 0;
+    }
+    return std::all_of(existing.begin(), existing.end(), [] (uint8_t byte) {
+        return byte == 0u;
+    });
+}
+
+Glib::RefPtr<Gio::FileOutputStream>
+ArchivExtractEntry::createPart(const Glib::RefPtr<Gio::File>& file, const Glib::RefPtr<Gio::File>& part, goffset same)
+{
+    auto output = part->replace();
+    auto input = file->read();
+    std::vector<uint8_t> block(PART_BLOCK);
+    while (same > 0) {
+        gsize bytesRead{0};
+        input->read_all(block.data(), static_cast<gsize>(std::min(same, static_cast<goffset>(block.size()))), bytesRead);
+        if (bytesRead == 0) {
+            throw Gio::Error(Gio::Error::FAILED, _("The existing file was truncated"));
+        }
+        gsize bytesWritten{0};
+        output->write_all(block.data(), bytesRead, bytesWritten);
+        same -= static_cast<goffset>(bytesRead);
+    }
+    input->close();
+    return output;
+}
+
+int
+ArchivExtractEntry::extractChanged(struct archive* archiv, const Glib::RefPtr<Gio::File>& file)
+{
+    int ret{ARCHIVE_OK};
+    // the existing is only replaced when complete, so it is kept on any error
+    auto part = file->get_parent()->get_child("." + file->get_basename() + PART_SUFFIX);
+    try {
+        auto info = file->query_info(G_FILE_ATTRIBUTE_STANDARD_SIZE "," G_FILE_ATTRIBUTE_TIME_MODIFIED
+                                   , Gio::FileQueryInfoFlags::FILE_QUERY_INFO_NONE);
+        bool sameSize = info->get_size() == getSize();
+        if (m_mode == ExtractMode::SkipUnchanged
+         && sameSize
+         && info->get_modification_date_time().to_unix() == getModified()) {
+            return archive_read_data_skip(archiv);
+        }
+        // compare the content, as long as it is the same there is no need to write,
+        //   reading works for a read only file as well
+        Glib::RefPtr<Gio::FileInputStream> input;
+        if (m_mode == ExtractMode::Compare
+         && sameSize) {
+            input = file->read();
+        }
+        Glib::RefPtr<Gio::FileOutputStream> output;
+        if (!input) {
+            output = part->replace();
+        }
+        std::vector<uint8_t> existing;
+        goffset position{0};    // the same up to here
+        const void *buff;
+        size_t len{0l};
+        off_t offset{0l};
+        do {
+            ret = archive_read_data_block(archiv, &buff, &len, &offset);
+            if (ret == ARCHIVE_OK) {
+                IoScheduler::get()->acquire(static_cast<goffset>(len));
+                dataRead();
+                if (input) {
+                    if (isSame(input, nullptr, static_cast<size_t>(offset - position), existing)
+                     && isSame(input, buff, len, existing)) {
+                        position = offset + static_cast<goffset>(len);
+                        continue;
                     }
+                    // from the first difference write a copy
+                    input->close();
+                    input.reset();
+                    output = createPart(file, part, position);
+                }
+                output->seek(offset, Glib::SeekType::SEEK_TYPE_SET);
+                gsize bytesWritten{0};
+                output->write_all(buff, len, bytesWritten);
+                if (bytesWritten != len) {
+                    ret = ARCHIVE_FAILED;
                 }
-            } while (ret == ARCHIVE_OK);
-            if (ret == ARCHIVE_EOF) {  // end of entry as it seems
-                ret = ARCHIVE_OK;
-            }
-            stream->flush();
-            stream->close();
-            // restore user/group/date?
-#           ifndef __WIN32__
-            if (getPermission() > 0) {
-                file->set_attribute_uint32("unix::mode"
-                                         , getPermission()
-                                         , Gio::FileQueryInfoFlags::FILE_QUERY_INFO_NONE);
             }
-#           endif
+        } while (ret == ARCHIVE_OK);
+        if (ret == ARCHIVE_EOF) {  // end of entry as it seems
+            ret = ARCHIVE_OK;
         }
-        catch (const Glib::Error& err) {
-            setError(archiv, err, _("Writing content"));
-            ret = ARCHIVE_FAILED;
-            remove = true;
+        if (ret == ARCHIVE_OK
+         && input
+         && !isSame(input, nullptr, static_cast<size_t>(getSize() - position), existing)) {
+            input->close();     // a trailing sparse gap that differs
+            input.reset();
+            output = createPart(file, part, position);
         }
-        //std::cout << "   ret " << ret
-        //          << " remove " << std::boolalpha << remove << std::endl;
-        if (remove) {       // don't keep incomplete result
-            file->remove();
+        if (input) {
+            input->close();
+        }
+        if (output) {
+            if (ret == ARCHIVE_OK
+             && output->tell() < getSize()) {
+                output->truncate(getSize());    // a trailing sparse gap
+            }
+            output->close();
+            if (ret == ARCHIVE_OK) {
+                restoreAttributes(part);
+                part->move(file, Gio::FILE_COPY_OVERWRITE | Gio::FILE_COPY_NOFOLLOW_SYMLINKS);
+            }
+            else {
+                part->remove();
+            }
+        }
+        else if (ret == ARCHIVE_OK) {
+            restoreAttributes(file);
         }
     }
-    else {
-        std::cout << "ArchivExtractEntry::handleContent unhandeld mode " << getMode() << std::endl;
+    catch (const Glib::Error& err) {
+        setError(archiv, err, _("Writing content"));
+        ret = ARCHIVE_FAILED;
+        try {
+            if (part->query_exists()) {
+                part->remove();
+            }
+        }
+        catch (const Glib::Error& removeErr) {
+            std::cout << "ArchivExtractEntry::extractChanged error " << removeErr.what() << std::endl;
+        }
     }
     return ret;
 }
 
+void
+ArchivExtractEntry::restoreAttributes(const Glib::RefPtr<Gio::File>& file)
+{
+    // restore user/group?
+#   ifndef __WIN32__
+    if (getPermission() > 0) {
+        file->set_attribute_uint32("unix::mode"
+                                 , getPermission()
+                                 , Gio::FileQueryInfoFlags::FILE_QUERY_INFO_NONE);
+    }
+#   endif
+    // keep the modification time, so a repeated extraction may skip unchanged
+    if (getModified() > 0) {
+        file->set_attribute_uint64(G_FILE_ATTRIBUTE_TIME_MODIFIED
+                                 , static_cast<guint64>(getModified())
+                                 , Gio::FileQueryInfoFlags::FILE_QUERY_INFO_NONE);
+    }
+}
+
 bool
 ArchivExtractEntry::isUsed()
 {
     return m_dir.operator bool();
 }
 
+ExtractJournal::ExtractJournal(
+              const Glib::RefPtr<Gio::File>& dir
+            , const Glib::RefPtr<Gio::File>& archivFile
+            , const std::vector<Glib::ustring>& nested
+            , const std::set<Glib::ustring>& items)
+: m_journal{dir->get_child(JOURNAL_NAME)}
+, m_archivFile{archivFile}
+, m_nested{nested}
+, m_items{items}
+{
+}
+
+// identifies the archiv and the selection, if either was changed we can't resume
+std::string
+ExtractJournal::getIdentity()
+{
+    if (m_identity.empty()) {
+        auto info = m_archivFile->query_info(G_FILE_ATTRIBUTE_STANDARD_SIZE "," G_FILE_ATTRIBUTE_TIME_MODIFIED
+                                           , Gio::FileQueryInfoFlags::FILE_QUERY_INFO_NONE);
+        m_identity = Glib::ustring::sprintf("%s %" G_GOFFSET_FORMAT " %" G_GINT64_FORMAT
+                                , m_archivFile->get_uri()
+                                , info->get_size()
+                                , info->get_modification_date_time().to_unix()).raw();
+        for (auto& member : m_nested) {
+            m_identity += " > " + member.raw();
+        }
+        // the members are counted, so a other selection counts others
+        Glib::Checksum checksum(Glib::Checksum::ChecksumType::CHECKSUM_SHA256);
+        for (auto& item : m_items) {
+            checksum.update(item.raw() + "\n");
+        }
+        m_identity += " items " + checksum.get_string();
+    }
+    return m_identity;
+}
+
+size_t
+ExtractJournal::load()
+{
+    size_t completed{0};
+    try {
+        if (m_journal->query_exists()) {
+            std::istringstream lines{Glib::file_get_contents(m_journal->get_path())};
+            std::string identity;
+            std::string count;
+            if (std::getline(lines, identity)
+             && std::getline(lines, count)
+             && identity == getIdentity()) {
+                completed = std::stoul(count);
+            }
+        }
+    }
+    catch (const std::exception& exc) {     // start from the beginning
+        std::cout << "ExtractJournal::load error " << exc.what() << std::endl;
+    }
+    catch (const Glib::Error& err) {
+        std::cout << "ExtractJournal::load error " << err.what() << std::endl;
+    }
+    m_saved = completed;
+    return completed;
+}
+
+void
+ExtractJournal::completed(size_t count, bool force)
+{
+    auto now = g_get_monotonic_time();
+    if (count <= m_saved
+     || (!force && now - m_lastSave < SAVE_INTERVAL_US)) {
+        return;
+    }
+    try {
+        std::string content = getIdentity() + "\n" + std::to_string(count) + "\n";
+        std::string etag;
+        m_journal->replace_contents(content, "", etag, false, Gio::FileCreateFlags::FILE_CREATE_REPLACE_DESTINATION);
+        m_saved = count;
+        m_lastSave = now;
+    }
+    catch (const Glib::Error& err) {    // the extraction works without
+        std::cout << "ExtractJournal::completed error " << err.what() << std::endl;
+    }
+}
+
+void
+ExtractJournal::remove()
+{
+    try {
+        if (m_journal->query_exists()) {
+            m_journal->remove();
+        }
+    }
+    catch (const Glib::Error& err) {
+        std::cout << "ExtractJournal::remove error " << err.what() << std::endl;
+    }
+}
+
 // use additional listener for processing in main thread
 ArchivExtractWorker::ArchivExtractWorker(
               const Glib::RefPtr<Gio::File>& archiveFile
             , const Glib::RefPtr<Gio::File>& extractDir
             , const std::vector<PtrEventItem>& items
+            , const std::vector<Glib::ustring>& nested
+            , ExtractMode mode
+            , bool resume
             , ArchivListener* archivListener)
 : ThreadWorker()
 , ArchivListener()
 , m_archivFile{archiveFile}
 , m_extractDir{extractDir}
+, m_nested{nested}
+, m_mode{mode}
+, m_resume{resume}
 , m_archivListener{archivListener}
 {
     for (auto& item : items) {
@@ -169,13 +447,19 @@ ArchivExtractWorker::createEntry(struct archive_entry *entry)
 {
     Glib::RefPtr<Gio::File> dir;
     Glib::ustring path = archive_entry_pathname_utf8(entry);
-    if (m_items.empty() || m_items.contains(path)) {
+    ++m_member;
+    // as the read stops on the first error the previous were completed
+    m_journal->completed(m_member - 1);
+    if (m_member <= m_skip) {
+        // keep dir empty, as extracted before
+    }
+    else if (m_items.empty() || m_items.contains(path)) {
         dir = m_extractDir;
         //std::cout << "ArchivExtractWorker::createEntry extract " << path
         //          << " items " << m_items.size()
         //          << " dir " << (m_extractDir ? m_extractDir->get_path() : std::string("noDir")) << std::endl;
     }
-    return std::make_shared<ArchivExtractEntry>(entry, dir);
+    return std::make_shared<ArchivExtractEntry>(entry, dir, m_mode);
 }
 
 void
@@ -194,12 +478,35 @@ ArchivExtractWorker::archivDone(ArchivSummary archivSummary, const Glib::ustring
     m_archivSummary = archivSummary;
 }
 
+void
+ArchivExtractWorker::archivProgress(const ArchivProgress& progress)
+{
+    // this is called from thread context, the empty entry signals progress
+    {
+        std::lock_guard<std::mutex> lock(m_progressMutex);
+        m_progress = progress;
+    }
+    notify(PtrArchivExtractEntry());
+}
+
 ArchivSummary
 ArchivExtractWorker::doInBackground()
 {
     //std::cout << "ArchivWorker::doInBackground " << m_file->get_path() << std::endl;
-    Archiv archiv(m_archivFile);
-    archiv.read(this);
+    m_journal = std::make_unique<ExtractJournal>(m_extractDir, m_archivFile, m_nested, m_items);
+    m_member = 0;
+    m_skip = m_resume ? m_journal->load() : 0;
+    auto archiv = Archiv::create(m_archivFile);
+    archiv->setNested(m_nested);
+    try {
+        archiv->read(this);
+    }
+    catch (...) {
+        // keep what was completed for resume
+        m_journal->completed(m_member > 0 ? m_member - 1 : 0, true);
+        throw;
+    }
+    m_journal->remove();
     return m_archivSummary;
 }
 
@@ -209,7 +516,15 @@ ArchivExtractWorker::process(const std::vector<PtrArchivExtractEntry>& entries)
     // here we are back to main thread ...
     for (auto entry : entries) {
         //std::cout << "main archiv path " << entry->getPath() << std::endl;
-        if (entry->isUsed()) {
+        if (!entry) {
+            ArchivProgress progress;
+            {
+                std::lock_guard<std::mutex> lock(m_progressMutex);
+                progress = m_progress;
+            }
+            m_archivListener->archivProgress(progress);
+        }
+        else if (entry->isUsed()) {
             m_archivListener->archivUpdate(entry);
         }
     }
@@ -236,15 +551,19 @@ ExtractDialog::ExtractDialog(
     , const Glib::RefPtr<Gtk::Builder>& builder
     , const Glib::RefPtr<Gio::File>& file
     , const std::vector<PtrEventItem>& items
+    , const std::vector<Glib::ustring>& nested
     , Gtk::Window* win)
 : Gtk::Dialog(cobject)
 , ArchivListener()
 , m_file{file}
 , m_items{items}
+, m_nested{nested}
 , m_win{win}
 {
     builder->get_widget("archive", m_archive);
     builder->get_widget("target", m_target);
+    builder->get_widget("mode", m_mode);
+    builder->get_widget("resume", m_resume);
     builder->get_widget("progress", m_progress);
     builder->get_widget("info", m_info);
     builder->get_widget("cancel", m_cancel);
@@ -252,8 +571,13 @@ ExtractDialog::ExtractDialog(
     builder->get_widget("apply", m_apply);
     m_apply->set_sensitive(false);
     m_open->set_sensitive(false);
+    IoScheduler::connect(builder);
 
-    m_archive->set_text(file->get_path());
+    Glib::ustring archivName = file->get_path();
+    for (auto& member : m_nested) {
+        archivName += " > " + member;
+    }
+    m_archive->set_text(archivName);
     m_target->signal_selection_changed().connect(
             sigc::mem_fun(*this, &ExtractDialog::selected));
     m_apply->signal_clicked().connect(
@@ -284,8 +608,18 @@ ExtractDialog::extract()
     m_dir = m_target->get_file();
     m_apply->set_sensitive(false);
     m_target->set_sensitive(false);
+    m_mode->set_sensitive(false);
+    m_resume->set_sensitive(false);
     m_cancel->set_sensitive(false);     // while working don't allow close
-    m_archivExtractWorker = std::make_shared<ArchivExtractWorker>(m_file, m_dir, m_items, this);
+    ExtractMode mode{ExtractMode::Replace};
+    auto id = m_mode->get_active_id();
+    if (id == "check") {
+        mode = ExtractMode::SkipUnchanged;
+    }
+    else if (id == "compare") {
+        mode = ExtractMode::Compare;
+    }
+    m_archivExtractWorker = std::make_shared<ArchivExtractWorker>(m_file, m_dir, m_items, m_nested, mode, m_resume->get_active(), this);
     //std::cout << "ArchiveDataSource::update" << m_archivWorker.get() << std::endl;
     m_archivExtractWorker->execute();
 }
@@ -293,15 +627,27 @@ ExtractDialog::extract()
 void
 ExtractDialog::archivUpdate(const PtrArchivEntry& entry)
 {
+    // the display is updated with the progress, to keep the load low
     ++m_extracted;
-    if (m_items.size() > 0) {
-        auto fract = static_cast<double>(m_extracted) / static_cast<double>(m_items.size());
+    m_lastPath = entry->getPath();
+}
+
+void
+ExtractDialog::archivProgress(const ArchivProgress& progress)
+{
+    auto fract = progress.getFraction();
+    if (fract < 0.0
+     && m_items.size() > 0) {
+        fract = static_cast<double>(m_extracted) / static_cast<double>(m_items.size());
+    }
+    if (fract >= 0.0) {
         m_progress->set_fraction(fract);
     }
     else {
         m_progress->pulse();    // show as unknown
     }
-    m_progress->set_text(entry->getPath());
+    m_progress->set_text(m_lastPath);
+    m_info->set_text(progress.format());
 }
 
 void
@@ -329,6 +675,7 @@ Glib::RefPtr<Gio::File>
 ExtractDialog::show(
                   const Glib::RefPtr<Gio::File>& file
                 , const std::vector<PtrEventItem>& items
+                , const std::vector<Glib::ustring>& nested
                 , Gtk::Window* win)
 {
     ExtractDialog* extractDialog = nullptr;
@@ -336,7 +683,7 @@ ExtractDialog::show(
     Glib::RefPtr<Gio::File> ret;
     try {
         builder->add_from_resource(win->get_application()->get_resource_base_path() + "/dlgExtract.ui");
-        builder->get_widget_derived("dlgProgress", extractDialog, file, items, win);
+        builder->get_widget_derived("dlgProgress", extractDialog, file, items, nested, win);
         extractDialog->set_transient_for(*win);
         if (extractDialog->run() == Gtk::ResponseType::RESPONSE_OK) {
             ret = extractDialog->getDirectory();
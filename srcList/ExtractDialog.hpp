@@ -20,6 +20,7 @@
 
 #include <memory>
 #include <set>
+#include <mutex>
 #include <gtkmm.h>
 
 #include "Archiv.hpp"
@@ -27,17 +28,71 @@
 #include "ArchiveDataSource.hpp"
 
 
+enum class ExtractMode
+{
+      Replace
+    , SkipUnchanged     // keep files with same size and modification time
+    , Compare           // keep files with same size and content
+};
+
 class ArchivExtractEntry
 : public ArchivEntry
 {
 public:
-    ArchivExtractEntry(struct archive_entry *entry, const Glib::RefPtr<Gio::File>& dir);
+    ArchivExtractEntry(struct archive_entry *entry, const Glib::RefPtr<Gio::File>& dir, ExtractMode mode = ExtractMode::Replace);
     virtual ~ArchivExtractEntry() = default;
 
     int handleContent(struct archive* archiv) override;
     bool isUsed();
+
+    static constexpr auto PART_SUFFIX{".varsel-part"};
+    static constexpr size_t PART_BLOCK{64u * 1024u};
+protected:
+    int extractFile(struct archive* archiv, const Glib::RefPtr<Gio::File>& file);
+    // writes a copy from the first difference, that replaces the existing when complete
+    int extractChanged(struct archive* archiv, const Glib::RefPtr<Gio::File>& file);
+    // a copy of the existing file, with the bytes that are the same
+    Glib::RefPtr<Gio::FileOutputStream> createPart(const Glib::RefPtr<Gio::File>& file, const Glib::RefPtr<Gio::File>& part, goffset same);
+    void restoreAttributes(const Glib::RefPtr<Gio::File>& file);
 private:
     Glib::RefPtr<Gio::File> m_dir;
+    ExtractMode m_mode;
+};
+
+/**
+ * remembers the members completed by a extraction
+ *   so a interrupted extraction may resume from there.
+ *   The journal is kept in the target directory and
+ *   removed when the extraction completes.
+ */
+class ExtractJournal
+{
+public:
+    ExtractJournal(const Glib::RefPtr<Gio::File>& dir
+                 , const Glib::RefPtr<Gio::File>& archivFile
+                 , const std::vector<Glib::ustring>& nested
+                 , const std::set<Glib::ustring>& items);
+    explicit ExtractJournal(const ExtractJournal& orig) = delete;
+    virtual ~ExtractJournal() = default;
+
+    // @return the count of completed members if the journal is for the same archiv
+    size_t load();
+    // saves at most once per interval unless forced
+    void completed(size_t count, bool force = false);
+    void remove();
+
+    static constexpr auto JOURNAL_NAME{".varsel-extract"};
+    static constexpr gint64 SAVE_INTERVAL_US{1000000l};
+private:
+    std::string getIdentity();
+
+    Glib::RefPtr<Gio::File> m_journal;
+    Glib::RefPtr<Gio::File> m_archivFile;
+    std::vector<Glib::ustring> m_nested;
+    std::set<Glib::ustring> m_items;
+    std::string m_identity;
+    size_t m_saved{0};
+    gint64 m_lastSave{0};
 };
 
 using PtrArchivExtractEntry = std::shared_ptr<ArchivExtractEntry>;
@@ -51,6 +106,9 @@ public:
               const Glib::RefPtr<Gio::File>& archiveFile
             , const Glib::RefPtr<Gio::File>& extractDir
             , const std::vector<PtrEventItem>& items
+            , const std::vector<Glib::ustring>& nested
+            , ExtractMode mode
+            , bool resume
             , ArchivListener* archivListener);
     explicit ArchivExtractWorker(const ArchivExtractWorker& orig) = delete;
     virtual ~ArchivExtractWorker() = default;
@@ -58,6 +116,7 @@ public:
     PtrArchivEntry createEntry(struct archive_entry *entry) override;
     void archivUpdate(const std::shared_ptr<ArchivEntry>& entry) override;
     void archivDone(ArchivSummary archivSummary, const Glib::ustring& msg) override;
+    void archivProgress(const ArchivProgress& progress) override;
 
 protected:
 
@@ -70,8 +129,16 @@ private:
     Glib::RefPtr<Gio::File> m_archivFile;
     Glib::RefPtr<Gio::File> m_extractDir;
     std::set<Glib::ustring> m_items;
+    std::vector<Glib::ustring> m_nested;
+    ExtractMode m_mode;
+    bool m_resume;
+    std::unique_ptr<ExtractJournal> m_journal;
+    size_t m_member{0};     // the ordinal of the member in the archiv
+    size_t m_skip{0};       // completed by a previous extraction
     ArchivSummary m_archivSummary;
     ArchivListener* m_archivListener;
+    std::mutex m_progressMutex;
+    ArchivProgress m_progress;  // passed to main thread by a empty entry
 };
 
 
@@ -85,14 +152,17 @@ public:
         , const Glib::RefPtr<Gtk::Builder>& builder
         , const Glib::RefPtr<Gio::File>& file
         , const std::vector<PtrEventItem>& items
+        , const std::vector<Glib::ustring>& nested
         , Gtk::Window* win);
     virtual ~ExtractDialog() = default;
     void archivUpdate(const PtrArchivEntry& entry) override;
     void archivDone(ArchivSummary archivSummary, const Glib::ustring& msg) override;
+    void archivProgress(const ArchivProgress& progress) override;
     Glib::RefPtr<Gio::File> getDirectory();
     static Glib::RefPtr<Gio::File> show(
                  const Glib::RefPtr<Gio::File>& file
                 , const std::vector<PtrEventItem>& items
+                , const std::vector<Glib::ustring>& nested
                 , Gtk::Window* win);
 protected:
     void selected();
@@ -103,15 +173,19 @@ private:
     Glib::RefPtr<Gio::File> m_file;
     Glib::RefPtr<Gio::File> m_dir;
     std::vector<PtrEventItem> m_items;
+    std::vector<Glib::ustring> m_nested;
     Gtk::Window* m_win;
     std::shared_ptr<ArchivExtractWorker> m_archivExtractWorker;
 
     Gtk::Label* m_archive;
     Gtk::FileChooserButton* m_target;
+    Gtk::ComboBoxText* m_mode;
+    Gtk::CheckButton* m_resume;
     Gtk::ProgressBar* m_progress;
     Gtk::Label* m_info;
     Gtk::Button* m_cancel;
     Gtk::Button* m_open;
     Gtk::Button* m_apply;
     uint32_t m_extracted{};
+    Glib::ustring m_lastPath;
 };
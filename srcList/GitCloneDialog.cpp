@@ -0,0 +1,342 @@
+/* -*- Mode: c++; c-basic-offset: 4; tab-width: 4; coding: utf-8; -*-  */
+/*
+ * Copyright (C) 2025 RPf
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <psc_i18n.hpp>
+#include <psc_format.hpp>
+
+#include "GitCloneDialog.hpp"
+
+GitTransferWorker::GitTransferWorker(const std::string& url, const std::string& path, const std::string& remote, GitCloneDialog* gitCloneDialog)
+: ThreadWorker()
+, m_url{url}
+, m_path{path}
+, m_remote{remote}
+, m_gitCloneDialog{gitCloneDialog}
+{
+}
+
+void
+GitTransferWorker::cancel()
+{
+    m_cancel = true;
+}
+
+void
+GitTransferWorker::detach()
+{
+    m_cancel = true;
+    m_gitCloneDialog = nullptr;     // as we are called from main thread this is safe
+}
+
+bool
+GitTransferWorker::isDue(bool last)
+{
+    auto now = g_get_monotonic_time();
+    if (last
+     || now - m_lastNotify >= PROGRESS_INTERVAL_US) {
+        m_lastNotify = now;
+        return true;
+    }
+    return false;
+}
+
+int
+GitTransferWorker::fetchProgress(const git_indexer_progress *stats)
+{
+    // this is called from thread context for every object
+    m_progress.receivedObjects = stats->received_objects;
+    m_progress.totalObjects = stats->total_objects;
+    m_progress.indexedDeltas = stats->indexed_deltas;
+    m_progress.totalDeltas = stats->total_deltas;
+    m_progress.receivedBytes = stats->received_bytes;
+    bool last = stats->received_objects == stats->total_objects
+             && stats->indexed_deltas == stats->total_deltas;
+    if (isDue(last)) {
+        notify(m_progress);
+    }
+    return m_cancel ? -1 : 0;
+}
+
+void
+GitTransferWorker::checkoutProgress(const char *path, size_t current, size_t total)
+{
+    m_progress.checkout = true;
+    m_progress.checkoutCurrent = current;
+    m_progress.checkoutTotal = total;
+    if (isDue(current == total)) {
+        notify(m_progress);
+    }
+}
+
+bool
+GitTransferWorker::doInBackground()
+{
+    if (m_url.empty()) {
+        psc::git::Repository repository(m_path);
+        repository.setFetchListener(this);
+        repository.fetch(m_remote);
+    }
+    else {
+        psc::git::Repository repository(m_path, false);
+        repository.setFetchListener(this);
+        repository.setCheckoutListener(this);
+        repository.clone(m_url);
+    }
+    return true;    // a cancel is reported by libgit2 as error
+}
+
+void
+GitTransferWorker::process(const std::vector<GitTransferProgress>& progress)
+{
+    // here we are back to main thread, only the latest state is of interest
+    if (m_gitCloneDialog && !progress.empty()) {
+        m_gitCloneDialog->progress(progress.back());
+    }
+}
+
+void
+GitTransferWorker::done()
+{
+    Glib::ustring msg;
+    bool completed{false};
+    try {
+        completed = getResult();
+    }
+    catch (const psc::git::GitException& exc) {
+        msg = exc.what();
+    }
+    if (m_gitCloneDialog) {
+        m_gitCloneDialog->transferDone(completed, msg);
+    }
+}
+
+GitCloneDialog::GitCloneDialog(Gtk::Window* win, const Glib::RefPtr<Gio::File>& repos)
+: Gtk::Dialog(repos ? _("Fetch") : _("Clone"), *win, true)
+, m_repos{repos}
+, m_parent(_("Clone into"), Gtk::FileChooserAction::FILE_CHOOSER_ACTION_SELECT_FOLDER)
+, m_start(repos ? _("_Fetch") : _("_Clone"), true)
+, m_stop(_("_Close"), true)
+{
+    set_default_size(480, -1);
+    m_grid.set_row_spacing(6);
+    m_grid.set_column_spacing(6);
+    m_grid.set_border_width(8);
+    int row{0};
+    auto addRow = [&](const Glib::ustring& label, Gtk::Widget& widget) {
+        auto labelWidget = Gtk::make_managed<Gtk::Label>(label);
+        labelWidget->set_xalign(0.0f);
+        m_grid.attach(*labelWidget, 0, row, 1, 1);
+        widget.set_hexpand(true);
+        m_grid.attach(widget, 1, row, 1, 1);
+        ++row;
+    };
+    if (repos) {
+        m_name.set_text("origin");
+        addRow(_("Remote"), m_name);
+    }
+    else {
+        addRow(_("Url"), m_url);
+        m_parent.set_current_folder(Glib::get_home_dir());
+        addRow(_("Into"), m_parent);
+        addRow(_("Name"), m_name);
+        m_url.signal_changed().connect(
+                sigc::mem_fun(*this, &GitCloneDialog::urlChanged));
+    }
+    m_grid.attach(m_progress, 0, row++, 2, 1);
+    m_info.set_xalign(0.0f);
+    m_info.set_ellipsize(Pango::EllipsizeMode::ELLIPSIZE_MIDDLE);
+    m_grid.attach(m_info, 0, row++, 2, 1);
+    m_buttons.set_layout(Gtk::ButtonBoxStyle::BUTTONBOX_END);
+    m_buttons.set_spacing(6);
+    m_buttons.pack_start(m_stop);
+    m_buttons.pack_start(m_start);
+    m_grid.attach(m_buttons, 0, row++, 2, 1);
+    get_content_area()->pack_start(m_grid);
+    m_start.signal_clicked().connect(
+            sigc::mem_fun(*this, &GitCloneDialog::start));
+    m_stop.signal_clicked().connect(
+            sigc::mem_fun(*this, &GitCloneDialog::stop));
+}
+
+GitCloneDialog::~GitCloneDialog()
+{
+    if (m_transferWorker) {
+        m_transferWorker->detach();
+    }
+}
+
+void
+GitCloneDialog::urlChanged()
+{
+    // propose the name git would use
+    auto url = m_url.get_text();
+    while (url.length() > 1
+        && url[url.length() - 1] == '/') {
+        url = url.substr(0, url.length() - 1);
+    }
+    auto pos = url.find_last_of("/:");
+    auto name = pos != Glib::ustring::npos
+                ? url.substr(pos + 1)
+                : url;
+    if (name.length() > 4
+     && name.substr(name.length() - 4) == ".git") {
+        name = name.substr(0, name.length() - 4);
+    }
+    m_name.set_text(name);
+}
+
+void
+GitCloneDialog::start()
+{
+    std::string url;
+    std::string path;
+    std::string remote;
+    if (m_repos) {
+        path = m_repos->get_path();
+        remote = m_name.get_text();
+    }
+    else {
+        url = m_url.get_text();
+        auto parent = m_parent.get_file();
+        if (url.empty() || !parent || m_name.get_text().empty()) {
+            m_info.set_text(_("Enter the url and target to clone."));
+            return;
+        }
+        m_target = parent->get_child(m_name.get_text());
+        path = m_target->get_path();
+    }
+    m_canceled = false;
+    m_url.set_sensitive(false);
+    m_parent.set_sensitive(false);
+    m_name.set_sensitive(false);
+    m_start.set_sensitive(false);
+    m_stop.set_label(_("_Cancel"));
+    m_progress.set_fraction(0.0);
+    m_info.set_text(_("Connecting..."));
+    m_transferWorker = std::make_shared<GitTransferWorker>(url, path, remote, this);
+    m_transferWorker->execute();
+}
+
+void
+GitCloneDialog::stop()
+{
+    if (m_transferWorker) {
+        m_canceled = true;
+        m_transferWorker->cancel();
+        m_info.set_text(_("Canceling..."));
+        return;     // closed when done
+    }
+    if (m_loop) {
+        m_loop->quit();
+    }
+}
+
+bool
+GitCloneDialog::on_delete_event(GdkEventAny* any_event)
+{
+    stop();
+    return true;    // the loop decides about closing
+}
+
+void
+GitCloneDialog::progress(const GitTransferProgress& progress)
+{
+    if (progress.checkout) {
+        if (progress.checkoutTotal > 0) {
+            m_progress.set_fraction(static_cast<double>(progress.checkoutCurrent) / static_cast<double>(progress.checkoutTotal));
+        }
+        m_info.set_text(Glib::ustring::sprintf(_("Checkout %lu/%lu")
+                        , progress.checkoutCurrent, progress.checkoutTotal));
+    }
+    else if (progress.totalObjects > 0
+          && progress.receivedObjects < progress.totalObjects) {
+        m_progress.set_fraction(static_cast<double>(progress.receivedObjects) / static_cast<double>(progress.totalObjects));
+        m_info.set_text(Glib::ustring::sprintf(_("Objects %u/%u %s")
+                        , progress.receivedObjects, progress.totalObjects
+                        , Glib::format_size(progress.receivedBytes)));
+    }
+    else if (progress.totalDeltas > 0) {
+        m_progress.set_fraction(static_cast<double>(progress.indexedDeltas) / static_cast<double>(progress.totalDeltas));
+        m_info.set_text(Glib::ustring::sprintf(_("Resolving deltas %u/%u")
+                        , progress.indexedDeltas, progress.totalDeltas));
+    }
+}
+
+void
+GitCloneDialog::transferDone(bool completed, const Glib::ustring& errMsg)
+{
+    m_transferWorker.reset();
+    if (completed && errMsg.empty()) {
+        m_completed = true;
+        if (!m_repos) {
+            psc::git::RepositoryCache::clear();     // the target is a repository now
+        }
+        m_progress.set_fraction(1.0);
+        if (m_loop) {
+            m_loop->quit();
+        }
+        return;
+    }
+    m_target.reset();
+    if (m_canceled) {
+        if (m_loop) {
+            m_loop->quit();
+        }
+        return;
+    }
+    std::cout << "Error " << errMsg << " transfer " << std::endl;
+    // allow to correct the input and try again
+    m_info.set_text(errMsg);
+    m_url.set_sensitive(true);
+    m_parent.set_sensitive(true);
+    m_name.set_sensitive(true);
+    m_start.set_sensitive(true);
+    m_stop.set_label(_("_Close"));
+}
+
+Glib::RefPtr<Gio::File>
+GitCloneDialog::getTarget()
+{
+    return m_target;
+}
+
+void
+GitCloneDialog::runLoop()
+{
+    show_all();
+    m_loop = Glib::MainLoop::create();
+    m_loop->run();
+    hide();
+}
+
+Glib::RefPtr<Gio::File>
+GitCloneDialog::clone(Gtk::Window* win)
+{
+    GitCloneDialog gitCloneDialog(win, Glib::RefPtr<Gio::File>());
+    gitCloneDialog.runLoop();
+    return gitCloneDialog.getTarget();
+}
+
+bool
+GitCloneDialog::fetch(const Glib::RefPtr<Gio::File>& repos, Gtk::Window* win)
+{
+    GitCloneDialog gitCloneDialog(win, repos);
+    gitCloneDialog.runLoop();
+    return gitCloneDialog.m_completed;
+}
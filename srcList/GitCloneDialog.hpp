@@ -0,0 +1,128 @@
+/* -*- Mode: c++; c-basic-offset: 4; tab-width: 4; coding: utf-8; -*-  */
+/*
+ * Copyright (C) 2025 RPf
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gtkmm.h>
+#include <atomic>
+#include <memory>
+
+#include "GitRepository.hpp"
+#include "ThreadWorker.hpp"
+
+class GitCloneDialog;
+
+// the state of a clone or fetch
+class GitTransferProgress
+{
+public:
+    unsigned int receivedObjects{0};
+    unsigned int totalObjects{0};
+    unsigned int indexedDeltas{0};
+    unsigned int totalDeltas{0};
+    size_t receivedBytes{0};
+    size_t checkoutCurrent{0};
+    size_t checkoutTotal{0};
+    bool checkout{false};
+};
+
+/**
+ * clone or fetch in background,
+ *   the progress callbacks of libgit2 are called for any object,
+ *   so they are passed on at most every PROGRESS_INTERVAL_US.
+ *   A cancel is passed to libgit2 by the return of the fetch progress.
+ */
+class GitTransferWorker
+: public ThreadWorker<GitTransferProgress, bool>
+, public psc::git::FetchListener
+, public psc::git::CheckoutListener
+{
+public:
+    // url empty to fetch remote into the repository at path
+    GitTransferWorker(const std::string& url, const std::string& path, const std::string& remote, GitCloneDialog* gitCloneDialog);
+    explicit GitTransferWorker(const GitTransferWorker& orig) = delete;
+    virtual ~GitTransferWorker() = default;
+
+    // stops at the next progress of the fetch, the checkout is not interrupted
+    void cancel();
+    // no longer report to the dialog
+    void detach();
+    int fetchProgress(const git_indexer_progress *stats) override;
+    void checkoutProgress(const char *path, size_t current, size_t total) override;
+
+    static constexpr gint64 PROGRESS_INTERVAL_US{100000l};
+protected:
+    bool doInBackground() override;
+    void process(const std::vector<GitTransferProgress>& progress) override;
+    void done() override;
+    bool isDue(bool last);
+
+private:
+    std::string m_url;
+    std::string m_path;
+    std::string m_remote;
+    GitCloneDialog* m_gitCloneDialog;
+    gint64 m_lastNotify{0};
+    GitTransferProgress m_progress;
+    std::atomic<bool> m_cancel{false};
+};
+
+/**
+ * clone a repository or fetch a remote with progress,
+ *   the dialog stays responsive and allows to cancel.
+ */
+class GitCloneDialog
+: public Gtk::Dialog
+{
+public:
+    // repos nullptr to clone
+    GitCloneDialog(Gtk::Window* win, const Glib::RefPtr<Gio::File>& repos);
+    explicit GitCloneDialog(const GitCloneDialog& orig) = delete;
+    virtual ~GitCloneDialog();
+
+    void progress(const GitTransferProgress& progress);
+    void transferDone(bool completed, const Glib::ustring& errMsg);
+    Glib::RefPtr<Gio::File> getTarget();
+
+    // @return the cloned repository, nullptr if none
+    static Glib::RefPtr<Gio::File> clone(Gtk::Window* win);
+    static bool fetch(const Glib::RefPtr<Gio::File>& repos, Gtk::Window* win);
+protected:
+    void start();
+    void stop();
+    void urlChanged();
+    void runLoop();
+    bool on_delete_event(GdkEventAny* any_event) override;
+
+private:
+    Glib::RefPtr<Gio::File> m_repos;
+    Glib::RefPtr<Gio::File> m_target;
+    Gtk::Grid m_grid;
+    Gtk::Entry m_url;
+    Gtk::FileChooserButton m_parent;
+    Gtk::Entry m_name;
+    Gtk::ProgressBar m_progress;
+    Gtk::Label m_info;
+    Gtk::ButtonBox m_buttons;
+    Gtk::Button m_start;
+    Gtk::Button m_stop;
+    Glib::RefPtr<Glib::MainLoop> m_loop;
+    bool m_canceled{false};
+    bool m_completed{false};
+    std::shared_ptr<GitTransferWorker> m_transferWorker;
+};
@@ -17,14 +17,83 @@
  */
 
 #include <iostream>
+#include <climits>
+#include <fcntl.h>
+#include <grp.h>
+#include <pwd.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <StringUtils.hpp>
+#include <VarselConfig.hpp>
 
 #include "GitRepository.hpp"
 #include "GitDataSource.hpp"
 #include "FileDataSource.hpp"
+#include "GitLogDataSource.hpp"
+#include "GitTreeDataSource.hpp"
+#include "GitDiffView.hpp"
+#include "GitCloneDialog.hpp"
+#include "VarselList.hpp"
 
 
 std::shared_ptr<GitListColumns> GitTreeNode::m_gitListColumns;
+std::shared_ptr<GitTreeColumns> GitTreeNode::m_gitTreeColumns;
+
+void
+GitStatusCounts::count(psc::git::FileStatus workdir, psc::git::FileStatus index, int32_t delta)
+{
+    using enum psc::git::FileStatus;
+    if (workdir == Deleted || index == Deleted) {
+        deleted += delta;
+    }
+    else if (workdir == New || index == New) {
+        added += delta;
+    }
+    else if (workdir == Modified || workdir == Renamed || workdir == TypeChange
+          || index == Modified || index == Renamed || index == TypeChange) {
+        modified += delta;
+    }
+    else if (workdir == Ignore) {
+        ignored += delta;
+    }
+}
+
+void
+GitStatusCounts::add(const GitStatusCounts& other)
+{
+    modified += other.modified;
+    added += other.added;
+    deleted += other.deleted;
+    ignored += other.ignored;
+}
+
+void
+GitStatusCounts::clear()
+{
+    modified = 0;
+    added = 0;
+    deleted = 0;
+    ignored = 0;
+}
+
+Glib::ustring
+GitStatusCounts::format()
+{
+    Glib::ustring text;
+    auto append = [&](const char* kind, int32_t value) {
+        if (value > 0) {
+            if (!text.empty()) {
+                text += " ";
+            }
+            text += Glib::ustring::sprintf("%s%d", kind, value);
+        }
+    };
+    append("M", modified);
+    append("N", added);
+    append("D", deleted);
+    append("I", ignored);
+    return text;
+}
 
 GitTreeNode::GitTreeNode(const Glib::ustring& dir, unsigned long depth)
 : BaseTreeNode::BaseTreeNode(dir, depth)
@@ -32,6 +101,30 @@ GitTreeNode::GitTreeNode(const Glib::ustring& dir, unsigned long depth)
 {
 }
 
+std::shared_ptr<GitTreeColumns>
+GitTreeNode::getTreeColumns()
+{
+    if (!m_gitTreeColumns) {
+        m_gitTreeColumns = std::make_shared<GitTreeColumns>();
+    }
+    return m_gitTreeColumns;
+}
+
+void
+GitTreeNode::getValue(int column, Glib::ValueBase& value)
+{
+    if (column != 1) {
+        BaseTreeNode::getValue(column, value);
+        return;
+    }
+    using StringColumn = Gtk::TreeModelColumn<Glib::ustring>;
+    StringColumn::ValueType sValue;
+    sValue.init(StringColumn::ValueType::value_type());
+    sValue.set(m_counts.format());
+    value.init(sValue.value_type());
+    value = sValue;
+}
+
 std::shared_ptr<ListColumns>
 GitTreeNode::getListColumns()
 {
@@ -53,20 +146,331 @@ GitTreeNode::getEntries()
     return m_entries;
 }
 
+std::string
+GitTreeNode::getRepoPath()
+{
+    std::string path;
+    GitTreeNode* node = this;
+    while (node && node->getDepth() > 1) {
+        if (path.empty()) {
+            path = node->getDir().raw();
+        }
+        else {
+            path = node->getDir().raw() + "/" + path;
+        }
+        node = dynamic_cast<GitTreeNode*>(node->m_parent);
+    }
+    return path;
+}
+
+void
+GitTreeNode::clearEntries()
+{
+    m_entries->clear();
+    m_ownCounts.clear();
+    m_counts.clear();
+    for (auto& entry : m_nodes) {
+        auto child = std::dynamic_pointer_cast<GitTreeNode>(entry.second);
+        if (child) {
+            child->clearEntries();
+        }
+    }
+}
+
+void
+GitTreeNode::countEntry(psc::git::FileStatus workdir, psc::git::FileStatus index, int32_t delta)
+{
+    m_ownCounts.count(workdir, index, delta);
+}
+
+void
+GitTreeNode::countChange(psc::git::FileStatus workdir, psc::git::FileStatus index, int32_t delta)
+{
+    m_ownCounts.count(workdir, index, delta);
+    for (GitTreeNode* node = this; node; node = dynamic_cast<GitTreeNode*>(node->m_parent)) {
+        node->m_counts.count(workdir, index, delta);
+    }
+}
+
+void
+GitTreeNode::sumCounts()
+{
+    m_counts = m_ownCounts;
+    for (auto& entry : m_nodes) {
+        auto child = std::dynamic_pointer_cast<GitTreeNode>(entry.second);
+        if (child) {
+            child->sumCounts();
+            m_counts.add(child->m_counts);
+        }
+    }
+}
+
+const GitStatusCounts&
+GitTreeNode::getCounts()
+{
+    return m_counts;
+}
+
+void
+GitTreeNode::countsChanged(const Glib::RefPtr<psc::ui::TreeNodeModel>& treeModel)
+{
+    for (GitTreeNode* node = this; node; node = dynamic_cast<GitTreeNode*>(node->m_parent)) {
+        auto path = node->getPath();
+        treeModel->row_changed(path, treeModel->get_iter(path));
+    }
+}
+
+void
+GitTreeNode::subtreeChanged(const Glib::RefPtr<psc::ui::TreeNodeModel>& treeModel)
+{
+    auto path = getPath();
+    treeModel->row_changed(path, treeModel->get_iter(path));
+    for (auto& entry : m_nodes) {
+        auto child = std::dynamic_pointer_cast<GitTreeNode>(entry.second);
+        if (child) {
+            child->subtreeChanged(treeModel);
+        }
+    }
+}
+
+GitStatusWorker::GitStatusWorker(const Glib::RefPtr<Gio::File>& dir, const psc::git::StatusOptions& options, GitDataSource* gitDataSource)
+: ThreadWorker()
+, m_dir{dir}
+, m_options{options}
+, m_gitDataSource{gitDataSource}
+{
+}
+
+void
+GitStatusWorker::cancel()
+{
+    m_cancel = true;
+    m_gitDataSource = nullptr;  // as we are called from main thread this is safe
+}
+
+Glib::ustring
+GitStatReader::getUser(uint32_t uid)
+{
+    auto entry = m_users.find(uid);
+    if (entry != m_users.end()) {
+        return entry->second;
+    }
+    Glib::ustring user;
+    struct passwd pwd;
+    struct passwd* result{nullptr};
+    std::vector<char> buf(4096);
+    if (getpwuid_r(uid, &pwd, buf.data(), buf.size(), &result) == 0
+     && result) {
+        user = result->pw_name;
+    }
+    else {
+        user = std::to_string(uid);
+    }
+    m_users.insert(std::pair(uid, user));
+    return user;
+}
+
+Glib::ustring
+GitStatReader::getGroup(uint32_t gid)
+{
+    auto entry = m_groups.find(gid);
+    if (entry != m_groups.end()) {
+        return entry->second;
+    }
+    Glib::ustring groupName;
+    struct group grp;
+    struct group* result{nullptr};
+    std::vector<char> buf(4096);
+    if (getgrgid_r(gid, &grp, buf.data(), buf.size(), &result) == 0
+     && result) {
+        groupName = result->gr_name;
+    }
+    else {
+        groupName = std::to_string(gid);
+    }
+    m_groups.insert(std::pair(gid, groupName));
+    return groupName;
+}
+
+void
+GitStatReader::fillStat(int dirfd, const psc::git::FileStat& gitStat, GitStatusEntry& entry)
+{
+    if (gitStat.valid) {
+        entry.mode = gitStat.mode;
+        entry.size = gitStat.size;
+        entry.modified = gitStat.modified;
+        entry.user = getUser(gitStat.uid);
+        entry.group = getGroup(gitStat.gid);
+        entry.displayable = S_ISREG(gitStat.mode);
+        // git keeps only the executable bit, so this shows 0644 or 0755
+        //   (a stat for the actual permission would defeat the purpose)
+    }
+    if (!entry.displayable && dirfd >= 0) {
+        // modified, untracked or symlink so ask the filesystem
+        struct stat st;
+        if (fstatat(dirfd, entry.name.c_str(), &st, AT_SYMLINK_NOFOLLOW) != 0) {
+            return;     // gone e.g. deleted
+        }
+        entry.mode = st.st_mode;
+        entry.size = st.st_size;
+        entry.modified = st.st_mtime;
+        entry.user = getUser(st.st_uid);
+        entry.group = getGroup(st.st_gid);
+        entry.displayable = S_ISREG(st.st_mode);
+        if (S_ISLNK(st.st_mode)) {
+            std::vector<char> target(PATH_MAX);
+            auto len = readlinkat(dirfd, entry.name.c_str(), target.data(), target.size() - 1);
+            if (len > 0) {
+                entry.symLink.assign(target.data(), static_cast<size_t>(len));
+            }
+            // show links that point to a file
+            struct stat linked;
+            entry.displayable = fstatat(dirfd, entry.name.c_str(), &linked, 0) == 0
+                             && S_ISREG(linked.st_mode);
+        }
+    }
+    if (entry.displayable) {
+        // guess by name, as looking into the content would defeat the purpose
+        bool uncertain{false};
+        entry.contentType = Gio::content_type_guess(entry.name, nullptr, 0, uncertain);
+    }
+    entry.mode &= 07777;    // as permission
+}
+
+size_t
+GitStatusWorker::doInBackground()
+{
+    // this is called from thread context
+    size_t count{0};
+    psc::git::Repository repository(m_dir->get_path());
+    auto status = repository.getStatus(m_options);
+    int dirfd = ::open(m_dir->get_path().c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    auto batch = std::make_shared<std::vector<GitStatusEntry>>();
+    batch->reserve(BATCH_SIZE);
+    for (auto iter = status.begin(); iter != status.end() && !m_cancel; ++iter) {
+        GitStatusEntry entry;
+        if (!iter->getWorkdir().getNewPath().empty()) {
+            //if (!iter->getWorkdir().getOldPath().empty()) {
+            //    name += iter->getWorkdir().getOldPath() + " -> ";
+            //}
+            entry.name = iter->getWorkdir().getNewPath();
+        }
+        else {
+            entry.name = iter->getWorkdir().getOldPath();
+        }
+        if (entry.name.empty()) {
+            continue;
+        }
+        entry.workdir = iter->getWorkdir().getStatus();
+        entry.index = iter->getIndex().getStatus();
+        m_statReader.fillStat(dirfd, iter->getStat(), entry);
+        batch->push_back(entry);
+        ++count;
+        if (batch->size() >= BATCH_SIZE) {
+            notify(batch);
+            batch = std::make_shared<std::vector<GitStatusEntry>>();
+            batch->reserve(BATCH_SIZE);
+        }
+    }
+    if (dirfd >= 0) {
+        ::close(dirfd);
+    }
+    if (!batch->empty() && !m_cancel) {
+        notify(batch);
+    }
+    return count;
+}
+
+void
+GitStatusWorker::process(const std::vector<GitStatusBatch>& batches)
+{
+    // here we are back to main thread ...
+    for (auto& batch : batches) {
+        for (auto& entry : *batch) {
+            if (!m_gitDataSource) {
+                return;
+            }
+            m_gitDataSource->addStatus(entry);
+        }
+    }
+}
+
+void
+GitStatusWorker::done()
+{
+    Glib::ustring msg;
+    size_t count{0};
+    try {
+        count = getResult();
+    }
+    catch (const psc::git::GitException& exc) {
+        msg = exc.what();
+    }
+    catch (const Glib::Error& exc) {
+        msg = exc.what();
+    }
+    if (m_gitDataSource) {
+        m_gitDataSource->statusDone(count, msg);
+    }
+}
+
 GitDataSource::GitDataSource(ListApp* application)
 : FileDataSource(application)
 {
+    m_treeColumns = GitTreeNode::getTreeColumns();
+}
+
+GitDataSource::~GitDataSource()
+{
+    close();
+}
+
+void
+GitDataSource::close()
+{
+    if (m_statusWorker) {
+        m_statusWorker->cancel();
+    }
+    if (m_monitor) {
+        m_monitor->stop();
+        m_monitor.reset();
+    }
+    if (m_dirfd >= 0) {
+        ::close(m_dirfd);
+        m_dirfd = -1;
+    }
+    m_listListener = nullptr;
 }
 
-bool
-GitDataSource::isDisplayable(const Glib::RefPtr<Gio::File>& file)
+psc::git::StatusOptions
+GitDataSource::getStatusOptions(const Glib::RefPtr<Gio::File>& dir, const std::shared_ptr<VarselConfig>& config)
 {
-    if (!file->query_exists()) {
-        return false;
+    psc::git::StatusOptions options;
+    if (!config) {
+        return options;
+    }
+    // allow to tune a large repository without affecting the others
+    std::string reposGrp = CONFIG_REPOS_PREFIX + dir->get_path();
+    auto grp = [&](const char* key) -> const char* {
+        if (config->hasKey(reposGrp.c_str(), key)) {
+            return reposGrp.c_str();
+        }
+        return getConfigGroup();
+    };
+    if (config->hasKey(grp(CONFIG_UNTRACKED), CONFIG_UNTRACKED)) {
+        auto untracked = config->getString(grp(CONFIG_UNTRACKED), CONFIG_UNTRACKED);
+        options.untracked = psc::git::StatusOptions::toUntrackedMode(untracked);
+    }
+    options.ignored = config->getBoolean(grp(CONFIG_IGNORED), CONFIG_IGNORED, options.ignored);
+    options.unmodified = config->getBoolean(grp(CONFIG_UNMODIFIED), CONFIG_UNMODIFIED, options.unmodified);
+    options.renames = config->getBoolean(grp(CONFIG_RENAMES), CONFIG_RENAMES, options.renames);
+    options.updateIndex = config->getBoolean(grp(CONFIG_UPDATE_INDEX), CONFIG_UPDATE_INDEX, options.updateIndex);
+    if (config->hasKey(grp(CONFIG_PATHSPEC), CONFIG_PATHSPEC)) {
+        for (auto& path : config->getStringList(grp(CONFIG_PATHSPEC), CONFIG_PATHSPEC)) {
+            options.pathspec.push_back(path);
+        }
     }
-    // QueryInfoFlags->None will pass thru type for symlinks
-    auto fileType = file->query_file_type(Gio::FileQueryInfoFlags::FILE_QUERY_INFO_NONE);
-    return (fileType == Gio::FileType::FILE_TYPE_REGULAR);
+    return options;
 }
 
 void
@@ -76,60 +480,360 @@ GitDataSource::update(
         , const Glib::RefPtr<psc::ui::TreeNodeModel>& treeModel
         , ListListener* listListener)
 {
-    try {
-        if (!treeNode) {
-            treeNode = std::make_shared<GitTreeNode>(".", 1);
-            treeModel->append(treeNode);
-        }
-        auto gitTreeNode = std::dynamic_pointer_cast<GitTreeNode>(treeNode);
-        psc::git::Repository repository(dir->get_path());
-        auto status = repository.getStatus();
-        for (auto iter = status.begin(); iter != status.end(); ++iter) {
-            std::string name;
-            if (!iter->getWorkdir().getNewPath().empty()) {
-                //if (!iter->getWorkdir().getOldPath().empty()) {
-                //    name += iter->getWorkdir().getOldPath() + " -> ";
-                //}
-                name = iter->getWorkdir().getNewPath();
+    // a subdirectory shows its part of the repository
+    auto reposDir = dir;
+    std::string subdir;
+    auto workdir = psc::git::RepositoryCache::getWorkdir(dir->get_path());
+    if (!workdir.empty()) {
+        reposDir = Gio::File::create_for_path(workdir);
+        subdir = reposDir->get_relative_path(dir);
+    }
+    auto options = getStatusOptions(reposDir, listListener->getKeyFile());
+    auto gitTreeNode = std::dynamic_pointer_cast<GitTreeNode>(treeNode);
+    m_listListener = listListener;
+    m_treeModel = treeModel;
+    if (gitTreeNode && m_root && gitTreeNode->getDepth() > 1) {
+        // refresh only the selected node, the paths are added from the root
+        options.pathspec.clear();
+        auto repoPath = gitTreeNode->getRepoPath() + "/";
+        options.pathspec.push_back(repoPath);
+        gitTreeNode->clearEntries();
+        std::erase_if(m_counted,
+            [&repoPath] (const auto& counted) {
+                return counted.first.starts_with(repoPath);
+            });
+        startStatus(options);
+        return;
+    }
+    if (!gitTreeNode) {
+        gitTreeNode = std::make_shared<GitTreeNode>(".", 1);
+        treeModel->append(gitTreeNode);
+    }
+    m_root = gitTreeNode;
+    m_counted.clear();
+    if (m_dirfd < 0
+     || !m_dir
+     || !m_dir->equal(reposDir)) {
+        if (m_dirfd >= 0) {
+            ::close(m_dirfd);
+        }
+        // kept for the stat of changes
+        m_dirfd = ::open(reposDir->get_path().c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    }
+    m_dir = reposDir;
+    if (!subdir.empty()) {
+        options.pathspec.clear();
+        options.pathspec.push_back(subdir + "/");
+    }
+    m_options = options;
+    if (!m_monitor) {
+        try {
+            m_monitor = std::make_shared<psc::git::StatusMonitor>(reposDir->get_path(), options);
+            m_monitor->setListener(this);
+        }
+        catch (const psc::git::GitException& ex) {
+            std::cout << "Error " << ex.what() << " monitoring repos " << reposDir->get_path() << std::endl;
+        }
+    }
+    else {
+        m_monitor->clear();
+    }
+    startStatus(options);
+}
+
+void
+GitDataSource::startStatus(const psc::git::StatusOptions& options)
+{
+    if (m_statusWorker) {
+        m_statusWorker->cancel();   // just use the latest
+    }
+    // the window opens immediately and fills in as status arrives
+    m_statusWorker = std::make_shared<GitStatusWorker>(m_dir, options, this);
+    m_statusWorker->execute();
+}
+
+std::shared_ptr<GitTreeNode>
+GitDataSource::getNode(const std::vector<Glib::ustring>& parts, bool create)
+{
+    auto node = m_root;
+    for (size_t i = 0; i + 1 < parts.size(); ++i) {
+        auto part = parts[i];
+        auto next = std::dynamic_pointer_cast<GitTreeNode>(node->findNode(part));
+        if (!next) {
+            if (!create) {
+                return next;
             }
-            else {
-                name = iter->getWorkdir().getOldPath();
+            next = std::make_shared<GitTreeNode>(part, node->getDepth() + 1);
+            node->addChild(next);
+            if (m_treeModel) {
+                m_treeModel->memory_row_inserted(next); // notify as the model is attached
             }
-            if (!name.empty()) {
-                //std::cout << "GitDataSource::update got " << name << std::endl;
-                auto node = gitTreeNode;
-                std::vector<Glib::ustring> parts;
-                parts.reserve(8);
-                StringUtils::split(name, '/', parts);
-                for (size_t i = 0; i < parts.size() - 1; ++i) {
-                    auto part = parts[i];
-                    auto next = std::dynamic_pointer_cast<GitTreeNode>(node->findNode(part));
-                    if (!next) {
-                        next = std::make_shared<GitTreeNode>(part, node->getDepth() + 1);
-                        node->addChild(next);
-                    }
-                    node = next;
-                }
-
-                auto file = dir->get_child(name);
-                if (isDisplayable(file) ) {
-                    auto list = node->appendList();
-                    auto row = *list;
-                    auto gitListColumns = std::dynamic_pointer_cast<GitListColumns>(getListColumns());
-                    row.set_value<psc::git::FileStatus>(gitListColumns->m_workdirState, iter->getWorkdir().getStatus());
-                    row.set_value<psc::git::FileStatus>(gitListColumns->m_indexState, iter->getIndex().getStatus());
-
-                    auto info = file->query_info("*", Gio::FileQueryInfoFlags::FILE_QUERY_INFO_NOFOLLOW_SYMLINKS);
-                    setFileValues(row, file, info, gitListColumns);
-                }
-                else {
-                    std::cout << "Skipped " << name << " not a regular file." << std::endl;
-                }
+            if (m_listListener) {
+                m_listListener->nodeAdded(next);
             }
         }
+        node = next;
+    }
+    return node;
+}
+
+Gtk::TreeModel::iterator
+GitDataSource::findRow(const std::shared_ptr<GitTreeNode>& node, const Glib::ustring& name)
+{
+    auto gitListColumns = std::dynamic_pointer_cast<GitListColumns>(getListColumns());
+    auto entries = node->getEntries();
+    for (auto iter = entries->children().begin(); iter != entries->children().end(); ++iter) {
+        auto row = *iter;
+        Glib::ustring rowName = row.get_value(gitListColumns->m_name);
+        if (rowName == name) {
+            return iter;
+        }
+    }
+    return entries->children().end();
+}
+
+void
+GitDataSource::setRowValues(Gtk::TreeRow& row, const GitStatusEntry& entry, const Glib::ustring& name)
+{
+    auto gitListColumns = std::dynamic_pointer_cast<GitListColumns>(getListColumns());
+    row.set_value<psc::git::FileStatus>(gitListColumns->m_workdirState, entry.workdir);
+    row.set_value<psc::git::FileStatus>(gitListColumns->m_indexState, entry.index);
+    row.set_value<Glib::ustring>(gitListColumns->m_name, name);
+    row.set_value(gitListColumns->m_size, entry.size);
+    row.set_value(gitListColumns->m_type, readableFileType(Gio::FileType::FILE_TYPE_REGULAR));
+    row.set_value(gitListColumns->m_mode, entry.mode);
+    row.set_value(gitListColumns->m_user, entry.user);
+    row.set_value(gitListColumns->m_group, entry.group);
+    row.set_value(gitListColumns->m_modified, Glib::DateTime::create_now_local(entry.modified));
+    row.set_value(gitListColumns->m_contentType, entry.contentType);
+    auto icon = m_icons.find(entry.contentType);
+    if (icon == m_icons.end()) {
+        auto contentIcon = Glib::RefPtr<Glib::Object>::cast_dynamic(
+                            Gio::content_type_get_symbolic_icon(entry.contentType));
+        icon = m_icons.insert(std::pair(entry.contentType, contentIcon)).first;
+    }
+    if (icon->second) {
+        row.set_value(gitListColumns->m_icon, icon->second);
+    }
+    if (!entry.symLink.empty()) {
+        Glib::ustring symLink = Glib::strescape(entry.symLink);
+        row.set_value(gitListColumns->m_symLink, symLink);
+    }
+    auto file = m_dir->get_child(entry.name);
+    row.set_value(gitListColumns->m_file, file);
+}
+
+void
+GitDataSource::addStatus(const GitStatusEntry& entry)
+{
+    //std::cout << "GitDataSource::addStatus got " << entry.name << std::endl;
+    std::vector<Glib::ustring> parts;
+    parts.reserve(8);
+    StringUtils::split(entry.name, '/', parts);
+    auto node = getNode(parts, true);
+    if (m_monitor) {
+        psc::git::DirStatus index;
+        index.setStatus(entry.index);
+        psc::git::DirStatus workdir;
+        workdir.setStatus(entry.workdir);
+        m_monitor->put(entry.name, psc::git::File(index, workdir));
+    }
+    // count every entry, only regular files get a row
+    node->countEntry(entry.workdir, entry.index, 1);   // summed up when done
+    m_counted.insert_or_assign(entry.name, std::pair(entry.workdir, entry.index));
+    if (entry.displayable) {
+        auto list = node->appendList();
+        auto row = *list;
+        setRowValues(row, entry, parts.empty() ? Glib::ustring(entry.name) : parts.back());
+    }
+}
+
+void
+GitDataSource::statusDone(size_t count, const Glib::ustring& errMsg)
+{
+    if (!errMsg.empty()) {
+        std::cout << "Error " << errMsg << " querying repos " << m_dir->get_path() << std::endl;
+        if (m_listListener) {
+            m_listListener->listDone(Severity::Error, errMsg);
+        }
+    }
+    else if (m_monitor) {
+        m_monitor->start();     // follow the changes from now on
+    }
+    if (m_root) {
+        m_root->sumCounts();
+        if (m_treeModel) {
+            m_root->subtreeChanged(m_treeModel);
+        }
+    }
+}
+
+void
+GitDataSource::uncount(const std::shared_ptr<GitTreeNode>& node, const std::string& path)
+{
+    auto counted = m_counted.find(path);
+    if (counted != m_counted.end()) {
+        node->countChange(counted->second.first, counted->second.second, -1);
+        m_counted.erase(counted);
+    }
+}
+
+void
+GitDataSource::statusChanged(const std::string& path, psc::git::File& file)
+{
+    if (!m_root) {
+        return;
+    }
+    GitStatusEntry entry;
+    entry.name = path;
+    entry.workdir = file.getWorkdir().getStatus();
+    entry.index = file.getIndex().getStatus();
+    m_statReader.fillStat(m_dirfd, file.getStat(), entry);
+    std::vector<Glib::ustring> parts;
+    StringUtils::split(entry.name, '/', parts);
+    if (parts.empty()) {
+        return;
+    }
+    // the node is needed for counting, even if there is no row e.g. deleted
+    auto node = getNode(parts, true);
+    uncount(node, entry.name);
+    node->countChange(entry.workdir, entry.index, 1);
+    m_counted.insert_or_assign(entry.name, std::pair(entry.workdir, entry.index));
+    auto iter = findRow(node, parts.back());
+    if (iter != node->getEntries()->children().end()) {
+        if (entry.displayable) {
+            auto row = *iter;
+            setRowValues(row, entry, parts.back());
+        }
+        else {
+            node->getEntries()->erase(iter);
+        }
+    }
+    else if (entry.displayable) {
+        auto list = node->appendList();
+        auto row = *list;
+        setRowValues(row, entry, parts.back());
+    }
+    if (m_treeModel) {
+        node->countsChanged(m_treeModel);
+    }
+}
+
+void
+GitDataSource::statusRemoved(const std::string& path)
+{
+    if (!m_root) {
+        return;
+    }
+    std::vector<Glib::ustring> parts;
+    StringUtils::split(path, '/', parts);
+    if (parts.empty()) {
+        return;
+    }
+    auto node = getNode(parts, false);
+    if (node) {
+        uncount(node, path);
+        auto iter = findRow(node, parts.back());
+        if (iter != node->getEntries()->children().end()) {
+            node->getEntries()->erase(iter);
+        }
+        if (m_treeModel) {
+            node->countsChanged(m_treeModel);
+        }
+    }
+}
+
+void
+GitDataSource::statusReset()
+{
+    // index or HEAD changed, list all again (the nodes are kept)
+    if (m_root && m_monitor) {
+        m_root->clearEntries();
+        m_counted.clear();
+        m_monitor->clear();
+        startStatus(m_options);
+    }
+}
+
+void
+GitDataSource::statusDegraded(const std::string& reason)
+{
+    if (m_listListener) {
+        m_listListener->listDone(Severity::Warning
+            , Glib::ustring::sprintf(_("Unable to watch all changes (%s), the status is refreshed every %u seconds")
+                                    , reason, psc::git::StatusMonitor::POLL_S));
+    }
+}
+
+void
+GitDataSource::distribute(const std::vector<PtrEventItem>& items, Gtk::Menu* menu, Gtk::Window* win)
+{
+    FileDataSource::distribute(items, menu, win);
+    auto diffItem = Gtk::make_managed<Gtk::MenuItem>(_("Diff"));
+    menu->append(*diffItem);
+    diffItem->signal_activate().connect(
+        sigc::bind(
+            sigc::mem_fun(*this, &GitDataSource::showDiff)
+        , items));
+    auto menuItem = Gtk::make_managed<Gtk::MenuItem>(_("History"));
+    menu->append(*menuItem);
+    menuItem->signal_activate().connect(
+        sigc::mem_fun(*this, &GitDataSource::showHistory));
+    auto fetchItem = Gtk::make_managed<Gtk::MenuItem>(_("Fetch"));
+    menu->append(*fetchItem);
+    fetchItem->signal_activate().connect(
+        [this, win] {
+            GitCloneDialog::fetch(m_dir, win);
+        });
+    auto browseItem = Gtk::make_managed<Gtk::MenuItem>(_("Browse revision"));
+    menu->append(*browseItem);
+    browseItem->signal_activate().connect(
+        sigc::bind(
+            sigc::mem_fun(*this, &GitDataSource::showRevision)
+        , win));
+}
+
+void
+GitDataSource::showHistory()
+{
+    auto varselList = VarselList::show(m_dir->get_basename(), nullptr, m_application);
+    if (varselList) {
+        varselList->showFile(m_dir, std::make_shared<GitLogDataSource>(m_application));
+    }
+}
+
+void
+GitDataSource::appendTreeColumns(Gtk::TreeView* treeView)
+{
+    treeView->append_column(_("Changes"), GitTreeNode::getTreeColumns()->m_counts);
+}
+
+void
+GitDataSource::showDiff(const std::vector<PtrEventItem>& items)
+{
+    std::vector<std::string> paths;
+    for (auto& item : items) {
+        auto path = m_dir->get_relative_path(item->getFile());
+        if (!path.empty()) {
+            paths.push_back(path);
+        }
+    }
+    if (paths.empty()) {
+        paths = m_options.pathspec;     // nothing selected, show all that is listed
+    }
+    GitDiffView::show(m_dir, paths, m_application);
+}
+
+void
+GitDataSource::showRevision(Gtk::Window* win)
+{
+    auto revision = GitTreeDataSource::selectRevision(m_dir, win);
+    if (revision.empty()) {
+        return;
     }
-    catch (const psc::git::GitException& ex) {
-        std::cout << "Error " << ex.what() << " querying repos " << dir->get_path() << std::endl;
+    auto varselList = VarselList::show(m_dir->get_basename() + " " + revision, nullptr, m_application);
+    if (varselList) {
+        varselList->showFile(m_dir, std::make_shared<GitTreeDataSource>(m_application, revision));
     }
 }
 
@@ -18,10 +18,14 @@
 
 #pragma once
 
-
+#include <atomic>
+#include <map>
+#include <vector>
 
 #include "FileDataSource.hpp"
 #include "GitRepository.hpp"
+#include "GitStatusMonitor.hpp"
+#include "ThreadWorker.hpp"
 
 
 class StatusConverter
@@ -101,6 +105,35 @@ public:
     }
 };
 
+class GitTreeColumns
+: public TreeColumns
+{
+public:
+    Gtk::TreeModelColumn<Glib::ustring> m_counts;
+    GitTreeColumns()
+    : TreeColumns::TreeColumns()
+    {
+        add(m_counts);
+    }
+};
+
+// the number of changed files by kind
+class GitStatusCounts
+{
+public:
+    int32_t modified{0};
+    int32_t added{0};
+    int32_t deleted{0};
+    int32_t ignored{0};
+
+    // delta +1 to count, -1 to remove a counted file
+    void count(psc::git::FileStatus workdir, psc::git::FileStatus index, int32_t delta);
+    void add(const GitStatusCounts& other);
+    void clear();
+    // e.g. "M3 N1", empty if nothing changed
+    Glib::ustring format();
+};
+
 class GitTreeNode
 : public BaseTreeNode
 {
@@ -108,22 +141,116 @@ public:
     GitTreeNode(const Glib::ustring& dir, unsigned long depth);
     virtual ~GitTreeNode() = default;
 
+     void getValue(int column, Glib::ValueBase& value) override;
      Gtk::TreeModel::iterator appendList() override;
      Glib::RefPtr<Gtk::ListStore> getEntries() override;
      static std::shared_ptr<ListColumns> getListColumns();
+     static std::shared_ptr<GitTreeColumns> getTreeColumns();
+     // relative to workdir e.g. "src/lib", empty for root
+     std::string getRepoPath();
+     // remove the rows of this and the sub-nodes
+     void clearEntries();
+     // count a entry of this node, the totals are updated by sumCounts
+     void countEntry(psc::git::FileStatus workdir, psc::git::FileStatus index, int32_t delta);
+     // count a entry of this node and update the totals up to the root
+     void countChange(psc::git::FileStatus workdir, psc::git::FileStatus index, int32_t delta);
+     // compute the totals of this subtree in one bottom-up pass
+     void sumCounts();
+     const GitStatusCounts& getCounts();
+     // redraw the counts of this node and its parents
+     void countsChanged(const Glib::RefPtr<psc::ui::TreeNodeModel>& treeModel);
+     // redraw the counts of this subtree
+     void subtreeChanged(const Glib::RefPtr<psc::ui::TreeNodeModel>& treeModel);
 private:
     static std::shared_ptr<GitListColumns> m_gitListColumns;
+    static std::shared_ptr<GitTreeColumns> m_gitTreeColumns;
     Glib::RefPtr<Gtk::ListStore> m_entries;
+    GitStatusCounts m_ownCounts;    // entries of this node
+    GitStatusCounts m_counts;       // entries of this subtree
+};
+
+
+// the values for a row, collected in background
+class GitStatusEntry
+{
+public:
+    std::string name;
+    psc::git::FileStatus workdir{psc::git::FileStatus::None};
+    psc::git::FileStatus index{psc::git::FileStatus::None};
+    bool displayable{false};
+    uint32_t mode{0};
+    goffset size{0};
+    gint64 modified{0};
+    Glib::ustring user;
+    Glib::ustring group;
+    Glib::ustring contentType;
+    std::string symLink;
+};
+
+using GitStatusBatch = std::shared_ptr<std::vector<GitStatusEntry>>;
+
+// resolves the row values, keeps the names of user and group
+class GitStatReader
+{
+public:
+    GitStatReader() = default;
+    explicit GitStatReader(const GitStatReader& orig) = delete;
+    virtual ~GitStatReader() = default;
+
+    // the index values if fresh (permission 0644 or 0755 as git keeps it), otherwise stat relative to workdir
+    void fillStat(int dirfd, const psc::git::FileStat& gitStat, GitStatusEntry& entry);
+    Glib::ustring getUser(uint32_t uid);
+    Glib::ustring getGroup(uint32_t gid);
+
+private:
+    std::map<uint32_t, Glib::ustring> m_users;
+    std::map<uint32_t, Glib::ustring> m_groups;
 };
 
+class GitDataSource;
+
+/**
+ * query the status in background,
+ *   as this may take some seconds for large repositories,
+ *   the entries are passed in batches to keep the ui responsive.
+ */
+class GitStatusWorker
+: public ThreadWorker<GitStatusBatch, size_t>
+{
+public:
+    GitStatusWorker(const Glib::RefPtr<Gio::File>& dir, const psc::git::StatusOptions& options, GitDataSource* gitDataSource);
+    explicit GitStatusWorker(const GitStatusWorker& orig) = delete;
+    virtual ~GitStatusWorker() = default;
 
+    // stops as soon as possible and no longer reports to source
+    void cancel();
+    static constexpr size_t BATCH_SIZE{256u};
+protected:
+    size_t doInBackground() override;
+    void process(const std::vector<GitStatusBatch>& batches) override;
+    void done() override;
+
+private:
+    Glib::RefPtr<Gio::File> m_dir;
+    GitStatReader m_statReader;
+    psc::git::StatusOptions m_options;
+    GitDataSource* m_gitDataSource;
+    std::atomic<bool> m_cancel{false};
+};
+
+/**
+ * list the status of a repository,
+ *   after the full status is listed
+ *   the changes are followed by a StatusMonitor.
+ */
 class GitDataSource
 : public FileDataSource
+, public psc::git::StatusMonitorListener
 {
 public:
     GitDataSource(ListApp* application);
     explicit GitDataSource(const GitDataSource& orig) = delete;
-    virtual ~GitDataSource() = default;
+    virtual ~GitDataSource();
 
     void update(
           const Glib::RefPtr<Gio::File>& dir
@@ -132,11 +259,51 @@ public:
         , ListListener* listListener) override;
     const char* getConfigGroup() override;
     std::shared_ptr<ListColumns> getListColumns() override;
+    void close() override;
+    void appendTreeColumns(Gtk::TreeView* treeView) override;
+    void distribute(const std::vector<PtrEventItem>& items, Gtk::Menu* menu, Gtk::Window* win) override;
+
+    void addStatus(const GitStatusEntry& entry);
+    void statusDone(size_t count, const Glib::ustring& errMsg);
+    void statusChanged(const std::string& path, psc::git::File& file) override;
+    void statusRemoved(const std::string& path) override;
+    void statusReset() override;
+    void statusDegraded(const std::string& reason) override;
+
+    static constexpr auto CONFIG_UNTRACKED{"statusUntracked"};     // none, collapsed, all
+    static constexpr auto CONFIG_IGNORED{"statusIgnored"};
+    static constexpr auto CONFIG_UNMODIFIED{"statusUnmodified"};
+    static constexpr auto CONFIG_RENAMES{"statusRenames"};
+    static constexpr auto CONFIG_UPDATE_INDEX{"statusUpdateIndex"};
+    static constexpr auto CONFIG_PATHSPEC{"statusPathspec"};
+    // a group with this prefix and the repository path overrides the defaults
+    static constexpr auto CONFIG_REPOS_PREFIX{"GitData:"};
 
 protected:
-    bool isDisplayable(const Glib::RefPtr<Gio::File>& file);
+    psc::git::StatusOptions getStatusOptions(const Glib::RefPtr<Gio::File>& dir, const std::shared_ptr<VarselConfig>& config);
+    void startStatus(const psc::git::StatusOptions& options);
+    // the node for the directory of parts, nullptr if not found and not create
+    std::shared_ptr<GitTreeNode> getNode(const std::vector<Glib::ustring>& parts, bool create);
+    Gtk::TreeModel::iterator findRow(const std::shared_ptr<GitTreeNode>& node, const Glib::ustring& name);
+    void setRowValues(Gtk::TreeRow& row, const GitStatusEntry& entry, const Glib::ustring& name);
+    // remove the counts of path (with or without row), before changing or removing it
+    void uncount(const std::shared_ptr<GitTreeNode>& node, const std::string& path);
+    void showHistory();
+    void showDiff(const std::vector<PtrEventItem>& items);
+    void showRevision(Gtk::Window* win);
 
 private:
-
+    Glib::RefPtr<Gio::File> m_dir;
+    psc::git::StatusOptions m_options;
+    std::shared_ptr<psc::git::StatusMonitor> m_monitor;
+    GitStatReader m_statReader;
+    std::map<Glib::ustring, Glib::RefPtr<Glib::Object>> m_icons;
+    std::shared_ptr<GitTreeNode> m_root;
+    Glib::RefPtr<psc::ui::TreeNodeModel> m_treeModel;
+    std::shared_ptr<GitStatusWorker> m_statusWorker;
+    ListListener* m_listListener{nullptr};
+    int m_dirfd{-1};    // the workdir
+    // path -> workdir, index status as counted, as deleted and other non regular have no row
+    std::map<std::string, std::pair<psc::git::FileStatus, psc::git::FileStatus>> m_counted;
 };
 
@@ -0,0 +1,209 @@
+/* -*- Mode: c++; c-basic-offset: 4; tab-width: 4; coding: utf-8; -*-  */
+/*
+ * Copyright (C) 2025 RPf
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <psc_i18n.hpp>
+#include <psc_format.hpp>
+
+#include "GitDiffView.hpp"
+#include "ListApp.hpp"
+
+GitDiffWorker::GitDiffWorker(const std::string& workdir, const std::vector<std::string>& paths, GitDiffView* gitDiffView)
+: ThreadWorker()
+, m_workdir{workdir}
+, m_paths{paths}
+, m_gitDiffView{gitDiffView}
+{
+}
+
+void
+GitDiffWorker::cancel()
+{
+    m_cancel = true;
+    m_gitDiffView = nullptr;    // as we are called from main thread this is safe
+}
+
+bool
+GitDiffWorker::diffHunk(psc::git::DiffHunk& hunk)
+{
+    // this is called from thread context
+    if (!m_batch) {
+        m_batch = std::make_shared<std::vector<psc::git::DiffHunk>>();
+    }
+    m_batchBytes += hunk.text.size();
+    m_batch->emplace_back(std::move(hunk));
+    ++m_count;
+    if (m_batchBytes >= BATCH_BYTES) {
+        notify(m_batch);
+        m_batch.reset();
+        m_batchBytes = 0;
+    }
+    return !m_cancel;
+}
+
+size_t
+GitDiffWorker::doInBackground()
+{
+    // use a own repository as we are in thread context
+    psc::git::Repository repository(m_workdir);
+    repository.diffWorkdir(m_paths, this);
+    if (m_batch) {
+        notify(m_batch);
+        m_batch.reset();
+    }
+    return m_count;
+}
+
+void
+GitDiffWorker::process(const std::vector<GitDiffBatch>& batches)
+{
+    // here we are back to main thread ...
+    for (auto& batch : batches) {
+        if (!m_gitDiffView) {
+            return;
+        }
+        m_gitDiffView->addHunks(*batch);
+    }
+}
+
+void
+GitDiffWorker::done()
+{
+    Glib::ustring msg;
+    size_t count{0};
+    try {
+        count = getResult();
+    }
+    catch (const psc::git::GitException& exc) {
+        msg = exc.what();
+    }
+    if (m_gitDiffView) {
+        m_gitDiffView->diffDone(count, msg);
+    }
+}
+
+GitDiffView::GitDiffView(const Glib::RefPtr<Gio::File>& dir, const std::vector<std::string>& paths)
+: Gtk::Window()
+{
+    set_title(psc::fmt::vformat(_("Diff {}"),
+                                psc::fmt::make_format_args(dir->get_basename())));
+    set_default_size(800, 600);
+    auto langManager = gtk_source_language_manager_get_default();
+    auto diffLang = gtk_source_language_manager_get_language(langManager, "diff");
+    m_buffer = gtk_source_buffer_new_with_language(diffLang);
+    gtk_source_buffer_set_highlight_syntax(m_buffer, true);
+    m_sourceView = GTK_SOURCE_VIEW(gtk_source_view_new_with_buffer(m_buffer));
+    g_object_unref(m_buffer);   // kept by view
+    gtk_text_view_set_editable(GTK_TEXT_VIEW(m_sourceView), false);
+    gtk_text_view_set_monospace(GTK_TEXT_VIEW(m_sourceView), true);
+    gtk_container_add(GTK_CONTAINER(m_scrollView.gobj()), GTK_WIDGET(m_sourceView));
+    add(m_scrollView);
+    m_scrollView.get_vadjustment()->signal_value_changed().connect(
+            sigc::mem_fun(*this, &GitDiffView::on_scrolled));
+    m_diffWorker = std::make_shared<GitDiffWorker>(dir->get_path(), paths, this);
+    m_diffWorker->execute();
+}
+
+GitDiffView::~GitDiffView()
+{
+    if (m_diffWorker) {
+        m_diffWorker->cancel();
+    }
+}
+
+void
+GitDiffView::append(const std::string& text)
+{
+    GtkTextIter end;
+    gtk_text_buffer_get_end_iter(GTK_TEXT_BUFFER(m_buffer), &end);
+    gtk_text_buffer_insert(GTK_TEXT_BUFFER(m_buffer), &end, text.c_str(), static_cast<gint>(text.size()));
+}
+
+void
+GitDiffView::addHunks(const std::vector<psc::git::DiffHunk>& hunks)
+{
+    for (auto& hunk : hunks) {
+        m_pending.push_back(hunk);
+    }
+    render();
+}
+
+void
+GitDiffView::render()
+{
+    // hunks are kept as text until the end of the view gets near,
+    //   a large hunk (e.g. a generated file) is put by parts
+    while (!m_pending.empty()
+        && m_renderedLines < m_renderLimit) {
+        auto& hunk = m_pending.front();
+        auto pos = m_pendingOffset;
+        while (pos < hunk.text.size()
+            && m_renderedLines < m_renderLimit) {
+            auto next = hunk.text.find('\n', pos);
+            pos = next != std::string::npos
+                  ? next + 1
+                  : hunk.text.size();
+            ++m_renderedLines;
+        }
+        append(hunk.text.substr(m_pendingOffset, pos - m_pendingOffset));
+        if (pos < hunk.text.size()) {
+            m_pendingOffset = pos;
+        }
+        else {
+            m_pendingOffset = 0;
+            m_pending.pop_front();
+        }
+    }
+}
+
+void
+GitDiffView::on_scrolled()
+{
+    auto adj = m_scrollView.get_vadjustment();
+    if (!m_pending.empty()
+     && adj->get_value() + 2.0 * adj->get_page_size() >= adj->get_upper()) {
+        m_renderLimit = m_renderedLines + RENDER_LINES;
+        render();
+    }
+}
+
+void
+GitDiffView::diffDone(size_t count, const Glib::ustring& errMsg)
+{
+    m_diffWorker.reset();
+    if (!errMsg.empty()) {
+        std::cout << "Error " << errMsg << " creating diff" << std::endl;
+        append(errMsg.raw() + "\n");
+    }
+    else if (count == 0) {
+        append(_("No changes\n"));
+    }
+}
+
+GitDiffView*
+GitDiffView::show(const Glib::RefPtr<Gio::File>& dir, const std::vector<std::string>& paths, ListApp* listApp)
+{
+    auto gitDiffView = new GitDiffView(dir, paths);
+    listApp->add_window(*gitDiffView);
+    gitDiffView->signal_hide().connect(
+        [gitDiffView] {
+            delete gitDiffView;
+        });
+    gitDiffView->show_all();
+    return gitDiffView;
+}
@@ -0,0 +1,100 @@
+/* -*- Mode: c++; c-basic-offset: 4; tab-width: 4; coding: utf-8; -*-  */
+/*
+ * Copyright (C) 2025 RPf
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gtksourceview/gtksource.h>
+#include <gtkmm.h>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "GitRepository.hpp"
+#include "ThreadWorker.hpp"
+
+class ListApp;
+class GitDiffView;
+
+using GitDiffBatch = std::shared_ptr<std::vector<psc::git::DiffHunk>>;
+
+/**
+ * create the patch in background,
+ *   the hunks are passed in batches of about BATCH_BYTES.
+ */
+class GitDiffWorker
+: public ThreadWorker<GitDiffBatch, size_t>
+, public psc::git::DiffListener
+{
+public:
+    GitDiffWorker(const std::string& workdir, const std::vector<std::string>& paths, GitDiffView* gitDiffView);
+    explicit GitDiffWorker(const GitDiffWorker& orig) = delete;
+    virtual ~GitDiffWorker() = default;
+
+    void cancel();
+    bool diffHunk(psc::git::DiffHunk& hunk) override;
+    static constexpr size_t BATCH_BYTES{64u*1024u};
+protected:
+    size_t doInBackground() override;
+    void process(const std::vector<GitDiffBatch>& batches) override;
+    void done() override;
+
+private:
+    std::string m_workdir;
+    std::vector<std::string> m_paths;
+    GitDiffView* m_gitDiffView;
+    GitDiffBatch m_batch;
+    size_t m_batchBytes{0};
+    size_t m_count{0};
+    std::atomic<bool> m_cancel{false};
+};
+
+/**
+ * show the changes of the working tree,
+ *   the hunks are put into the view only when scrolled to,
+ *   so large generated files do not block the ui.
+ */
+class GitDiffView
+: public Gtk::Window
+{
+public:
+    GitDiffView(const Glib::RefPtr<Gio::File>& dir, const std::vector<std::string>& paths);
+    explicit GitDiffView(const GitDiffView& orig) = delete;
+    virtual ~GitDiffView();
+
+    void addHunks(const std::vector<psc::git::DiffHunk>& hunks);
+    void diffDone(size_t count, const Glib::ustring& errMsg);
+    // paths relative to dir (the workdir), all changes if empty
+    static GitDiffView* show(const Glib::RefPtr<Gio::File>& dir, const std::vector<std::string>& paths, ListApp* listApp);
+
+    static constexpr size_t RENDER_LINES{2000u};
+protected:
+    void render();
+    void on_scrolled();
+    void append(const std::string& text);
+
+private:
+    Gtk::ScrolledWindow m_scrollView;
+    GtkSourceBuffer* m_buffer{nullptr};
+    GtkSourceView* m_sourceView{nullptr};
+    std::deque<psc::git::DiffHunk> m_pending;
+    size_t m_pendingOffset{0};  // the part of the first pending that was put
+    size_t m_renderedLines{0};
+    size_t m_renderLimit{RENDER_LINES};
+    std::shared_ptr<GitDiffWorker> m_diffWorker;
+};
@@ -0,0 +1,456 @@
+/* -*- Mode: c++; c-basic-offset: 4; tab-width: 4; coding: utf-8; -*-  */
+/*
+ * Copyright (C) 2025 RPf
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <psc_i18n.hpp>
+
+#include "GitLogDataSource.hpp"
+
+size_t
+GitCommitTable::add(const GitCommitInfo& info)
+{
+    size_t idx = m_oids.size();
+    m_oids.push_back(info.oid);
+    m_times.push_back(info.time);
+    auto author = m_authorIndex.find(info.author);
+    if (author == m_authorIndex.end()) {
+        auto authorIdx = static_cast<uint32_t>(m_authorNames.size());
+        m_authorNames.push_back(info.author);
+        author = m_authorIndex.insert(std::pair(info.author, authorIdx)).first;
+    }
+    m_authors.push_back(author->second);
+    m_summaryOffsets.push_back(m_summaries.size());
+    m_summaries += info.summary;
+    return idx;
+}
+
+size_t
+GitCommitTable::size()
+{
+    return m_oids.size();
+}
+
+const git_oid&
+GitCommitTable::getOid(size_t idx)
+{
+    return m_oids[idx];
+}
+
+std::string
+GitCommitTable::getId(size_t idx)
+{
+    char buf[ID_LENGTH + 1];
+    git_oid_tostr(buf, sizeof(buf), &m_oids[idx]);
+    return std::string(buf);
+}
+
+gint64
+GitCommitTable::getTime(size_t idx)
+{
+    return m_times[idx];
+}
+
+const std::string&
+GitCommitTable::getAuthor(size_t idx)
+{
+    return m_authorNames[m_authors[idx]];
+}
+
+std::string_view
+GitCommitTable::getSummary(size_t idx)
+{
+    size_t start = m_summaryOffsets[idx];
+    size_t end = idx + 1 < m_summaryOffsets.size()
+                 ? m_summaryOffsets[idx + 1]
+                 : m_summaries.size();
+    return std::string_view(m_summaries).substr(start, end - start);
+}
+
+void
+GitCommitTable::clear()
+{
+    m_oids.clear();
+    m_times.clear();
+    m_authors.clear();
+    m_authorNames.clear();
+    m_authorIndex.clear();
+    m_summaryOffsets.clear();
+    m_summaries.clear();
+}
+
+GitLogWorker::GitLogWorker(const Glib::RefPtr<Gio::File>& dir, GitLogDataSource* gitLogDataSource)
+: ThreadWorker()
+, m_dir{dir}
+, m_gitLogDataSource{gitLogDataSource}
+{
+}
+
+void
+GitLogWorker::request(size_t count)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_requested += count;
+    }
+    m_condition.notify_all();
+}
+
+void
+GitLogWorker::cancel()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_cancel = true;
+    }
+    m_condition.notify_all();
+    m_gitLogDataSource = nullptr;   // as we are called from main thread this is safe
+}
+
+size_t
+GitLogWorker::doInBackground()
+{
+    // this is called from thread context, use a own repository
+    psc::git::Repository repository(m_dir->get_path());
+    auto walk = repository.getRevWalk();
+    size_t count{0};
+    auto page = std::make_shared<std::vector<GitCommitInfo>>();
+    page->reserve(PAGE_SIZE);
+    while (true) {
+        {
+            // requests are made by pages, so a page is complete when waiting
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [&] {
+                return m_cancel || count < m_requested;
+            });
+            if (m_cancel) {
+                break;
+            }
+        }
+        GitCommitInfo info;
+        if (!walk->next(info.oid)) {
+            break;
+        }
+        auto commit = repository.getCommit(info.oid);
+        info.time = commit->getTime();
+        info.author = commit->getAuthorName();
+        info.summary = commit->getSummary();
+        page->emplace_back(std::move(info));
+        ++count;
+        if (page->size() >= PAGE_SIZE) {
+            notify(page);
+            page = std::make_shared<std::vector<GitCommitInfo>>();
+            page->reserve(PAGE_SIZE);
+        }
+    }
+    if (!page->empty()) {
+        notify(page);
+    }
+    return count;
+}
+
+void
+GitLogWorker::process(const std::vector<GitCommitPage>& pages)
+{
+    // here we are back to main thread ...
+    for (auto& page : pages) {
+        if (!m_gitLogDataSource) {
+            return;
+        }
+        m_gitLogDataSource->addPage(page);
+    }
+}
+
+void
+GitLogWorker::done()
+{
+    Glib::ustring msg;
+    size_t count{0};
+    try {
+        count = getResult();
+    }
+    catch (const psc::git::GitException& exc) {
+        msg = exc.what();
+    }
+    catch (const std::exception& exc) {
+        msg = exc.what();
+    }
+    if (m_gitLogDataSource) {
+        m_gitLogDataSource->logDone(count, msg);
+    }
+}
+
+GitChangesWorker::GitChangesWorker(const Glib::RefPtr<Gio::File>& dir
+                                 , const git_oid& oid
+                                 , gint64 time
+                                 , const Glib::ustring& author
+                                 , const Glib::RefPtr<Gtk::ListStore>& entries)
+: ThreadWorker()
+, m_dir{dir}
+, m_oid{oid}
+, m_time{time}
+, m_author{author}
+, m_entries{entries}
+{
+}
+
+void
+GitChangesWorker::cancel()
+{
+    m_cancel = true;
+}
+
+GitCommitChanges
+GitChangesWorker::doInBackground()
+{
+    // this is called from thread context, use a own repository
+    psc::git::Repository repository(m_dir->get_path());
+    auto commit = repository.getCommit(m_oid);
+    return commit->getChanges();
+}
+
+void
+GitChangesWorker::process(const std::vector<GitCommitChanges>& changes)
+{
+    // the changes are passed as result
+}
+
+void
+GitChangesWorker::done()
+{
+    GitCommitChanges changes;
+    try {
+        changes = getResult();
+    }
+    catch (const std::exception& exc) {     // includes GitException
+        char id[9];
+        git_oid_tostr(id, sizeof(id), &m_oid);
+        std::cout << "Error " << exc.what() << " reading commit " << id << std::endl;
+        return;
+    }
+    if (m_cancel) {
+        return;
+    }
+    auto gitListColumns = std::dynamic_pointer_cast<GitListColumns>(GitTreeNode::getListColumns());
+    auto modified = Glib::DateTime::create_now_local(m_time);
+    for (auto& change : changes) {
+        auto iter = m_entries->append();
+        auto row = *iter;
+        row.set_value<psc::git::FileStatus>(gitListColumns->m_workdirState, psc::git::FileStatus::None);
+        row.set_value<psc::git::FileStatus>(gitListColumns->m_indexState, change.status);
+        row.set_value<Glib::ustring>(gitListColumns->m_name, change.path);
+        row.set_value(gitListColumns->m_mode, change.mode & 07777u);
+        row.set_value(gitListColumns->m_user, m_author);
+        row.set_value(gitListColumns->m_modified, modified);
+        auto file = m_dir->get_child(change.path);
+        row.set_value(gitListColumns->m_file, file);
+    }
+}
+
+GitCommitNode::GitCommitNode(GitLogDataSource* gitLogDataSource, size_t index, const Glib::ustring& name, unsigned long depth)
+: BaseTreeNode::BaseTreeNode(name, depth)
+, m_gitLogDataSource{gitLogDataSource}
+, m_index{index}
+{
+}
+
+void
+GitCommitNode::getValue(int column, Glib::ValueBase& value)
+{
+    if (column != 0
+     || m_index == ROOT_INDEX) {
+        BaseTreeNode::getValue(column, value);
+        return;
+    }
+    // keep the text only while displayed
+    using StringColumn = Gtk::TreeModelColumn<Glib::ustring>;
+    StringColumn::ValueType sValue;
+    sValue.init(StringColumn::ValueType::value_type());
+    sValue.set(m_gitLogDataSource->getCommitText(m_index));
+    value.init(sValue.value_type());
+    value = sValue;
+}
+
+Gtk::TreeModel::iterator
+GitCommitNode::appendList()
+{
+    return getEntries()->append();
+}
+
+Glib::RefPtr<Gtk::ListStore>
+GitCommitNode::getEntries()
+{
+    if (!m_entries) {
+        m_entries = Gtk::ListStore::create(*GitTreeNode::getListColumns());
+        if (m_index != ROOT_INDEX) {
+            m_gitLogDataSource->fillChanges(m_index, m_entries);
+        }
+    }
+    return m_entries;
+}
+
+size_t
+GitCommitNode::getIndex()
+{
+    return m_index;
+}
+
+GitLogDataSource::GitLogDataSource(ListApp* application)
+: FileDataSource(application)
+{
+}
+
+GitLogDataSource::~GitLogDataSource()
+{
+    close();
+}
+
+void
+GitLogDataSource::close()
+{
+    if (m_logWorker) {
+        m_logWorker->cancel();
+    }
+    if (m_changesWorker) {
+        m_changesWorker->cancel();
+    }
+    m_listListener = nullptr;
+}
+
+void
+GitLogDataSource::update(
+          const Glib::RefPtr<Gio::File>& dir
+        , std::shared_ptr<psc::ui::TreeNode> treeNode
+        , const Glib::RefPtr<psc::ui::TreeNodeModel>& treeModel
+        , ListListener* listListener)
+{
+    if (treeNode) {
+        return;     // commits are not updated
+    }
+    m_dir = dir;
+    m_treeModel = treeModel;
+    m_listListener = listListener;
+    m_table.clear();
+    m_complete = false;
+    Glib::ustring branch{"HEAD"};
+    try {
+        m_repository = psc::git::RepositoryCache::get(dir->get_path());
+        if (!m_repository) {
+            throw psc::git::GitException("No repository for " + dir->get_path());
+        }
+        auto headBranch = m_repository->getBranch();
+        if (!headBranch.empty()) {
+            branch = headBranch;
+        }
+    }
+    catch (const psc::git::GitException& ex) {
+        std::cout << "Error " << ex.what() << " opening repos " << dir->get_path() << std::endl;
+    }
+    m_root = std::make_shared<GitCommitNode>(this, GitCommitNode::ROOT_INDEX, branch, 1);
+    treeModel->append(m_root);
+    if (m_logWorker) {
+        m_logWorker->cancel();
+    }
+    m_logWorker = std::make_shared<GitLogWorker>(dir, this);
+    m_logWorker->execute();
+}
+
+void
+GitLogDataSource::requestMore()
+{
+    if (m_logWorker && !m_complete) {
+        m_logWorker->request(GitLogWorker::PAGE_SIZE);
+    }
+}
+
+void
+GitLogDataSource::addPage(const GitCommitPage& page)
+{
+    bool first = m_table.size() == 0;
+    for (auto& info : *page) {
+        auto idx = m_table.add(info);
+        auto node = std::make_shared<GitCommitNode>(this, idx, Glib::ustring(), 2);
+        m_root->addChild(node);
+        m_treeModel->memory_row_inserted(node); // notify as the model is attached
+        if (first && m_listListener) {
+            m_listListener->nodeAdded(node);    // expands root
+            first = false;
+        }
+    }
+}
+
+void
+GitLogDataSource::logDone(size_t count, const Glib::ustring& errMsg)
+{
+    m_complete = true;
+    if (!errMsg.empty()) {
+        std::cout << "Error " << errMsg << " reading history " << m_dir->get_path() << std::endl;
+        if (m_listListener) {
+            m_listListener->listDone(Severity::Error, errMsg);
+        }
+    }
+}
+
+Glib::ustring
+GitLogDataSource::getCommitText(size_t index)
+{
+    auto dateTime = Glib::DateTime::create_now_local(m_table.getTime(index));
+    auto summary = m_table.getSummary(index);
+    return Glib::ustring::sprintf("%s %s %s %s"
+                , m_table.getId(index)
+                , dateTime.format("%F %R")
+                , m_table.getAuthor(index)
+                , std::string(summary));
+}
+
+void
+GitLogDataSource::fillChanges(size_t index, const Glib::RefPtr<Gtk::ListStore>& entries)
+{
+    if (!m_repository) {
+        return;
+    }
+    // a previous selection still fills its own entries
+    m_changesWorker = std::make_shared<GitChangesWorker>(
+                              m_dir
+                            , m_table.getOid(index)
+                            , m_table.getTime(index)
+                            , Glib::ustring(m_table.getAuthor(index))
+                            , entries);
+    m_changesWorker->execute();
+}
+
+const char*
+GitLogDataSource::getConfigGroup()
+{
+    return "GitLog";
+}
+
+std::shared_ptr<ListColumns>
+GitLogDataSource::getListColumns()
+{
+    return GitTreeNode::getListColumns();
+}
+
+void
+GitLogDataSource::paste(
+          const std::vector<Glib::ustring>& uris
+        , const Glib::RefPtr<Gio::File>& dir
+        , bool isMove
+        , VarselList* win)
+{
+    // the history is not changed by pasting
+}
@@ -0,0 +1,210 @@
+/* -*- Mode: c++; c-basic-offset: 4; tab-width: 4; coding: utf-8; -*-  */
+/*
+ * Copyright (C) 2025 RPf
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "FileDataSource.hpp"
+#include "GitDataSource.hpp"
+#include "GitRepository.hpp"
+#include "ThreadWorker.hpp"
+
+// a commit as read in background
+class GitCommitInfo
+{
+public:
+    git_oid oid;
+    gint64 time{0};
+    std::string author;
+    std::string summary;
+};
+
+using GitCommitPage = std::shared_ptr<std::vector<GitCommitInfo>>;
+
+/**
+ * keep the parsed commits compact,
+ *   authors are stored once,
+ *   summaries share a single buffer.
+ */
+class GitCommitTable
+{
+public:
+    GitCommitTable() = default;
+    explicit GitCommitTable(const GitCommitTable& orig) = delete;
+    virtual ~GitCommitTable() = default;
+
+    size_t add(const GitCommitInfo& info);
+    size_t size();
+    const git_oid& getOid(size_t idx);
+    // abbreviated hex
+    std::string getId(size_t idx);
+    gint64 getTime(size_t idx);
+    const std::string& getAuthor(size_t idx);
+    std::string_view getSummary(size_t idx);
+    void clear();
+
+    static constexpr size_t ID_LENGTH{8u};
+private:
+    std::vector<git_oid> m_oids;
+    std::vector<gint64> m_times;
+    std::vector<uint32_t> m_authors;
+    std::vector<std::string> m_authorNames;
+    std::map<std::string, uint32_t> m_authorIndex;
+    std::vector<size_t> m_summaryOffsets;   // start of entry, end is start of next
+    std::string m_summaries;
+};
+
+class GitLogDataSource;
+
+/**
+ * walk the history in background,
+ *   only as far as requested so large histories
+ *   are read while scrolling.
+ */
+class GitLogWorker
+: public ThreadWorker<GitCommitPage, size_t>
+{
+public:
+    GitLogWorker(const Glib::RefPtr<Gio::File>& dir, GitLogDataSource* gitLogDataSource);
+    explicit GitLogWorker(const GitLogWorker& orig) = delete;
+    virtual ~GitLogWorker() = default;
+
+    // allow to read some more commits
+    void request(size_t count);
+    void cancel();
+    static constexpr size_t PAGE_SIZE{500u};
+protected:
+    size_t doInBackground() override;
+    void process(const std::vector<GitCommitPage>& pages) override;
+    void done() override;
+
+private:
+    Glib::RefPtr<Gio::File> m_dir;
+    GitLogDataSource* m_gitLogDataSource;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    size_t m_requested{2u * PAGE_SIZE};
+    bool m_cancel{false};
+};
+
+using GitCommitChanges = std::vector<psc::git::CommitChange>;
+
+/**
+ * diff a commit to its parent in background,
+ *   as this takes a while for large merges,
+ *   the rows are added to the entries when done.
+ */
+class GitChangesWorker
+: public ThreadWorker<GitCommitChanges, GitCommitChanges>
+{
+public:
+    GitChangesWorker(const Glib::RefPtr<Gio::File>& dir
+                   , const git_oid& oid
+                   , gint64 time
+                   , const Glib::ustring& author
+                   , const Glib::RefPtr<Gtk::ListStore>& entries);
+    explicit GitChangesWorker(const GitChangesWorker& orig) = delete;
+    virtual ~GitChangesWorker() = default;
+
+    void cancel();
+protected:
+    GitCommitChanges doInBackground() override;
+    void process(const std::vector<GitCommitChanges>& changes) override;
+    void done() override;
+
+private:
+    Glib::RefPtr<Gio::File> m_dir;
+    git_oid m_oid;
+    gint64 m_time;
+    Glib::ustring m_author;
+    Glib::RefPtr<Gtk::ListStore> m_entries;
+    std::atomic<bool> m_cancel{false};
+};
+
+// a commit in the tree, the text is created when shown
+class GitCommitNode
+: public BaseTreeNode
+{
+public:
+    GitCommitNode(GitLogDataSource* gitLogDataSource, size_t index, const Glib::ustring& name, unsigned long depth);
+    virtual ~GitCommitNode() = default;
+
+    void getValue(int column, Glib::ValueBase& value) override;
+    Gtk::TreeModel::iterator appendList() override;
+    // the changed files are read on first use
+    Glib::RefPtr<Gtk::ListStore> getEntries() override;
+    size_t getIndex();
+
+    static constexpr size_t ROOT_INDEX{std::numeric_limits<size_t>::max()};
+private:
+    GitLogDataSource* m_gitLogDataSource;
+    size_t m_index;
+    Glib::RefPtr<Gtk::ListStore> m_entries;
+};
+
+/**
+ * show the history of a repository,
+ *   the commits as tree (paged in while scrolling),
+ *   the list shows the files changed by the selected commit.
+ */
+class GitLogDataSource
+: public FileDataSource
+{
+public:
+    GitLogDataSource(ListApp* application);
+    explicit GitLogDataSource(const GitLogDataSource& orig) = delete;
+    virtual ~GitLogDataSource();
+
+    void update(
+          const Glib::RefPtr<Gio::File>& dir
+        , std::shared_ptr<psc::ui::TreeNode> treeItem
+        , const Glib::RefPtr<psc::ui::TreeNodeModel>& treeModel
+        , ListListener* listListener) override;
+    const char* getConfigGroup() override;
+    std::shared_ptr<ListColumns> getListColumns() override;
+    void paste(
+          const std::vector<Glib::ustring>& uris
+        , const Glib::RefPtr<Gio::File>& dir
+        , bool isMove
+        , VarselList* win) override;
+    void close() override;
+    void requestMore() override;
+
+    void addPage(const GitCommitPage& page);
+    void logDone(size_t count, const Glib::ustring& errMsg);
+    Glib::ustring getCommitText(size_t index);
+    // the rows are added in background
+    void fillChanges(size_t index, const Glib::RefPtr<Gtk::ListStore>& entries);
+
+private:
+    Glib::RefPtr<Gio::File> m_dir;
+    GitCommitTable m_table;
+    std::shared_ptr<psc::git::Repository> m_repository;
+    std::shared_ptr<GitCommitNode> m_root;
+    Glib::RefPtr<psc::ui::TreeNodeModel> m_treeModel;
+    std::shared_ptr<GitLogWorker> m_logWorker;
+    std::shared_ptr<GitChangesWorker> m_changesWorker;
+    ListListener* m_listListener{nullptr};
+    bool m_complete{false};
+};
@@ -110,6 +110,138 @@ Commit::getSignature()
     return signature;
 }
 
+std::string
+Commit::getSummary()
+{
+    auto summary = git_commit_summary(m_commit);
+    return summary ? std::string(summary) : std::string();
+}
+
+std::string
+Commit::getAuthorName()
+{
+    const git_signature* signature = git_commit_author(m_commit);
+    return signature && signature->name ? std::string(signature->name) : std::string();
+}
+
+int64_t
+Commit::getTime()
+{
+    return git_commit_time(m_commit);
+}
+
+git_oid
+Commit::getOid()
+{
+    return *git_commit_id(m_commit);
+}
+
+std::vector<CommitChange>
+Commit::getChanges()
+{
+    std::vector<CommitChange> changes;
+    git_tree* tree{nullptr};
+    git_tree* parentTree{nullptr};
+    git_commit* parent{nullptr};
+    git_diff* diff{nullptr};
+    int error = git_commit_tree(&tree, m_commit);
+    if (error == 0
+     && git_commit_parentcount(m_commit) > 0) {
+        error = git_commit_parent(&parent, m_commit, 0);
+        if (error == 0) {
+            error = git_commit_tree(&parentTree, parent);
+        }
+    }
+    if (error == 0) {
+        // the initial commit is compared to the empty tree
+        error = git_diff_tree_to_tree(&diff, git_commit_owner(m_commit), parentTree, tree, nullptr);
+    }
+    if (error == 0) {
+        size_t count = git_diff_num_deltas(diff);
+        changes.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            const git_diff_delta* delta = git_diff_get_delta(diff, i);
+            CommitChange change;
+            change.path = delta->new_file.path;
+            change.mode = delta->new_file.mode;
+            switch (delta->status) {
+            case GIT_DELTA_ADDED:
+                change.status = FileStatus::New;
+                break;
+            case GIT_DELTA_DELETED:
+                change.path = delta->old_file.path;
+                change.mode = delta->old_file.mode;
+                change.status = FileStatus::Deleted;
+                break;
+            case GIT_DELTA_MODIFIED:
+                change.status = FileStatus::Modified;
+                break;
+            case GIT_DELTA_RENAMED:
+                change.status = FileStatus::Renamed;
+                break;
+            case GIT_DELTA_TYPECHANGE:
+                change.status = FileStatus::TypeChange;
+                break;
+            default:
+                change.status = FileStatus::Current;
+                break;
+            }
+            changes.emplace_back(std::move(change));
+        }
+    }
+    if (diff) {
+        git_diff_free(diff);
+    }
+    if (parentTree) {
+        git_tree_free(parentTree);
+    }
+    if (parent) {
+        git_commit_free(parent);
+    }
+    if (tree) {
+        git_tree_free(tree);
+    }
+    if (error != 0) {
+        throw GitException(
+                Repository::errorMsg(error, "Failed to get changes"));
+    }
+    return changes;
+}
+
+// --------------------------------------------------------
+//    RevWalk
+// --------------------------------------------------------
+
+RevWalk::RevWalk(git_repository* repo)
+{
+    int error = git_revwalk_new(&m_walk, repo);
+    if (error == 0) {
+        git_revwalk_sorting(m_walk, GIT_SORT_TIME);
+        error = git_revwalk_push_head(m_walk);
+    }
+    if (error != 0) {
+        if (m_walk) {
+            git_revwalk_free(m_walk);
+            m_walk = nullptr;
+        }
+        throw GitException(
+                Repository::errorMsg(error, "Failed to walk history"));
+    }
+}
+
+RevWalk::~RevWalk()
+{
+    if (m_walk) {
+        git_revwalk_free(m_walk);
+    }
+}
+
+bool
+RevWalk::next(git_oid& oid)
+{
+    return git_revwalk_next(&oid, m_walk) == 0;
+}
+
 // --------------------------------------------------------
 //    Repository
 // --------------------------------------------------------
@@ -164,6 +296,111 @@ Repository::getSingelCommit(const std::string& rev)
     return std::make_shared<Commit>(commit);
 }
 
+std::shared_ptr<Commit>
+Repository::getCommit(const git_oid& oid)
+{
+    git_commit *commit{nullptr};
+    int error = git_commit_lookup(&commit, m_repo, &oid);
+    if (error != 0) {
+        throw GitException(
+                errorMsg(error, "Commit lookup failed"));
+    }
+    return std::make_shared<Commit>(commit);
+}
+
+std::shared_ptr<RevWalk>
+Repository::getRevWalk()
+{
+    return std::make_shared<RevWalk>(m_repo);
+}
+
+git_oid
+Repository::resolveTree(const std::string& revision)
+{
+    git_object* obj{nullptr};
+    int error = git_revparse_single(&obj, m_repo, revision.c_str());
+    if (error != 0) {
+        throw GitException(
+                errorMsg(error, "Unknown revision " + revision));
+    }
+    git_object* tree{nullptr};
+    error = git_object_peel(&tree, obj, GIT_OBJECT_TREE);
+    git_object_free(obj);
+    if (error != 0) {
+        throw GitException(
+                errorMsg(error, "No tree for " + revision));
+    }
+    git_oid oid;
+    git_oid_cpy(&oid, git_object_id(tree));
+    git_object_free(tree);
+    return oid;
+}
+
+std::vector<TreeEntry>
+Repository::getTreeEntries(const git_oid& treeOid)
+{
+    git_tree* tree{nullptr};
+    int error = git_tree_lookup(&tree, m_repo, &treeOid);
+    if (error != 0) {
+        throw GitException(
+                errorMsg(error, "Failed to lookup tree"));
+    }
+    std::vector<TreeEntry> entries;
+    size_t count = git_tree_entrycount(tree);
+    entries.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        const git_tree_entry* gitEntry = git_tree_entry_byindex(tree, i);
+        TreeEntry entry;
+        entry.name = git_tree_entry_name(gitEntry);
+        git_oid_cpy(&entry.oid, git_tree_entry_id(gitEntry));
+        entry.type = git_tree_entry_type(gitEntry);
+        entry.mode = static_cast<uint32_t>(git_tree_entry_filemode(gitEntry));
+        entries.emplace_back(std::move(entry));
+    }
+    git_tree_free(tree);
+    return entries;
+}
+
+std::string
+Repository::readBlob(const git_oid& blobOid)
+{
+    git_blob* blob{nullptr};
+    int error = git_blob_lookup(&blob, m_repo, &blobOid);
+    if (error != 0) {
+        throw GitException(
+                errorMsg(error, "Failed to lookup blob"));
+    }
+    std::string content(static_cast<const char*>(git_blob_rawcontent(blob))
+                      , static_cast<size_t>(git_blob_rawsize(blob)));
+    git_blob_free(blob);
+    return content;
+}
+
+std::vector<std::string>
+Repository::getReferenceNames()
+{
+    git_strarray refs{nullptr, 0};
+    int error = git_reference_list(&refs, m_repo);
+    if (error != 0) {
+        throw GitException(
+                errorMsg(error, "Failed to list references"));
+    }
+    std::vector<std::string> names;
+    names.reserve(refs.count);
+    for (size_t i = 0; i < refs.count; ++i) {
+        std::string_view name{refs.strings[i]};
+        if (name.starts_with("refs/heads/")) {
+            name.remove_prefix(11);
+        }
+        else if (name.starts_with("refs/")) {
+            name.remove_prefix(5);
+        }
+        names.emplace_back(name);
+    }
+    git_strarray_dispose(&refs);
+    return names;
+}
+
 std::string
 Repository::getBranch()
 {
@@ -281,6 +518,26 @@ Repository::clone(const std::string& url)
     }
 }
 
+void
+Repository::fetch(const std::string& remoteName)
+{
+    git_remote* remote{nullptr};
+    int error = git_remote_lookup(&remote, m_repo, remoteName.c_str());
+    if (error != 0) {
+        throw GitException(
+            errorMsg(error, "No remote " + remoteName));
+    }
+    git_fetch_options fetch_opts = GIT_FETCH_OPTIONS_INIT;
+    fetch_opts.callbacks.transfer_progress = fetch_progress;
+    fetch_opts.callbacks.payload = this;
+    error = git_remote_fetch(remote, nullptr, &fetch_opts, nullptr);
+    git_remote_free(remote);
+    if (error != 0) {
+        throw GitException(
+            errorMsg(error, "Failed to fetch"));
+    }
+}
+
 void
 Repository::setCheckoutListener(CheckoutListener* checkoutListenr)
 {
@@ -314,9 +571,238 @@ Repository::fetchProgress(const git_indexer_progress *stats)
 
 
 Status
-Repository::getStatus()
+Repository::getStatus(const StatusOptions& options)
+{
+    return Status(m_repo, options);
+}
+
+bool
+Repository::getFileStatus(const std::string& path, File& file)
 {
-    return Status(m_repo);
+    unsigned int status{0};
+    int error = git_status_file(&status, m_repo, path.c_str());
+    if (error == GIT_ENOTFOUND) {
+        return false;
+    }
+    if (error) {
+        throw GitException(
+                Repository::errorMsg(error, "Failed to get status for " + path));
+    }
+    DirStatus dirStatIndex;
+    DirStatus dirStatWorkdir;
+    Status::setFlags(status, dirStatIndex, dirStatWorkdir);
+    dirStatIndex.setOldPath(path);
+    dirStatWorkdir.setOldPath(path);
+    file.setIndex(dirStatIndex);
+    file.setWorkdir(dirStatWorkdir);
+    file.setStat(FileStat());
+    return true;
+}
+
+bool
+Repository::isIgnored(const std::string& path)
+{
+    int ignored{0};
+    int error = git_ignore_path_is_ignored(&ignored, m_repo, path.c_str());
+    if (error) {
+        throw GitException(
+                Repository::errorMsg(error, "Failed to check ignore for " + path));
+    }
+    return ignored != 0;
+}
+
+std::string
+Repository::getWorkdir()
+{
+    const char* workdir = git_repository_workdir(m_repo);
+    return workdir ? std::string(workdir) : std::string();
+}
+
+std::string
+Repository::getGitDir()
+{
+    return std::string(git_repository_path(m_repo));
+}
+
+std::vector<BlameHunk>
+Repository::getBlame(const std::string& path, size_t minLine, size_t maxLine)
+{
+    git_blame_options opts;
+    git_blame_options_init(&opts, GIT_BLAME_OPTIONS_VERSION);
+    opts.min_line = minLine;
+    opts.max_line = maxLine;
+    git_blame* blame{nullptr};
+    int error = git_blame_file(&blame, m_repo, path.c_str(), &opts);
+    if (error != 0) {
+        throw GitException(
+                errorMsg(error, "Failed to blame " + path));
+    }
+    std::vector<BlameHunk> hunks;
+    uint32_t count = git_blame_get_hunk_count(blame);
+    hunks.reserve(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        const git_blame_hunk* gitHunk = git_blame_get_hunk_byindex(blame, i);
+        BlameHunk hunk;
+        hunk.startLine = gitHunk->final_start_line_number;
+        hunk.lines = gitHunk->lines_in_hunk;
+        git_oid_cpy(&hunk.commit, &gitHunk->final_commit_id);
+        if (gitHunk->final_signature) {
+            hunk.author = gitHunk->final_signature->name;
+            hunk.time = gitHunk->final_signature->when.time;
+        }
+        hunks.emplace_back(std::move(hunk));
+    }
+    git_blame_free(blame);
+    return hunks;
+}
+
+size_t
+Repository::getCommittedLines(const std::string& path)
+{
+    git_object* obj{nullptr};
+    std::string spec = "HEAD:" + path;
+    int error = git_revparse_single(&obj, m_repo, spec.c_str());
+    if (error != 0) {
+        throw GitException(
+                errorMsg(error, "No committed version of " + path));
+    }
+    size_t lines{0};
+    if (git_object_type(obj) == GIT_OBJECT_BLOB) {
+        auto blob = reinterpret_cast<git_blob*>(obj);
+        auto content = static_cast<const char*>(git_blob_rawcontent(blob));
+        auto size = static_cast<size_t>(git_blob_rawsize(blob));
+        for (size_t i = 0; i < size; ++i) {
+            if (content[i] == '\n') {
+                ++lines;
+            }
+        }
+        if (size > 0 && content[size - 1] != '\n') {
+            ++lines;    // last line without newline
+        }
+    }
+    git_object_free(obj);
+    return lines;
+}
+
+std::string
+Repository::getCommittedId(const std::string& path)
+{
+    git_object* obj{nullptr};
+    std::string spec = "HEAD:" + path;
+    int error = git_revparse_single(&obj, m_repo, spec.c_str());
+    if (error != 0) {
+        return std::string();   // not committed
+    }
+    std::string id{git_oid_tostr_s(git_object_id(obj))};
+    git_object_free(obj);
+    return id;
+}
+
+std::string
+Repository::getHeadId()
+{
+    git_oid oid;
+    int error = git_reference_name_to_id(&oid, m_repo, "HEAD");
+    if (error != 0) {
+        return std::string();   // unborn
+    }
+    return std::string(git_oid_tostr_s(&oid));
+}
+
+void
+Repository::diffWorkdir(const std::vector<std::string>& paths, DiffListener* listener)
+{
+    git_diff_options opts;
+    git_diff_options_init(&opts, GIT_DIFF_OPTIONS_VERSION);
+    opts.flags = GIT_DIFF_INCLUDE_UNTRACKED
+               | GIT_DIFF_SHOW_UNTRACKED_CONTENT
+               | GIT_DIFF_DISABLE_PATHSPEC_MATCH;
+    std::vector<char*> pathspec;
+    pathspec.reserve(paths.size());
+    for (auto& path : paths) {
+        pathspec.push_back(const_cast<char*>(path.c_str()));
+    }
+    opts.pathspec.strings = pathspec.data();
+    opts.pathspec.count = pathspec.size();
+    git_tree* head{nullptr};
+    git_object* obj{nullptr};
+    if (git_revparse_single(&obj, m_repo, "HEAD^{tree}") == 0) {
+        head = reinterpret_cast<git_tree*>(obj);    // otherwise unborn, diff against empty tree
+    }
+    git_diff* diff{nullptr};
+    int error = git_diff_tree_to_workdir_with_index(&diff, m_repo, head, &opts);
+    git_tree_free(head);
+    if (error != 0) {
+        throw GitException(
+                errorMsg(error, "Failed to diff"));
+    }
+    bool cont{true};
+    size_t deltas = git_diff_num_deltas(diff);
+    for (size_t i = 0; cont && i < deltas; ++i) {
+        git_patch* patch{nullptr};
+        error = git_patch_from_diff(&patch, diff, i);
+        if (error != 0) {
+            git_diff_free(diff);
+            throw GitException(
+                    errorMsg(error, "Failed to create patch"));
+        }
+        const git_diff_delta* delta = git_diff_get_delta(diff, i);
+        DiffHunk hunk;
+        hunk.path = delta->new_file.path ? delta->new_file.path : delta->old_file.path;
+        hunk.text = "diff --git a/" + std::string(delta->old_file.path)
+                  + " b/" + std::string(delta->new_file.path) + "\n"
+                  + "--- a/" + std::string(delta->old_file.path) + "\n"
+                  + "+++ b/" + std::string(delta->new_file.path) + "\n";
+        hunk.lines = 3;
+        size_t hunks = patch ? git_patch_num_hunks(patch) : 0;
+        if (!patch || (delta->flags & GIT_DIFF_FLAG_BINARY)) {
+            hunk.text += "Binary files differ\n";
+            ++hunk.lines;
+            hunks = 0;
+        }
+        if (hunks == 0) {
+            cont = listener->diffHunk(hunk);
+        }
+        for (size_t h = 0; cont && h < hunks; ++h) {
+            const git_diff_hunk* gitHunk{nullptr};
+            size_t lines{0};
+            git_patch_get_hunk(&gitHunk, &lines, patch, h);
+            hunk.text.append(gitHunk->header, gitHunk->header_len);
+            ++hunk.lines;
+            for (size_t l = 0; l < lines; ++l) {
+                const git_diff_line* line{nullptr};
+                git_patch_get_line_in_hunk(&line, patch, h, l);
+                if (line->origin == GIT_DIFF_LINE_CONTEXT
+                 || line->origin == GIT_DIFF_LINE_ADDITION
+                 || line->origin == GIT_DIFF_LINE_DELETION) {
+                    hunk.text += line->origin;
+                }
+                hunk.text.append(line->content, line->content_len);
+                if (line->content_len == 0
+                 || line->content[line->content_len - 1] != '\n') {
+                    hunk.text += '\n';     // e.g. no newline at end of file
+                }
+                ++hunk.lines;
+            }
+            cont = listener->diffHunk(hunk);
+            hunk.text.clear();
+            hunk.lines = 0;
+        }
+        git_patch_free(patch);
+    }
+    git_diff_free(diff);
+}
+
+std::string
+Repository::discover(const std::string& path)
+{
+    git_buf buf = GIT_BUF_INIT;
+    std::string gitDir;
+    if (git_repository_discover(&buf, path.c_str(), 0, nullptr) == 0) {
+        gitDir = buf.ptr;
+    }
+    git_buf_dispose(&buf);
+    return gitDir;
 }
 
 StatusIterator::StatusIterator(Status* status, size_t index)
@@ -339,17 +825,58 @@ StatusIterator::operator++()
     return *this;
 }
 
-Status::Status(git_repository* repos)
+UntrackedMode
+StatusOptions::toUntrackedMode(const std::string& mode)
+{
+    if (mode == "none") {
+        return UntrackedMode::None;
+    }
+    if (mode == "all") {
+        return UntrackedMode::All;
+    }
+    return UntrackedMode::Collapsed;
+}
+
+Status::Status(git_repository* repos, const StatusOptions& options)
 {
     //std::cout << "Status::Status" << std::endl;
     git_status_options statusopt = GIT_STATUS_OPTIONS_INIT;
     statusopt.show  = GIT_STATUS_SHOW_INDEX_AND_WORKDIR;
-    statusopt.flags =
-        GIT_STATUS_OPT_INCLUDE_UNMODIFIED |
-        GIT_STATUS_OPT_INCLUDE_UNTRACKED |
-        GIT_STATUS_OPT_INCLUDE_IGNORED |
-        GIT_STATUS_OPT_RENAMES_HEAD_TO_INDEX |
-        GIT_STATUS_OPT_SORT_CASE_SENSITIVELY;
+    statusopt.flags = GIT_STATUS_OPT_SORT_CASE_SENSITIVELY;
+    if (options.unmodified) {
+        statusopt.flags |= GIT_STATUS_OPT_INCLUDE_UNMODIFIED;
+    }
+    switch (options.untracked) {
+    case UntrackedMode::None:
+        break;
+    case UntrackedMode::Collapsed:
+        statusopt.flags |= GIT_STATUS_OPT_INCLUDE_UNTRACKED;
+        break;
+    case UntrackedMode::All:
+        statusopt.flags |= GIT_STATUS_OPT_INCLUDE_UNTRACKED
+                        |  GIT_STATUS_OPT_RECURSE_UNTRACKED_DIRS;
+        break;
+    }
+    if (options.ignored) {
+        statusopt.flags |= GIT_STATUS_OPT_INCLUDE_IGNORED;
+    }
+    if (options.renames) {
+        statusopt.flags |= GIT_STATUS_OPT_RENAMES_HEAD_TO_INDEX
+                        |  GIT_STATUS_OPT_RENAMES_INDEX_TO_WORKDIR;
+    }
+    if (options.updateIndex) {
+        statusopt.flags |= GIT_STATUS_OPT_UPDATE_INDEX;
+    }
+    // the strings are only referenced while querying
+    std::vector<char*> paths;
+    paths.reserve(options.pathspec.size());
+    for (auto& path : options.pathspec) {
+        paths.push_back(const_cast<char*>(path.c_str()));
+    }
+    if (!paths.empty()) {
+        statusopt.pathspec.strings = paths.data();
+        statusopt.pathspec.count = paths.size();
+    }
 
     int error = git_status_list_new(&m_status, repos, &statusopt);
     if (error) {
@@ -357,6 +884,13 @@ Status::Status(git_repository* repos)
                 Repository::errorMsg(error, "Failed to get status"));
     }
     m_maxi = git_status_list_entrycount(m_status);
+    // the stat data of unmodified files (not available for bare repos),
+    //   only fresh if the status updated it, otherwise a unmodified
+    //   file may be matched by content with a stale stat
+    if (!options.updateIndex
+     || git_repository_index(&m_index, repos) != 0) {
+        m_index = nullptr;
+    }
 }
 
 
@@ -364,7 +898,10 @@ Status::Status(Status&& status)
 {
     m_status = status.m_status;
     m_file = status.m_file;
+    m_maxi = status.m_maxi;
+    m_index = status.m_index;
     status.m_status = nullptr;
+    status.m_index = nullptr;
 }
 
 Status::~Status()
@@ -373,6 +910,57 @@ Status::~Status()
         git_status_list_free(m_status);
         m_status = nullptr;
     }
+    if (m_index) {
+        git_index_free(m_index);
+        m_index = nullptr;
+    }
+}
+
+void
+Status::setFlags(unsigned int status, DirStatus& dirStatIndex, DirStatus& dirStatWorkdir)
+{
+    if (status == GIT_STATUS_CURRENT) {  // this will not be reported ... (and dont see option for it)
+        dirStatIndex.setStatus(FileStatus::Current);
+    }
+    else {
+        if (status & GIT_STATUS_INDEX_NEW)
+            dirStatIndex.setStatus(FileStatus::New);
+        if (status & GIT_STATUS_INDEX_MODIFIED)
+            dirStatIndex.setStatus(FileStatus::Modified);
+        if (status & GIT_STATUS_INDEX_DELETED)
+            dirStatIndex.setStatus(FileStatus::Deleted);
+        if (status & GIT_STATUS_INDEX_RENAMED)
+            dirStatIndex.setStatus(FileStatus::Deleted);
+        if (status & GIT_STATUS_INDEX_TYPECHANGE)
+            dirStatIndex.setStatus(FileStatus::TypeChange);
+    }
+    /**
+     * With `GIT_STATUS_OPT_INCLUDE_UNMODIFIED` (not used in this example)
+     * `index_to_workdir` may not be `NULL` even if there are
+     * no differences, in which case it will be a `GIT_DELTA_UNMODIFIED`.
+     */
+    if (status == GIT_STATUS_CURRENT) {  /*  || s->index_to_workdir == nullptr */
+        dirStatWorkdir.setStatus(FileStatus::Current);
+    }
+    else {
+        /** Print out the output since we know the file has some changes */
+        if (status & GIT_STATUS_WT_MODIFIED)
+            dirStatWorkdir.setStatus(FileStatus::Modified);
+        if (status & GIT_STATUS_WT_DELETED)
+            dirStatWorkdir.setStatus(FileStatus::Deleted);
+        if (status & GIT_STATUS_WT_RENAMED)
+            dirStatWorkdir.setStatus(FileStatus::Renamed);
+        if (status & GIT_STATUS_WT_TYPECHANGE)
+            dirStatWorkdir.setStatus(FileStatus::TypeChange);
+        if (status & GIT_STATUS_WT_NEW)
+            dirStatWorkdir.setStatus(FileStatus::New);  // or named untracked
+    }
+    if (status == GIT_STATUS_IGNORED) {
+        if (dirStatWorkdir.getStatus() == FileStatus::None)
+            dirStatWorkdir.setStatus(FileStatus::Ignore);
+        if (dirStatIndex.getStatus() == FileStatus::None)
+            dirStatIndex.setStatus(FileStatus::Ignore);
+    }
 }
 
 bool
@@ -387,21 +975,7 @@ Status::inc(const StatusIterator* iter)
         //          << " index " << iter->getIndex() << "/" << m_maxi << std::endl;
         const git_status_entry* s = git_status_byindex(m_status, index);
         //std::cout << std::hex << "status " << s->status << " curr " << GIT_STATUS_CURRENT << std::dec << std::endl;
-        if (s->status == GIT_STATUS_CURRENT) {  // this will not be reported ... (and dont see option for it)
-            dirStatIndex.setStatus(FileStatus::Current);
-        }
-        else {
-            if (s->status & GIT_STATUS_INDEX_NEW)
-                dirStatIndex.setStatus(FileStatus::New);
-            if (s->status & GIT_STATUS_INDEX_MODIFIED)
-                dirStatIndex.setStatus(FileStatus::Modified);
-            if (s->status & GIT_STATUS_INDEX_DELETED)
-                dirStatIndex.setStatus(FileStatus::Deleted);
-            if (s->status & GIT_STATUS_INDEX_RENAMED)
-                dirStatIndex.setStatus(FileStatus::Deleted);
-            if (s->status & GIT_STATUS_INDEX_TYPECHANGE)
-                dirStatIndex.setStatus(FileStatus::TypeChange);
-        }
+        setFlags(s->status, dirStatIndex, dirStatWorkdir);
         const char* old_path = s->head_to_index
                                 ? s->head_to_index->old_file.path
                                 : nullptr;
@@ -416,27 +990,6 @@ Status::inc(const StatusIterator* iter)
             dirStatIndex.setOldPath(old_path ? old_path : new_path);
         }
 
-        /**
-         * With `GIT_STATUS_OPT_INCLUDE_UNMODIFIED` (not used in this example)
-         * `index_to_workdir` may not be `NULL` even if there are
-         * no differences, in which case it will be a `GIT_DELTA_UNMODIFIED`.
-         */
-        if (s->status == GIT_STATUS_CURRENT) {  /*  || s->index_to_workdir == nullptr */
-            dirStatWorkdir.setStatus(FileStatus::Current);
-        }
-        else {
-            /** Print out the output since we know the file has some changes */
-            if (s->status & GIT_STATUS_WT_MODIFIED)
-                dirStatWorkdir.setStatus(FileStatus::Modified);
-            if (s->status & GIT_STATUS_WT_DELETED)
-                dirStatWorkdir.setStatus(FileStatus::Deleted);
-            if (s->status & GIT_STATUS_WT_RENAMED)
-                dirStatWorkdir.setStatus(FileStatus::Renamed);
-            if (s->status & GIT_STATUS_WT_TYPECHANGE)
-                dirStatWorkdir.setStatus(FileStatus::TypeChange);
-            if (s->status & GIT_STATUS_WT_NEW)
-                dirStatWorkdir.setStatus(FileStatus::New);  // or named untracked
-        }
         old_path = s->index_to_workdir
                                 ? s->index_to_workdir->old_file.path
                                 : nullptr;
@@ -451,15 +1004,24 @@ Status::inc(const StatusIterator* iter)
             dirStatWorkdir.setOldPath(old_path ? old_path : new_path);
         }
 
-        if (s->status == GIT_STATUS_IGNORED) {
-            if (dirStatWorkdir.getStatus() == FileStatus::None)
-                dirStatWorkdir.setStatus(FileStatus::Ignore);
-            if (dirStatIndex.getStatus() == FileStatus::None)
-                dirStatIndex.setStatus(FileStatus::Ignore);
+        FileStat stat;
+        if (m_index
+         && s->status == GIT_STATUS_CURRENT
+         && new_path) {
+            // the stat was refreshed by the status (see constructor)
+            const git_index_entry* entry = git_index_get_bypath(m_index, new_path, 0);
+            if (entry) {
+                stat.valid = true;
+                stat.mode = entry->mode;    // git keeps only the executable bit 0644/0755
+                stat.size = entry->file_size;
+                stat.modified = entry->mtime.seconds;
+                stat.uid = entry->uid;
+                stat.gid = entry->gid;
+            }
         }
-
         m_file.setIndex(dirStatIndex);
         m_file.setWorkdir(dirStatWorkdir);
+        m_file.setStat(stat);
         return true;
     }
     return false;
@@ -489,6 +1051,93 @@ Status::getMax()
     return m_maxi;
 }
 
+std::map<std::string, RepositoryCache::GitDir> RepositoryCache::m_gitDirs;
+std::map<std::string, std::weak_ptr<Repository>> RepositoryCache::m_repositories;
+std::map<std::string, std::string> RepositoryCache::m_workdirs;
+
+std::shared_ptr<Repository>
+RepositoryCache::open(const std::string& gitDir)
+{
+    auto entry = m_repositories.find(gitDir);
+    if (entry != m_repositories.end()) {
+        auto repository = entry->second.lock();
+        if (repository) {
+            return repository;
+        }
+    }
+    auto repository = std::make_shared<Repository>(gitDir);
+    m_repositories.insert_or_assign(gitDir, repository);
+    m_workdirs.insert_or_assign(gitDir, repository->getWorkdir());
+    return repository;
+}
+
+std::string
+RepositoryCache::getGitDir(const std::string& dir)
+{
+    auto now = g_get_monotonic_time();
+    auto entry = m_gitDirs.find(dir);
+    if (entry == m_gitDirs.end()
+     || (entry->second.gitDir.empty()
+      && now - entry->second.checked > NOT_FOUND_US)) {
+        // a dir may become a repository e.g. by init or clone
+        GitDir gitDir;
+        gitDir.gitDir = Repository::discover(dir);
+        gitDir.checked = now;
+        entry = m_gitDirs.insert_or_assign(dir, gitDir).first;
+    }
+    return entry->second.gitDir;
+}
+
+std::shared_ptr<Repository>
+RepositoryCache::get(const std::string& dir)
+{
+    auto gitDir = getGitDir(dir);
+    if (gitDir.empty()) {
+        return std::shared_ptr<Repository>();
+    }
+    try {
+        return open(gitDir);
+    }
+    catch (const GitException& ex) {
+        auto& entry = m_gitDirs[dir];  // not usable, try again later
+        entry.gitDir.clear();
+        entry.checked = g_get_monotonic_time();
+    }
+    return std::shared_ptr<Repository>();
+}
+
+std::string
+RepositoryCache::getWorkdir(const std::string& dir)
+{
+    auto gitDir = getGitDir(dir);
+    if (gitDir.empty()) {
+        return std::string();
+    }
+    auto workdir = m_workdirs.find(gitDir);
+    if (workdir != m_workdirs.end()) {
+        return workdir->second;
+    }
+    auto repository = get(dir);     // opened once, remembers the workdir
+    if (!repository) {
+        return std::string();
+    }
+    return repository->getWorkdir();
+}
+
+void
+RepositoryCache::clear()
+{
+    m_gitDirs.clear();
+    m_workdirs.clear();
+    for (auto iter = m_repositories.begin(); iter != m_repositories.end(); ) {
+        if (iter->second.expired()) {
+            iter = m_repositories.erase(iter);
+        }
+        else {
+            ++iter;
+        }
+    }
+}
 
 } /* namespace git */
 } /* namespace psc */
@@ -20,7 +20,9 @@
 
 #include <string>
 #include <exception>
+#include <map>
 #include <memory>
+#include <vector>
 #include <glibmm.h>
 
 #include <git2.h>
@@ -173,6 +175,18 @@ private:
 };
 
 
+// the stat values git keeps in the index
+class FileStat
+{
+public:
+    bool valid{false};
+    uint32_t mode{0};       // as st_mode, for regular files the permission is 0644 or 0755
+    int64_t size{0};
+    int64_t modified{0};    // seconds
+    uint32_t uid{0};
+    uint32_t gid{0};
+};
+
 class File
 {
 public:
@@ -202,6 +216,15 @@ public:
     {
         return m_workdir;
     }
+    // only valid if the workdir is unmodified, as the index knows it
+    void setStat(const FileStat& stat)
+    {
+        m_stat = stat;
+    }
+    const FileStat& getStat()
+    {
+        return m_stat;
+    }
     std::string to_string()
     {
         return m_index.to_string() + "\t\t\t" + m_workdir.to_string();
@@ -209,16 +232,47 @@ public:
 private:
     DirStatus m_index;
     DirStatus m_workdir;
+    FileStat m_stat;
 };
 
 
 class StatusIterator;
 
+enum class UntrackedMode
+{
+      None          // don't list untracked files
+    , Collapsed     // list untracked directories, without the content
+    , All           // recurse into untracked directories
+};
+
+/**
+ * controls what the status query has to look at,
+ *   the defaults avoid the expensive parts
+ *   (rename detection, recursing untracked directories)
+ *   and keep the refreshed stat info in the index
+ *   so the next query will not hash the same files again.
+ */
+class StatusOptions
+{
+public:
+    StatusOptions() = default;
+    virtual ~StatusOptions() = default;
+
+    UntrackedMode untracked{UntrackedMode::Collapsed};
+    bool ignored{true};
+    bool unmodified{true};
+    bool renames{false};
+    bool updateIndex{true};
+    // restrict to these paths (relative to workdir), empty for all
+    std::vector<std::string> pathspec;
+
+    static UntrackedMode toUntrackedMode(const std::string& mode);
+};
 
 class Status
 {
 public:
-    Status(git_repository* repos);
+    Status(git_repository* repos, const StatusOptions& options = StatusOptions());
     // don't allow to copy this
     explicit Status(const Status& other) = delete;
     // but allow to move, (keep only one reference) so we won't run into freeing issues
@@ -229,9 +283,12 @@ public:
     StatusIterator begin();
     StatusIterator end();
     size_t getMax();
+    // map the git status bits
+    static void setFlags(unsigned int status, DirStatus& dirStatIndex, DirStatus& dirStatWorkdir);
 
 private:
     git_status_list *m_status{nullptr};
+    git_index* m_index{nullptr};
     File m_file;
     size_t m_maxi;
 };
@@ -297,18 +354,92 @@ private:
 };
 
 
+// a file changed by a commit
+class CommitChange
+{
+public:
+    std::string path;
+    FileStatus status{FileStatus::None};
+    uint32_t mode{0};
+};
+
 class Commit
 {
 public:
     Commit(git_commit *commit);
+    explicit Commit(const Commit& orig) = delete;
     virtual ~Commit();
 
     std::string getMessage();
+    // first line of message
+    std::string getSummary();
     std::shared_ptr<Signature> getSignature();
+    // without creating a signature
+    std::string getAuthorName();
+    // seconds since epoch
+    int64_t getTime();
+    git_oid getOid();
+    // compared to the first parent
+    std::vector<CommitChange> getChanges();
 private:
     git_commit *m_commit{nullptr};
 };
 
+/**
+ * walk the history from HEAD,
+ *   the newest commits first.
+ */
+class RevWalk
+{
+public:
+    RevWalk(git_repository* repo);
+    explicit RevWalk(const RevWalk& orig) = delete;
+    virtual ~RevWalk();
+
+    // false at end
+    bool next(git_oid& oid);
+private:
+    git_revwalk* m_walk{nullptr};
+};
+
+// a entry of a tree object
+class TreeEntry
+{
+public:
+    std::string name;
+    git_oid oid;
+    git_object_t type{GIT_OBJECT_INVALID};
+    uint32_t mode{0};
+};
+
+// a hunk as text, the first of a file starts with the file header
+class DiffHunk
+{
+public:
+    std::string path;
+    std::string text;
+    size_t lines{0};
+};
+
+class DiffListener
+{
+public:
+    virtual ~DiffListener() = default;
+    // return false to stop
+    virtual bool diffHunk(DiffHunk& hunk) = 0;
+};
+
+// lines of a file last changed by the same commit
+class BlameHunk
+{
+public:
+    size_t startLine{0};    // 1 based, as git counts
+    size_t lines{0};
+    git_oid commit;
+    std::string author;
+    int64_t time{0};
+};
+
 class CheckoutListener
 {
 public:
@@ -318,6 +449,7 @@ public:
 class FetchListener
 {
 public:
+    // return non zero to cancel
     virtual int fetchProgress(const git_indexer_progress *stats) = 0;
 };
 
@@ -330,13 +462,40 @@ public:
 
     static std::string errorMsg(int error, const std::string& message);
     std::shared_ptr<Commit> getSingelCommit(const std::string& rev);
+    std::shared_ptr<Commit> getCommit(const git_oid& oid);
+    std::shared_ptr<RevWalk> getRevWalk();
+    // the root tree of a commit, tag or branch (any revision git understands)
+    git_oid resolveTree(const std::string& revision);
+    std::vector<TreeEntry> getTreeEntries(const git_oid& tree);
+    std::string readBlob(const git_oid& blob);
+    // branches without "refs/heads/", others without "refs/"
+    std::vector<std::string> getReferenceNames();
     std::string getBranch();
-    Status getStatus();
+    Status getStatus(const StatusOptions& options = StatusOptions());
+    // status of a single path (relative to workdir), false if not known to git or workdir
+    bool getFileStatus(const std::string& path, File& file);
+    bool isIgnored(const std::string& path);
+    // with trailing "/"
+    std::string getWorkdir();
+    std::string getGitDir();
+    // blame the committed version of path, lines are 1 based, 0 for no limit
+    std::vector<BlameHunk> getBlame(const std::string& path, size_t minLine = 0, size_t maxLine = 0);
+    // number of lines of path in HEAD
+    size_t getCommittedLines(const std::string& path);
+    // the blob id of path in HEAD, empty if not committed
+    std::string getCommittedId(const std::string& path);
+    std::string getHeadId();
+    // the git dir for path (or any parent), empty if there is none
+    static std::string discover(const std::string& path);
+    // the changes of the working tree (incl. index) against HEAD, paths relative to workdir
+    void diffWorkdir(const std::vector<std::string>& paths, DiffListener* listener);
     // e.g. "refs/heads/*"
     std::vector<std::string> getIter(const std::string& query);
     // e.g. "origin"
     Remote getRemote(const std::string& query);
     void clone(const std::string& url);
+    // update the remote tracking branches of the remote e.g. "origin"
+    void fetch(const std::string& remoteName);
     void setCheckoutListener(CheckoutListener* checkoutListenr);
     void checkoutProgress(const char *path, size_t curent, size_t total);
     void setFetchListener(FetchListener* fetchListener);
@@ -348,5 +507,41 @@ private:
     FetchListener* m_fetchListener{nullptr};
 };
 
+/**
+ * find and share the repositories used by the process,
+ *   the repository of a directory is found once by git_repository_discover
+ *   (so subdirectories and worktrees are recognized),
+ *   a opened repository is shared as long as it is in use.
+ *   Use from the main thread only, background work needs a own Repository
+ *   as a git_repository must not be used by multiple threads at the same time.
+ */
+class RepositoryCache
+{
+public:
+    // the workdir (with trailing "/") of the repository containing dir, empty if none (or bare)
+    static std::string getWorkdir(const std::string& dir);
+    // the repository containing dir, nullptr if none
+    static std::shared_ptr<Repository> get(const std::string& dir);
+    // forget the directories e.g. after a repository was created
+    static void clear();
+
+    // a dir that is not in a repository is looked up again after this
+    static constexpr gint64 NOT_FOUND_US{5000000l};
+protected:
+    static std::shared_ptr<Repository> open(const std::string& gitDir);
+    // the git dir of the repository containing dir, empty if none
+    static std::string getGitDir(const std::string& dir);
+private:
+    class GitDir
+    {
+    public:
+        std::string gitDir;     // empty if none
+        gint64 checked{0};      // monotonic
+    };
+    static std::map<std::string, GitDir> m_gitDirs;     // by dir
+    static std::map<std::string, std::weak_ptr<Repository>> m_repositories;     // by git dir
+    static std::map<std::string, std::string> m_workdirs;   // by git dir, so it needs no open
+};
+
 } /* namespace git */
 } /* namespace psc */
@@ -0,0 +1,589 @@
+/* -*- Mode: c++; c-basic-offset: 4; tab-width: 4; coding: utf-8; -*-  */
+/*
+ * Copyright (C) 2025 RPf
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <cerrno>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include "GitStatusMonitor.hpp"
+
+namespace psc {
+namespace git {
+
+static constexpr uint32_t WATCH_MASK =
+      IN_CREATE
+    | IN_DELETE
+    | IN_CLOSE_WRITE
+    | IN_MODIFY
+    | IN_ATTRIB
+    | IN_MOVED_FROM
+    | IN_MOVED_TO;
+
+StatusWatchWorker::StatusWatchWorker(const std::string& workdir
+                    , const std::set<std::string>& collapsed
+                    , StatusMonitor* monitor)
+: ThreadWorker()
+, m_workdir{workdir}
+, m_collapsed{collapsed}
+, m_monitor{monitor}
+{
+}
+
+void
+StatusWatchWorker::detach()
+{
+    m_monitor = nullptr;    // as we are called from main thread this is safe
+    m_cancel = true;
+}
+
+void
+StatusWatchWorker::cancel()
+{
+    m_cancel = true;
+}
+
+size_t
+StatusWatchWorker::doInBackground()
+{
+    // this is called from thread context, so use a repository of our own
+    Repository repository(m_workdir);
+    size_t count{0};
+    std::vector<std::string> dirs{""};
+    auto batch = std::make_shared<std::vector<std::string>>();
+    batch->reserve(BATCH_SIZE);
+    while (!dirs.empty() && !m_cancel) {
+        auto dir = dirs.back();
+        dirs.pop_back();
+        batch->push_back(dir);
+        ++count;
+        if (batch->size() >= BATCH_SIZE) {
+            notify(batch);
+            batch = std::make_shared<std::vector<std::string>>();
+            batch->reserve(BATCH_SIZE);
+        }
+        auto full = m_workdir + dir;
+        DIR* dirp = opendir(full.c_str());
+        if (!dirp) {
+            continue;
+        }
+        struct dirent* ent;
+        while ((ent = readdir(dirp)) != nullptr) {
+            if (std::strcmp(ent->d_name, ".") == 0
+             || std::strcmp(ent->d_name, "..") == 0
+             || (dir.empty() && std::strcmp(ent->d_name, ".git") == 0)) {
+                continue;
+            }
+            bool isDir = ent->d_type == DT_DIR;
+            if (ent->d_type == DT_UNKNOWN) {
+                struct stat st;
+                isDir = fstatat(dirfd(dirp), ent->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0
+                     && S_ISDIR(st.st_mode);
+            }
+            if (!isDir) {
+                continue;
+            }
+            auto child = dir.empty()
+                         ? std::string(ent->d_name)
+                         : dir + "/" + ent->d_name;
+            // collapsed untracked or ignored directories are not looked into by git
+            if (m_collapsed.contains(child + "/")) {
+                continue;
+            }
+            try {
+                if (repository.isIgnored(child)) {
+                    continue;
+                }
+            }
+            catch (const GitException& ex) {
+                std::cout << "StatusWatchWorker::doInBackground " << ex.what() << std::endl;
+            }
+            dirs.push_back(child);
+        }
+        closedir(dirp);
+    }
+    if (!batch->empty() && !m_cancel) {
+        notify(batch);
+    }
+    return count;
+}
+
+void
+StatusWatchWorker::process(const std::vector<StatusWatchBatch>& batches)
+{
+    // here we are back to main thread ...
+    for (auto& batch : batches) {
+        if (!m_monitor) {
+            return;
+        }
+        m_monitor->addWatchBatch(*batch);
+    }
+}
+
+void
+StatusWatchWorker::done()
+{
+    std::string msg;
+    try {
+        getResult();
+    }
+    catch (const std::exception& exc) {
+        msg = exc.what();
+    }
+    if (m_monitor) {
+        m_monitor->watchDone(msg);
+    }
+}
+
+StatusMonitor::StatusMonitor(const std::string& workdir, const StatusOptions& options)
+: m_repository{RepositoryCache::get(workdir)}
+, m_options{options}
+{
+    if (!m_repository) {
+        throw GitException("No repository for " + workdir);
+    }
+    m_workdir = m_repository->getWorkdir();
+    m_gitDir = m_repository->getGitDir();
+}
+
+StatusMonitor::~StatusMonitor()
+{
+    stop();
+}
+
+void
+StatusMonitor::setListener(StatusMonitorListener* listener)
+{
+    m_listener = listener;
+}
+
+void
+StatusMonitor::put(const std::string& path, const File& file)
+{
+    m_status.insert_or_assign(path, file);
+}
+
+void
+StatusMonitor::clear()
+{
+    m_status.clear();
+    m_pending.clear();
+    m_statusRunning = true;     // until start
+}
+
+const std::map<std::string, File>&
+StatusMonitor::getStatus()
+{
+    return m_status;
+}
+
+void
+StatusMonitor::start()
+{
+    rememberIndex();
+    m_statusRunning = false;
+    if (m_fd >= 0) {
+        return;     // restarted after reset, the watches are kept
+    }
+    m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_fd < 0) {
+        degrade(std::strerror(errno));
+        return;
+    }
+    // git replaces the index by renaming index.lock
+    m_gitWd = inotify_add_watch(m_fd, m_gitDir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE);
+    m_ioConnection = Glib::signal_io().connect(
+            sigc::mem_fun(*this, &StatusMonitor::onInotify), m_fd, Glib::IO_IN);
+    std::set<std::string> collapsed;
+    for (auto& entry : m_status) {
+        if (entry.first.ends_with("/")) {
+            collapsed.insert(entry.first);
+        }
+    }
+    m_watchWorker = std::make_shared<StatusWatchWorker>(m_workdir, collapsed, this);
+    m_watchWorker->execute();
+}
+
+void
+StatusMonitor::addWatchBatch(const std::vector<std::string>& dirs)
+{
+    for (auto& dir : dirs) {
+        if (!addWatch(dir)) {
+            break;
+        }
+    }
+}
+
+void
+StatusMonitor::watchDone(const std::string& msg)
+{
+    m_watchWorker.reset();
+    if (!msg.empty()) {
+        degrade(msg);
+    }
+}
+
+void
+StatusMonitor::stop()
+{
+    if (m_watchWorker) {
+        m_watchWorker->detach();
+        m_watchWorker.reset();
+    }
+    m_ioConnection.disconnect();
+    m_settleConnection.disconnect();
+    m_pollConnection.disconnect();
+    if (m_fd >= 0) {
+        ::close(m_fd);  // removes all watches
+        m_fd = -1;
+    }
+    m_gitWd = -1;
+    m_watches.clear();
+}
+
+void
+StatusMonitor::degrade(const std::string& reason)
+{
+    if (m_pollConnection.connected()) {
+        return;     // reported before
+    }
+    std::cout << "StatusMonitor::degrade " << reason << std::endl;
+    if (m_watchWorker) {
+        m_watchWorker->cancel();    // the watches we got are kept
+    }
+    m_pollConnection = Glib::signal_timeout().connect_seconds(
+            sigc::mem_fun(*this, &StatusMonitor::onPoll), POLL_S);
+    if (m_listener) {
+        m_listener->statusDegraded(reason);
+    }
+}
+
+bool
+StatusMonitor::onPoll()
+{
+    m_resetPending = true;
+    refresh();
+    return true;
+}
+
+bool
+StatusMonitor::addWatch(const std::string& dir)
+{
+    if (m_fd < 0) {
+        return false;
+    }
+    auto full = m_workdir + dir;
+    int wd = inotify_add_watch(m_fd, full.c_str(), WATCH_MASK | IN_ONLYDIR);
+    if (wd < 0) {
+        if (errno == ENOENT
+         || errno == ENOTDIR) {
+            return true;    // removed meanwhile, this is reported by the parent
+        }
+        // most likely max_user_watches reached, changes below are no longer seen
+        degrade(full + " " + std::strerror(errno));
+        return false;
+    }
+    m_watches.insert_or_assign(wd, dir);
+    return true;
+}
+
+void
+StatusMonitor::addWatches(const std::string& dir)
+{
+    if (!addWatch(dir)) {
+        return;
+    }
+    auto full = m_workdir + dir;
+    DIR* dirp = opendir(full.c_str());
+    if (!dirp) {
+        return;
+    }
+    struct dirent* ent;
+    while ((ent = readdir(dirp)) != nullptr) {
+        if (std::strcmp(ent->d_name, ".") == 0
+         || std::strcmp(ent->d_name, "..") == 0
+         || (dir.empty() && std::strcmp(ent->d_name, ".git") == 0)) {
+            continue;
+        }
+        auto child = dir.empty()
+                     ? std::string(ent->d_name)
+                     : dir + "/" + ent->d_name;
+        bool isDir = ent->d_type == DT_DIR;
+        if (ent->d_type == DT_UNKNOWN) {
+            struct stat st;
+            isDir = fstatat(dirfd(dirp), ent->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0
+                 && S_ISDIR(st.st_mode);
+        }
+        if (!isDir) {
+            if (m_pending.contains(dir + "/")) {
+                addPending(child);  // a new directory, report the content
+            }
+            continue;
+        }
+        // collapsed untracked or ignored directories are not looked into by git
+        if (m_status.contains(child + "/")) {
+            continue;
+        }
+        try {
+            if (m_repository->isIgnored(child)) {
+                continue;
+            }
+        }
+        catch (const GitException& ex) {
+            std::cout << "StatusMonitor::addWatches " << ex.what() << std::endl;
+        }
+        if (m_pending.contains(dir + "/")) {
+            addPending(child + "/");
+        }
+        addWatches(child);
+    }
+    closedir(dirp);
+}
+
+void
+StatusMonitor::removeWatches(const std::string& dir)
+{
+    auto prefix = dir + "/";
+    for (auto iter = m_watches.begin(); iter != m_watches.end(); ) {
+        if (iter->second == dir
+         || iter->second.starts_with(prefix)) {
+            inotify_rm_watch(m_fd, iter->first);
+            iter = m_watches.erase(iter);
+        }
+        else {
+            ++iter;
+        }
+    }
+}
+
+std::string
+StatusMonitor::getPath(int wd, const char* name)
+{
+    auto entry = m_watches.find(wd);
+    if (entry == m_watches.end()) {
+        return std::string();
+    }
+    if (entry->second.empty()) {
+        return std::string(name);
+    }
+    return entry->second + "/" + name;
+}
+
+void
+StatusMonitor::addPending(const std::string& path)
+{
+    m_pending.insert(path);
+}
+
+bool
+StatusMonitor::onInotify(Glib::IOCondition condition)
+{
+    alignas(struct inotify_event) char buf[16u*1024u];
+    while (true) {
+        auto len = read(m_fd, buf, sizeof(buf));
+        if (len <= 0) {
+            break;  // EAGAIN, all read
+        }
+        for (char* ptr = buf; ptr < buf + len; ) {
+            auto event = reinterpret_cast<const struct inotify_event*>(ptr);
+            ptr += sizeof(struct inotify_event) + event->len;
+            if (event->mask & IN_Q_OVERFLOW) {
+                m_resetPending = true;
+                continue;
+            }
+            if (event->wd == m_gitWd) {
+                if (event->len > 0) {
+                    std::string name{event->name};
+                    // the full status running writes the index (updateIndex), it is remembered on start
+                    if ((name == "index" && !m_statusRunning && isIndexChanged())
+                     || name == "HEAD") {
+                        m_resetPending = true;
+                    }
+                }
+                continue;
+            }
+            if (event->mask & IN_IGNORED) {
+                m_watches.erase(event->wd);
+                continue;
+            }
+            if (event->len == 0) {
+                continue;   // the watched dir itself
+            }
+            auto path = getPath(event->wd, event->name);
+            if (path.empty()) {
+                continue;
+            }
+            if (std::strcmp(event->name, GIT_IGNORE) == 0) {
+                m_resetPending = true;
+                continue;
+            }
+            if (event->mask & IN_ISDIR) {
+                if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                    addPending(path + "/");
+                    addWatches(path);
+                }
+                else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                    removeWatches(path);
+                    auto prefix = path + "/";
+                    for (auto& entry : m_status) {
+                        if (entry.first.starts_with(prefix)) {
+                            addPending(entry.first);
+                        }
+                    }
+                }
+            }
+            else {
+                addPending(path);
+            }
+        }
+    }
+    if ((m_resetPending || !m_pending.empty())
+      && !m_settleConnection.connected()) {
+        // wait for the writes to settle, a save is often a sequence of events
+        m_settleConnection = Glib::signal_timeout().connect(
+                sigc::mem_fun(*this, &StatusMonitor::onSettle), SETTLE_MS);
+    }
+    return true;
+}
+
+bool
+StatusMonitor::onSettle()
+{
+    refresh();
+    return false;
+}
+
+void
+StatusMonitor::refresh()
+{
+    m_settleConnection.disconnect();
+    if (m_resetPending) {
+        m_resetPending = false;
+        m_pending.clear();
+        rememberIndex();
+        if (m_listener) {
+            m_listener->statusReset();
+        }
+        return;
+    }
+    std::set<std::string> pending;
+    pending.swap(m_pending);
+    for (auto& path : pending) {
+        updatePath(path);
+    }
+}
+
+bool
+StatusMonitor::isSelected(const std::string& path)
+{
+    if (m_options.pathspec.empty()) {
+        return true;
+    }
+    for (auto& spec : m_options.pathspec) {
+        if (path == spec
+         || (path.starts_with(spec)
+          && (spec.ends_with("/") || path[spec.length()] == '/'))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool
+StatusMonitor::isReported(File& file)
+{
+    switch (file.getWorkdir().getStatus()) {
+    case FileStatus::New:
+        return m_options.untracked != UntrackedMode::None;
+    case FileStatus::Ignore:
+        return m_options.ignored;
+    case FileStatus::Current:
+        return m_options.unmodified;
+    default:
+        return true;
+    }
+}
+
+void
+StatusMonitor::updatePath(const std::string& path)
+{
+    if (!isSelected(path)) {
+        return;
+    }
+    if (path.ends_with("/")) {
+        // directory entries are only kept to know what not to look into
+        struct stat st;
+        auto full = m_workdir + path;
+        if (stat(full.c_str(), &st) != 0
+         && m_status.erase(path) > 0
+         && m_listener) {
+            m_listener->statusRemoved(path);
+        }
+        return;
+    }
+    File file;
+    bool known{false};
+    try {
+        known = m_repository->getFileStatus(path, file);
+    }
+    catch (const GitException& ex) {
+        std::cout << "StatusMonitor::updatePath " << ex.what() << std::endl;
+        return;
+    }
+    if (known && isReported(file)) {
+        auto entry = m_status.insert_or_assign(path, file).first;
+        if (m_listener) {
+            m_listener->statusChanged(path, entry->second);
+        }
+    }
+    else if (m_status.erase(path) > 0
+          && m_listener) {
+        m_listener->statusRemoved(path);
+    }
+}
+
+void
+StatusMonitor::rememberIndex()
+{
+    struct stat st;
+    auto index = m_gitDir + "index";
+    if (stat(index.c_str(), &st) == 0) {
+        m_indexModified = st.st_mtim;
+        m_indexSize = st.st_size;
+    }
+}
+
+bool
+StatusMonitor::isIndexChanged()
+{
+    // a status query may write the index with the same content
+    struct stat st;
+    auto index = m_gitDir + "index";
+    if (stat(index.c_str(), &st) != 0) {
+        return true;
+    }
+    return st.st_size != m_indexSize
+        || st.st_mtim.tv_sec != m_indexModified.tv_sec
+        || st.st_mtim.tv_nsec != m_indexModified.tv_nsec;
+}
+
+} /* namespace git */
+} /* namespace psc */
@@ -0,0 +1,161 @@
+/* -*- Mode: c++; c-basic-offset: 4; tab-width: 4; coding: utf-8; -*-  */
+/*
+ * Copyright (C) 2025 RPf
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include <glibmm.h>
+
+#include "ThreadWorker.hpp"
+#include "GitRepository.hpp"
+
+namespace psc {
+namespace git {
+
+class StatusMonitorListener
+{
+public:
+    virtual ~StatusMonitorListener() = default;
+
+    virtual void statusChanged(const std::string& path, File& file) = 0;
+    virtual void statusRemoved(const std::string& path) = 0;
+    // index, HEAD or ignore rules changed, a full status is required
+    virtual void statusReset() = 0;
+    // not all directories can be watched (e.g. max_user_watches),
+    //   the full status is repeated periodically instead
+    virtual void statusDegraded(const std::string& reason) = 0;
+};
+
+class StatusMonitor;
+
+using StatusWatchBatch = std::shared_ptr<std::vector<std::string>>;
+
+/**
+ * find the directories to watch in background,
+ *   as walking a large working tree takes too long for the main thread.
+ */
+class StatusWatchWorker
+: public ThreadWorker<StatusWatchBatch, size_t>
+{
+public:
+    StatusWatchWorker(const std::string& workdir
+                    , const std::set<std::string>& collapsed
+                    , StatusMonitor* monitor);
+    explicit StatusWatchWorker(const StatusWatchWorker& orig) = delete;
+    virtual ~StatusWatchWorker() = default;
+
+    // stops as soon as possible and no longer reports to monitor
+    void detach();
+    void cancel();
+    static constexpr size_t BATCH_SIZE{256u};
+protected:
+    size_t doInBackground() override;
+    void process(const std::vector<StatusWatchBatch>& batches) override;
+    void done() override;
+
+private:
+    std::string m_workdir;
+    std::set<std::string> m_collapsed;
+    StatusMonitor* m_monitor;
+    std::atomic<bool> m_cancel{false};
+};
+
+/**
+ * keep the status of a repository current,
+ *   the working tree is watched with inotify and
+ *   only the changed paths are evaluated again.
+ *   Seed it with the result of a full status (put),
+ *   then start watching.
+ *   Changes to .git/index, HEAD or a .gitignore
+ *   require a full status as they may affect any path.
+ *   Renames are not detected (as with the default StatusOptions),
+ *   collapsed directories (e.g. "build/") are not looked into,
+ *   but directories that appear while watching are reported by file.
+ *   If a directory can't be watched the full status is
+ *   repeated every POLL_S instead.
+ */
+class StatusMonitor
+{
+public:
+    StatusMonitor(const std::string& workdir, const StatusOptions& options);
+    explicit StatusMonitor(const StatusMonitor& orig) = delete;
+    virtual ~StatusMonitor();
+
+    void setListener(StatusMonitorListener* listener);
+    void put(const std::string& path, const File& file);
+    // before a full status, the index written by it is ignored until start
+    void clear();
+    // add the watches in background, the status has to be put before
+    void start();
+    void stop();
+    // evaluate the pending paths now (otherwise this happens after SETTLE_MS)
+    void refresh();
+    const std::map<std::string, File>& getStatus();
+    // from the StatusWatchWorker in main thread
+    void addWatchBatch(const std::vector<std::string>& dirs);
+    void watchDone(const std::string& msg);
+
+    static constexpr guint SETTLE_MS{200u};
+    static constexpr guint POLL_S{30u};     // the full status if degraded
+    static constexpr auto GIT_IGNORE{".gitignore"};
+protected:
+    bool onInotify(Glib::IOCondition condition);
+    bool onSettle();
+    bool onPoll();
+    // if not all changes can be watched
+    void degrade(const std::string& reason);
+    bool addWatch(const std::string& dir);
+    void addWatches(const std::string& dir);
+    void removeWatches(const std::string& dir);
+    void addPending(const std::string& path);
+    void updatePath(const std::string& path);
+    bool isReported(File& file);
+    bool isSelected(const std::string& path);
+    bool isIndexChanged();
+    void rememberIndex();
+    std::string getPath(int wd, const char* name);
+
+private:
+    std::shared_ptr<Repository> m_repository;
+    StatusOptions m_options;
+    std::string m_workdir;
+    std::string m_gitDir;
+    std::map<std::string, File> m_status;
+    StatusMonitorListener* m_listener{nullptr};
+    int m_fd{-1};
+    int m_gitWd{-1};
+    std::map<int, std::string> m_watches;   // wd -> dir relative to workdir ("" for root)
+    std::set<std::string> m_pending;
+    bool m_resetPending{false};
+    bool m_statusRunning{false};
+    struct timespec m_indexModified{};
+    off_t m_indexSize{0};
+    sigc::connection m_ioConnection;
+    sigc::connection m_settleConnection;
+    sigc::connection m_pollConnection;
+    std::shared_ptr<StatusWatchWorker> m_watchWorker;
+};
+
+} /* namespace git */
+} /* namespace psc */
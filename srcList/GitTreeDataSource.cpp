@@ -0,0 +1,320 @@
+/* -*- Mode: c++; c-basic-offset: 4; tab-width: 4; coding: utf-8; -*-  */
+/*
+ * Copyright (C) 2025 RPf
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <sys/stat.h>
+#include <psc_i18n.hpp>
+#include <psc_format.hpp>
+
+#include "GitTreeDataSource.hpp"
+#include "VarselList.hpp"
+
+std::map<std::string, PtrTreeEntries> GitTreeDataSource::m_trees;
+
+GitObjectNode::GitObjectNode(GitTreeDataSource* gitTreeDataSource, const git_oid& tree, const Glib::ustring& name, unsigned long depth)
+: GitTreeNode::GitTreeNode(name, depth)
+, m_gitTreeDataSource{gitTreeDataSource}
+, m_tree{tree}
+{
+}
+
+Glib::RefPtr<Gtk::ListStore>
+GitObjectNode::getEntries()
+{
+    load();
+    return GitTreeNode::getEntries();
+}
+
+void
+GitObjectNode::load()
+{
+    if (!m_loaded) {
+        m_loaded = true;
+        m_gitTreeDataSource->loadTree(this, m_tree);
+    }
+}
+
+GitTreeDataSource::GitTreeDataSource(ListApp* application, const Glib::ustring& revision)
+: FileDataSource(application)
+, m_revision{revision}
+{
+}
+
+void
+GitTreeDataSource::update(
+          const Glib::RefPtr<Gio::File>& dir
+        , std::shared_ptr<psc::ui::TreeNode> treeNode
+        , const Glib::RefPtr<psc::ui::TreeNodeModel>& treeModel
+        , ListListener* listListener)
+{
+    if (treeNode) {
+        return;     // a revision does not change
+    }
+    m_dir = dir;
+    m_treeModel = treeModel;
+    m_listListener = listListener;
+    m_blobs.clear();
+    try {
+        m_repository = psc::git::RepositoryCache::get(dir->get_path());
+        if (!m_repository) {
+            throw psc::git::GitException("No repository for " + dir->get_path());
+        }
+        auto tree = m_repository->resolveTree(m_revision);
+        auto root = std::make_shared<GitObjectNode>(this, tree, m_revision, 1);
+        treeModel->append(root);
+        root->load();
+    }
+    catch (const psc::git::GitException& ex) {
+        std::cout << "Error " << ex.what() << " reading " << m_revision << " " << dir->get_path() << std::endl;
+        if (listListener) {
+            listListener->listDone(Severity::Error, ex.what());
+        }
+    }
+}
+
+PtrTreeEntries
+GitTreeDataSource::getTree(const git_oid& tree)
+{
+    // trees are identified by content, so the cache is valid for any repository
+    std::string id{git_oid_tostr_s(&tree)};
+    auto entry = m_trees.find(id);
+    if (entry != m_trees.end()) {
+        return entry->second;
+    }
+    auto entries = std::make_shared<std::vector<psc::git::TreeEntry>>(m_repository->getTreeEntries(tree));
+    if (m_trees.size() >= TREE_CACHE_SIZE) {
+        m_trees.erase(m_trees.begin());
+    }
+    m_trees.insert(std::pair(id, entries));
+    return entries;
+}
+
+void
+GitTreeDataSource::loadTree(GitObjectNode* node, const git_oid& tree)
+{
+    if (!m_repository) {
+        return;
+    }
+    PtrTreeEntries entries;
+    try {
+        entries = getTree(tree);
+    }
+    catch (const psc::git::GitException& ex) {
+        std::cout << "Error " << ex.what() << " reading tree " << node->getRepoPath() << std::endl;
+        return;
+    }
+    auto gitListColumns = std::dynamic_pointer_cast<GitListColumns>(getListColumns());
+    for (auto& entry : *entries) {
+        if (entry.type == GIT_OBJECT_TREE) {
+            auto child = std::make_shared<GitObjectNode>(this, entry.oid, entry.name, node->getDepth() + 1);
+            node->addChild(child);
+            if (m_treeModel) {
+                m_treeModel->memory_row_inserted(child); // notify as the model is attached
+            }
+            if (m_listListener) {
+                m_listListener->nodeAdded(child);
+            }
+        }
+        else if (entry.type == GIT_OBJECT_BLOB) {
+            auto iter = node->appendList();
+            auto row = *iter;
+            row.set_value<psc::git::FileStatus>(gitListColumns->m_workdirState, psc::git::FileStatus::None);
+            row.set_value<psc::git::FileStatus>(gitListColumns->m_indexState, psc::git::FileStatus::None);
+            row.set_value<Glib::ustring>(gitListColumns->m_name, entry.name);
+            row.set_value(gitListColumns->m_mode, entry.mode & 07777u);
+            bool isLink = (entry.mode & S_IFMT) == S_IFLNK;
+            row.set_value(gitListColumns->m_type, readableFileType(isLink
+                                                                   ? Gio::FileType::FILE_TYPE_SYMBOLIC_LINK
+                                                                   : Gio::FileType::FILE_TYPE_REGULAR));
+            bool uncertain{false};
+            auto contentType = Gio::content_type_guess(entry.name, nullptr, 0, uncertain);
+            row.set_value(gitListColumns->m_contentType, Glib::ustring(contentType));
+            auto icon = m_icons.find(contentType);
+            if (icon == m_icons.end()) {
+                auto contentIcon = Glib::RefPtr<Glib::Object>::cast_dynamic(
+                                    Gio::content_type_get_symbolic_icon(contentType));
+                icon = m_icons.insert(std::pair(contentType, contentIcon)).first;
+            }
+            if (icon->second) {
+                row.set_value(gitListColumns->m_icon, icon->second);
+            }
+            // not the working tree file, the blob is written there when used
+            auto file = getBlobFile(entry);
+            row.set_value(gitListColumns->m_file, file);
+            m_blobs.insert_or_assign(file->get_path(), entry);
+        }
+        // submodules (commits) are not part of this repository
+    }
+}
+
+Glib::RefPtr<Gio::File>
+GitTreeDataSource::getBlobFile(const psc::git::TreeEntry& entry)
+{
+    // by id, as blobs do not change
+    return Gio::File::create_for_path(
+            Glib::build_filename(Glib::get_tmp_dir()
+                               , TMP_DIR
+                               , std::string(git_oid_tostr_s(&entry.oid))
+                               , entry.name));
+}
+
+void
+GitTreeDataSource::writeBlob(const psc::git::TreeEntry& entry, const Glib::RefPtr<Gio::File>& file)
+{
+    auto parent = file->get_parent();
+    if (!parent->query_exists()) {
+        parent->make_directory_with_parents();
+    }
+    auto content = m_repository->readBlob(entry.oid);
+    if ((entry.mode & S_IFMT) == S_IFLNK) {
+        if (file->query_exists()) {
+            file->remove();
+        }
+        file->make_symbolic_link(content);
+        return;
+    }
+    Glib::file_set_contents(file->get_path(), content);
+    // git keeps the executable bit
+    file->set_attribute_uint32("unix::mode"
+                             , (entry.mode & 0111u) != 0u ? 0755u : 0644u
+                             , Gio::FileQueryInfoFlags::FILE_QUERY_INFO_NONE);
+}
+
+void
+GitTreeDataSource::distribute(const std::vector<PtrEventItem>& items, Gtk::Menu* menu, Gtk::Window* win)
+{
+    // the applications need a file, so the selection is written to the temp dir
+    std::vector<PtrEventItem> tmpItems;
+    for (auto& item : items) {
+        if (tmpItems.size() >= OPEN_LIMIT) {
+            break;
+        }
+        auto blob = m_blobs.find(item->getFile()->get_path());
+        if (blob == m_blobs.end()) {
+            continue;
+        }
+        auto tmpFile = item->getFile();
+        try {
+            if (!tmpFile->query_exists()) {     // blobs do not change
+                writeBlob(blob->second, tmpFile);
+            }
+            tmpItems.emplace_back(std::make_shared<EventItem>(tmpFile));
+        }
+        catch (const Glib::Error& ex) {
+            std::cout << "Error " << ex.what() << " writing " << tmpFile->get_path() << std::endl;
+        }
+        catch (const psc::git::GitException& ex) {
+            std::cout << "Error " << ex.what() << " reading " << blob->second.name << std::endl;
+        }
+    }
+    if (!tmpItems.empty()) {
+        m_application->getEventBus()->distribute(tmpItems, menu);
+    }
+    auto menuItem = Gtk::make_managed<Gtk::MenuItem>(_("Extract..."));
+    menu->append(*menuItem);
+    menuItem->signal_activate().connect(
+        sigc::bind(
+            sigc::mem_fun(*this, &GitTreeDataSource::extract)
+        , items, win));
+}
+
+void
+GitTreeDataSource::extract(const std::vector<PtrEventItem>& items, Gtk::Window* win)
+{
+    Gtk::FileChooserDialog dirChooser(*win
+                                    , _("Extract to")
+                                    , Gtk::FileChooserAction::FILE_CHOOSER_ACTION_SELECT_FOLDER
+                                    , Gtk::DIALOG_MODAL | Gtk::DIALOG_DESTROY_WITH_PARENT);
+    dirChooser.add_button(_("_Cancel"), Gtk::RESPONSE_CANCEL);
+    dirChooser.add_button(_("_Extract"), Gtk::RESPONSE_ACCEPT);
+    if (dirChooser.run() != Gtk::RESPONSE_ACCEPT) {
+        return;
+    }
+    auto dir = dirChooser.get_file();
+    dirChooser.hide();
+    Glib::ustring errors;
+    for (auto& item : items) {
+        auto blob = m_blobs.find(item->getFile()->get_path());
+        if (blob == m_blobs.end()) {
+            continue;
+        }
+        auto file = dir->get_child(blob->second.name);
+        try {
+            writeBlob(blob->second, file);
+        }
+        catch (const Glib::Error& ex) {
+            errors += ex.what() + "\n";
+        }
+        catch (const psc::git::GitException& ex) {
+            errors += Glib::ustring(ex.what()) + "\n";
+        }
+    }
+    auto varselList = dynamic_cast<VarselList*>(win);
+    if (!errors.empty() && varselList) {
+        varselList->showMessage(errors, Gtk::MessageType::MESSAGE_WARNING);
+    }
+}
+
+Glib::ustring
+GitTreeDataSource::selectRevision(const Glib::RefPtr<Gio::File>& dir, Gtk::Window* win)
+{
+    Gtk::Dialog dialog(_("Browse revision"), *win, true);
+    Gtk::ComboBoxText revisions(true);
+    try {
+        psc::git::Repository repository(dir->get_path());
+        for (auto& name : repository.getReferenceNames()) {
+            revisions.append(name);
+        }
+    }
+    catch (const psc::git::GitException& ex) {
+        std::cout << "Error " << ex.what() << " listing references " << dir->get_path() << std::endl;
+    }
+    revisions.get_entry()->set_text("HEAD");
+    revisions.get_entry()->set_activates_default(true);
+    dialog.get_content_area()->pack_start(revisions, Gtk::PACK_SHRINK);
+    dialog.add_button(_("_Cancel"), Gtk::RESPONSE_CANCEL);
+    dialog.add_button(_("_Browse"), Gtk::RESPONSE_OK);
+    dialog.set_default_response(Gtk::RESPONSE_OK);
+    dialog.show_all();
+    if (dialog.run() != Gtk::RESPONSE_OK) {
+        return Glib::ustring();
+    }
+    return revisions.get_entry_text();
+}
+
+const char*
+GitTreeDataSource::getConfigGroup()
+{
+    return "GitTree";
+}
+
+std::shared_ptr<ListColumns>
+GitTreeDataSource::getListColumns()
+{
+    return GitTreeNode::getListColumns();
+}
+
+void
+GitTreeDataSource::paste(
+          const std::vector<Glib::ustring>& uris
+        , const Glib::RefPtr<Gio::File>& dir
+        , bool isMove
+        , VarselList* win)
+{
+    // a revision is not changed by pasting
+}
@@ -0,0 +1,101 @@
+/* -*- Mode: c++; c-basic-offset: 4; tab-width: 4; coding: utf-8; -*-  */
+/*
+ * Copyright (C) 2025 RPf
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <map>
+#include <vector>
+
+#include "FileDataSource.hpp"
+#include "GitDataSource.hpp"
+#include "GitRepository.hpp"
+
+class GitTreeDataSource;
+
+// a directory of a revision, the tree object is read on first use
+class GitObjectNode
+: public GitTreeNode
+{
+public:
+    GitObjectNode(GitTreeDataSource* gitTreeDataSource, const git_oid& tree, const Glib::ustring& name, unsigned long depth);
+    virtual ~GitObjectNode() = default;
+
+    Glib::RefPtr<Gtk::ListStore> getEntries() override;
+    void load();
+private:
+    GitTreeDataSource* m_gitTreeDataSource;
+    git_oid m_tree;
+    bool m_loaded{false};
+};
+
+using PtrTreeEntries = std::shared_ptr<std::vector<psc::git::TreeEntry>>;
+
+/**
+ * show the files of any revision from the object database,
+ *   the working tree is not used, the directories are read
+ *   when selected and blobs are only read to open or extract them.
+ *   Trees are cached by id as unchanged directories
+ *   share the same tree object between revisions.
+ */
+class GitTreeDataSource
+: public FileDataSource
+{
+public:
+    GitTreeDataSource(ListApp* application, const Glib::ustring& revision);
+    explicit GitTreeDataSource(const GitTreeDataSource& orig) = delete;
+    virtual ~GitTreeDataSource() = default;
+
+    void update(
+          const Glib::RefPtr<Gio::File>& dir
+        , std::shared_ptr<psc::ui::TreeNode> treeItem
+        , const Glib::RefPtr<psc::ui::TreeNodeModel>& treeModel
+        , ListListener* listListener) override;
+    const char* getConfigGroup() override;
+    std::shared_ptr<ListColumns> getListColumns() override;
+    void paste(
+          const std::vector<Glib::ustring>& uris
+        , const Glib::RefPtr<Gio::File>& dir
+        , bool isMove
+        , VarselList* win) override;
+    void distribute(const std::vector<PtrEventItem>& items, Gtk::Menu* menu, Gtk::Window* win) override;
+
+    void loadTree(GitObjectNode* node, const git_oid& tree);
+    // ask for a branch, tag or commit, empty if canceled
+    static Glib::ustring selectRevision(const Glib::RefPtr<Gio::File>& dir, Gtk::Window* win);
+
+    static constexpr size_t TREE_CACHE_SIZE{4096u};
+    static constexpr auto TMP_DIR{"varsel-git"};
+    static constexpr size_t OPEN_LIMIT{32u};  // blobs written to open a selection
+protected:
+    PtrTreeEntries getTree(const git_oid& tree);
+    // the file in the temp dir, that is used for the row
+    Glib::RefPtr<Gio::File> getBlobFile(const psc::git::TreeEntry& entry);
+    // symlinks are created as such, blobs as regular files (keeping the executable bit)
+    void writeBlob(const psc::git::TreeEntry& entry, const Glib::RefPtr<Gio::File>& file);
+    void extract(const std::vector<PtrEventItem>& items, Gtk::Window* win);
+
+private:
+    Glib::ustring m_revision;
+    Glib::RefPtr<Gio::File> m_dir;
+    std::shared_ptr<psc::git::Repository> m_repository;
+    Glib::RefPtr<psc::ui::TreeNodeModel> m_treeModel;
+    ListListener* m_listListener{nullptr};
+    std::map<std::string, psc::git::TreeEntry> m_blobs;     // row path -> blob
+    std::map<Glib::ustring, Glib::RefPtr<Glib::Object>> m_icons;
+    static std::map<std::string, PtrTreeEntries> m_trees;
+};
@@ -0,0 +1,259 @@
+/* -*- Mode: c++; c-basic-offset: 4; tab-width: 4; coding: utf-8; -*-  */
+/*
+ * Copyright (C) 2025 RPf
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "IoScheduler.hpp"
+
+#ifdef __linux__
+// as in linux/ioprio.h, that is not available everywhere
+static constexpr int IOPRIO_WHO_PROCESS{1};
+static constexpr int IOPRIO_CLASS_SHIFT{13};
+static constexpr int IOPRIO_CLASS_NONE{0};
+static constexpr int IOPRIO_CLASS_BE{2};
+static constexpr int IOPRIO_CLASS_IDLE{3};
+static constexpr int IOPRIO_BE_LOWEST{7};
+#endif
+
+std::shared_ptr<IoScheduler> IoScheduler::m_instance;
+
+std::shared_ptr<IoScheduler>
+IoScheduler::get()
+{
+    if (!m_instance) {      // created from main thread by the dialogs
+        m_instance = std::make_shared<IoScheduler>();
+    }
+    return m_instance;
+}
+
+void
+IoScheduler::setPriority(IoPriority priority)
+{
+    m_priority = priority;
+    ++m_priorityChanges;    // the workers apply it with the next acquire
+}
+
+IoPriority
+IoScheduler::getPriority()
+{
+    return m_priority;
+}
+
+void
+IoScheduler::setLimit(goffset limit)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_limit = std::max(limit, static_cast<goffset>(0));
+    m_rate = static_cast<double>(m_limit);
+    m_tokens = 0.0;
+    m_lastRefill = g_get_monotonic_time();
+}
+
+goffset
+IoScheduler::getLimit()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_limit;
+}
+
+void
+IoScheduler::setYield(bool yield)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_yield = yield;
+    if (!m_yield) {
+        m_rate = static_cast<double>(m_limit);
+    }
+    m_lastPressure = 0;
+    m_acquired = 0;
+}
+
+bool
+IoScheduler::isYield()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_yield;
+}
+
+void
+IoScheduler::applyPriority()
+{
+#   ifdef __linux__
+    // the priority is set for each thread
+    thread_local unsigned int applied{0};
+    unsigned int changes = m_priorityChanges;
+    if (applied == changes) {
+        return;
+    }
+    applied = changes;
+    int value{IOPRIO_CLASS_NONE << IOPRIO_CLASS_SHIFT};     // as the cpu nice
+    switch (m_priority) {
+    case IoPriority::Low:
+        value = (IOPRIO_CLASS_BE << IOPRIO_CLASS_SHIFT) | IOPRIO_BE_LOWEST;
+        break;
+    case IoPriority::Idle:
+        value = IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT;
+        break;
+    default:
+        break;
+    }
+    if (syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, value) != 0) {
+        std::cout << "IoScheduler::applyPriority error " << errno << std::endl;
+    }
+#   endif
+}
+
+void
+IoScheduler::refill(gint64 now)
+{
+    if (m_lastRefill > 0) {
+        m_tokens += static_cast<double>(now - m_lastRefill) * m_rate / 1.0e6;
+        m_tokens = std::min(m_tokens, m_rate * static_cast<double>(BURST_US) / 1.0e6);
+    }
+    m_lastRefill = now;
+}
+
+void
+IoScheduler::checkPressure(gint64 now)
+{
+    if (m_lastPressure == 0) {
+        m_lastPressure = now;
+        return;
+    }
+    if (now - m_lastPressure < PRESSURE_INTERVAL_US) {
+        return;
+    }
+    auto throughput = static_cast<double>(m_acquired) * 1.0e6 / static_cast<double>(now - m_lastPressure);
+    m_acquired = 0;
+    m_lastPressure = now;
+    auto pressure = readPressure();
+    if (pressure < 0.0) {
+        return;
+    }
+    if (pressure > PRESSURE_HIGH) {
+        // back off from what we use now
+        auto base = m_rate > 0.0 ? m_rate : throughput;
+        m_rate = std::max(base / 2.0, MIN_RATE);
+        refill(now);
+    }
+    else if (pressure < PRESSURE_LOW
+          && m_rate > 0.0) {
+        auto limit = static_cast<double>(m_limit);
+        m_rate *= 1.25;
+        if (limit > 0.0
+         && m_rate >= limit) {
+            m_rate = limit;
+        }
+        else if (limit <= 0.0
+              && m_rate > 2.0 * throughput) {
+            m_rate = 0.0;   // the rate is no longer what limits us
+        }
+    }
+}
+
+double
+IoScheduler::readPressure()
+{
+#   ifdef __linux__
+    // "some avg10=1.23 avg60=..."
+    std::ifstream pressure("/proc/pressure/io");
+    std::string line;
+    double avg10{-1.0};
+    if (std::getline(pressure, line)
+     && std::sscanf(line.c_str(), "some avg10=%lf", &avg10) == 1) {
+        return avg10;
+    }
+#   endif
+    return -1.0;
+}
+
+void
+IoScheduler::acquire(goffset bytes, const Glib::RefPtr<Gio::Cancellable>& cancellable)
+{
+    applyPriority();
+    gint64 waitUs{0};
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto now = g_get_monotonic_time();
+        m_acquired += bytes;
+        if (m_yield) {
+            checkPressure(now);
+        }
+        if (m_rate <= 0.0) {
+            return;
+        }
+        refill(now);
+        // the bytes are taken now, so the following wait for these as well
+        m_tokens -= static_cast<double>(bytes);
+        if (m_tokens < 0.0) {
+            waitUs = static_cast<gint64>(-m_tokens * 1.0e6 / m_rate);
+        }
+    }
+    auto end = g_get_monotonic_time() + waitUs;
+    while (waitUs > 0
+        && !(cancellable && cancellable->is_cancelled())) {
+        g_usleep(static_cast<gulong>(std::min(waitUs, WAIT_SLICE_US)));
+        waitUs = end - g_get_monotonic_time();
+    }
+}
+
+size_t
+IoScheduler::getChunk(size_t preferred)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_rate <= 0.0) {
+        return preferred;
+    }
+    // what the rate allows within a burst
+    auto chunk = static_cast<size_t>(m_rate * static_cast<double>(BURST_US) / 1.0e6);
+    return std::clamp(chunk, std::min(MIN_CHUNK, preferred), preferred);
+}
+
+void
+IoScheduler::connect(const Glib::RefPtr<Gtk::Builder>& builder)
+{
+    auto ioScheduler = get();
+    Gtk::ComboBoxText* priority;
+    builder->get_widget("ioPriority", priority);
+    priority->set_active(static_cast<int>(ioScheduler->getPriority()));
+    priority->signal_changed().connect([priority, ioScheduler] {
+        ioScheduler->setPriority(static_cast<IoPriority>(priority->get_active_row_number()));
+    });
+    Gtk::SpinButton* limit;
+    builder->get_widget("ioLimit", limit);
+    // shown as MiB/s
+    limit->set_value(static_cast<double>(ioScheduler->getLimit()) / (1024.0 * 1024.0));
+    limit->signal_value_changed().connect([limit, ioScheduler] {
+        ioScheduler->setLimit(static_cast<goffset>(limit->get_value() * 1024.0 * 1024.0));
+    });
+    Gtk::CheckButton* yield;
+    builder->get_widget("ioYield", yield);
+    yield->set_active(ioScheduler->isYield());
+    yield->signal_toggled().connect([yield, ioScheduler] {
+        ioScheduler->setYield(yield->get_active());
+    });
+}
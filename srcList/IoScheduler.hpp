@@ -0,0 +1,96 @@
+/* -*- Mode: c++; c-basic-offset: 4; tab-width: 4; coding: utf-8; -*-  */
+/*
+ * Copyright (C) 2025 RPf
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gtkmm.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+enum class IoPriority
+{
+      Normal
+    , Low       // best effort, lowest level
+    , Idle      // only if the disk is not used otherwise
+};
+
+/**
+ * shares the disks between the copies and extractions
+ *   and the other applications.
+ *   The workers acquire the bytes before reading or writing them,
+ *   a limit is kept by a token bucket, and the io priority
+ *   is set for each worker thread.
+ *   If yielding, the rate is reduced while the io pressure
+ *   (the share of time other tasks wait for io) is high.
+ */
+class IoScheduler
+{
+public:
+    IoScheduler() = default;
+    explicit IoScheduler(const IoScheduler& orig) = delete;
+    virtual ~IoScheduler() = default;
+
+    // the one used by all jobs of the process
+    static std::shared_ptr<IoScheduler> get();
+
+    void setPriority(IoPriority priority);
+    IoPriority getPriority();
+    // bytes per second, 0 for unlimited
+    void setLimit(goffset limit);
+    goffset getLimit();
+    void setYield(bool yield);
+    bool isYield();
+    // from worker thread, waits as long as the limit requires
+    void acquire(goffset bytes, const Glib::RefPtr<Gio::Cancellable>& cancellable = Glib::RefPtr<Gio::Cancellable>());
+    // the size to request at once, so a limited rate stays smooth
+    size_t getChunk(size_t preferred);
+    // use the io widgets of a dialog
+    static void connect(const Glib::RefPtr<Gtk::Builder>& builder);
+
+    static constexpr gint64 BURST_US{100000l};          // the tokens that may be collected
+    static constexpr gint64 WAIT_SLICE_US{100000l};     // check for cancel while waiting
+    static constexpr gint64 PRESSURE_INTERVAL_US{1000000l};
+    // the share of time in percent some task waited for io (avg10),
+    //   as our own waits are included these are generous
+    static constexpr double PRESSURE_HIGH{40.0};
+    static constexpr double PRESSURE_LOW{10.0};
+    static constexpr double MIN_RATE{1024.0 * 1024.0};
+    static constexpr size_t MIN_CHUNK{64u * 1024u};
+protected:
+    // to the calling thread if changed
+    void applyPriority();
+    // these are called with the lock held
+    void refill(gint64 now);
+    void checkPressure(gint64 now);
+    // -1 if unknown
+    static double readPressure();
+
+private:
+    static std::shared_ptr<IoScheduler> m_instance;
+    std::mutex m_mutex;
+    std::atomic<IoPriority> m_priority{IoPriority::Normal};
+    std::atomic<unsigned int> m_priorityChanges{0};
+    goffset m_limit{0};
+    bool m_yield{false};
+    double m_rate{0.0};         // the effective bytes per second, 0 unlimited
+    double m_tokens{0.0};       // negative for the bytes that have to wait
+    gint64 m_lastRefill{0};
+    gint64 m_lastPressure{0};
+    goffset m_acquired{0};      // since the last pressure check
+};
@@ -23,11 +23,15 @@
 #include <locale>
 #include <clocale>
 #include <git2.h>
+#include <gtksourceview/gtksource.h>
 #include <string_view>
 
 #include "varsel_config.h"
 #include "VarselList.hpp"
 #include "ListApp.hpp"
+#include "GitCloneDialog.hpp"
+#include "CopyManager.hpp"
+#include "CopyDialog.hpp"
 
 ListApp::ListApp(int argc, char **argv)
 : Gtk::Application(argc, argv, "de.pfeifer_syscon.va_list", Gio::ApplicationFlags::APPLICATION_HANDLES_OPEN | Gio::ApplicationFlags::APPLICATION_NON_UNIQUE)
@@ -176,16 +180,46 @@ ListApp::on_action_help() {
 }
 
 
+void
+ListApp::on_action_clone()
+{
+    auto win = get_active_window();
+    if (!win) {
+        return;
+    }
+    auto target = GitCloneDialog::clone(win);
+    if (target) {
+        auto varselList = VarselList::show(target->get_basename(), nullptr, this);
+        if (varselList) {
+            varselList->showFile(target);
+        }
+    }
+}
+
+void
+ListApp::on_action_copies()
+{
+    if (!m_varselList) {
+        return;
+    }
+    for (auto& copyTask : getCopyManager()->getTasks()) {
+        CopyDialog::show(copyTask, m_varselList);
+    }
+}
+
 void
 ListApp::on_startup()
 {
     Gtk::Application::on_startup();
 
 	git_libgit2_init();
+    gtk_source_init();  // used by diff view
 
     add_action("quit", sigc::mem_fun(*this, &ListApp::on_action_quit));
     add_action("about", sigc::mem_fun(*this, &ListApp::on_action_about));
     add_action("help", sigc::mem_fun(*this, &ListApp::on_action_help));
+    add_action("clone", sigc::mem_fun(*this, &ListApp::on_action_clone));
+    add_action("copies", sigc::mem_fun(*this, &ListApp::on_action_copies));
 
     auto builder = Gtk::Builder::create();
     try {
@@ -202,6 +236,13 @@ ListApp::on_startup()
     catch (const Glib::FileError& ex) {
         psc::log::Log::logAdd(psc::log::Level::Error, std::format("Unable to load app-menu {}", ex.what()));
     }
+    // when idle the window was opened
+    Glib::signal_idle().connect_once(
+        [this] {
+            if (getCopyManager()->resume() > 0) {
+                on_action_copies();
+            }
+        });
 }
 
 std::shared_ptr<EventBus>
@@ -213,6 +254,15 @@ ListApp::getEventBus()
     return m_eventBus;
 }
 
+std::shared_ptr<CopyManager>
+ListApp::getCopyManager()
+{
+    if (!m_copyManager) {
+        m_copyManager = std::make_shared<CopyManager>(this);
+    }
+    return m_copyManager;
+}
+
 int
 main(int argc, char** argv)
 {
@@ -25,6 +25,7 @@
 #include "EventBus.hpp"
 
 class VarselList;
+class CopyManager;
 
 /*
  * get the application up and running
@@ -41,6 +42,8 @@ public:
     void on_startup() override;
     void on_open(const Gio::Application::type_vec_files& files, const Glib::ustring& hint) override;
     std::shared_ptr<EventBus> getEventBus();
+    // the copies keep running if the dialog or window is closed
+    std::shared_ptr<CopyManager> getCopyManager();
 protected:
     VarselList* createVarselWindow();
     VarselList* getOrCreateVarselWindow();
@@ -50,9 +53,12 @@ private:
     std::string m_exec;
     std::string get_file(const std::string& name);
     std::shared_ptr<EventBus> m_eventBus;
+    std::shared_ptr<CopyManager> m_copyManager;
     void on_action_quit();
     void on_action_about();
     void on_action_help();
+    void on_action_clone();
+    void on_action_copies();
     std::shared_ptr<psc::log::Log> m_log;
 };
 
@@ -73,13 +73,20 @@ VarselList::VarselList(
 
 void
 VarselList::showFile(const Glib::RefPtr<Gio::File>& file)
+{
+    showFile(file, setupDataSource(file));
+}
+
+void
+VarselList::showFile(const Glib::RefPtr<Gio::File>& file, const std::shared_ptr<DataSource>& data)
 {
     auto info = file->query_info("*");
     m_searchText->set_entry_text(file->get_path());
     set_title(info->get_display_name());
-    m_data = setupDataSource(file);
+    m_data = data;
     if (m_treeView->get_columns().size() == 0) {
         m_treeView->append_column(_("Name"), m_data->m_treeColumns->m_name);
+        m_data->appendTreeColumns(m_treeView.get());
     }
     m_refTreeModel = m_data->createTree();
     // create individual config instances so wo keep the interference to a minimum (but some might be inevitable, if multiple instances exist, the last saved wins)
@@ -95,6 +102,8 @@ VarselList::showFile(const Glib::RefPtr<Gio::File>& file)
     m_treeView->expand_all();
     m_treeView->get_selection()->signal_changed().connect(
             sigc::mem_fun(*this, &VarselList::updateList));
+    m_treeView->get_vadjustment()->signal_value_changed().connect(
+            sigc::mem_fun(*this, &VarselList::on_tree_scrolled));
 
     m_kfTableManager = std::make_shared<psc::ui::KeyfileTableManager>(m_data->getListColumns(), getKeyFile()->getConfig(), m_data->getConfigGroup());
     m_kfTableManager->setup(this);
@@ -125,18 +134,23 @@ VarselList::getKeyFile()
     return m_config;
 }
 
+ListApp*
+VarselList::getListApp()
+{
+    return m_listApp;
+}
+
 std::shared_ptr<DataSource>
 VarselList::setupDataSource(const Glib::RefPtr<Gio::File>& file)
 {
     std::shared_ptr<DataSource> ds;
-    auto gitDir = file->get_child(".git");  // wild guess identify or use git_repository_discover
     auto type = file->query_file_type();
     if (type == Gio::FileType::FILE_TYPE_REGULAR
      && ArchiveDataSource::can_handle(file)) {
         ds = std::make_shared<ArchiveDataSource>(m_listApp);
     }
     else if (type == Gio::FileType::FILE_TYPE_DIRECTORY
-          && gitDir->query_exists()) {
+          && !psc::git::RepositoryCache::getWorkdir(file->get_path()).empty()) {
         ds = std::make_shared<GitDataSource>(m_listApp);
     }
     else if (type == Gio::FileType::FILE_TYPE_DIRECTORY) {
@@ -166,10 +180,25 @@ VarselList::nodeAdded(const std::shared_ptr<BaseTreeNode>& baseTreeNode)
     }
 }
 
+void
+VarselList::listProgress(double fraction, const Glib::ustring& msg)
+{
+    // the entry shows the progress behind the text
+    if (fraction >= 0.0) {
+        m_searchText->set_progress_fraction(fraction);
+    }
+    else {
+        m_searchText->progress_pulse();
+    }
+    m_searchText->set_tooltip_text(msg);
+}
+
 void
 VarselList::listDone(Severity severity, const Glib::ustring& msg)
 {
     std::cout << "VarselList::listDone " << msg << std::endl;
+    m_searchText->set_progress_fraction(0.0);   // hides progress
+    m_searchText->set_tooltip_text("");
     //if (severity > Severity::Info) {
     showMessage(msg,
             severity == Severity::Warning
@@ -178,6 +207,17 @@ VarselList::listDone(Severity severity, const Glib::ustring& msg)
     //}
 }
 
+void
+VarselList::on_tree_scrolled()
+{
+    // ask for more if the last page gets visible
+    auto adj = m_treeView->get_vadjustment();
+    if (m_data
+     && adj->get_value() + 2.0 * adj->get_page_size() >= adj->get_upper()) {
+        m_data->requestMore();
+    }
+}
+
 void
 VarselList::updateList()
 {
@@ -485,6 +525,7 @@ VarselList::on_hide()
     config->setInteger(m_data->getConfigGroup(), PANED_POS, pos);
     m_kfTableManager->saveConfig(this);
     save_config();
+    m_data->close();
     Gtk::Window::on_hide();
 }
 
@@ -48,12 +48,16 @@ public:
         , ListApp* varselWin);
     void nodeAdded(const std::shared_ptr<BaseTreeNode>& baseTreeNode) override;
     void listDone(Severity severity, const Glib::ustring& msg) override;
+    void listProgress(double fraction, const Glib::ustring& msg) override;
     void showMessage(const Glib::ustring& msg, Gtk::MessageType msgType = Gtk::MessageType::MESSAGE_INFO);
 
     void showFile(const Glib::RefPtr<Gio::File>& file);
+    // use a specific data source for file
+    void showFile(const Glib::RefPtr<Gio::File>& file, const std::shared_ptr<DataSource>& data);
     //static constexpr auto ACTION_GROUP = "list";
     static constexpr auto PANED_POS{"panedPos"};
-    std::shared_ptr<VarselConfig> getKeyFile();
+    std::shared_ptr<VarselConfig> getKeyFile() override;
+    ListApp* getListApp();
     void save_config();
 
     static constexpr auto CLIPBOARD_URIS_CONTENT_TYPE{"text/uri-list"};
@@ -69,6 +73,7 @@ protected:
     void on_target_received(const Gtk::SelectionData& selection);
     void on_targets_received(const std::vector<Glib::ustring>& targets);
     void updateList();
+    void on_tree_scrolled();
     bool getSelection(GdkEventButton* event, std::vector<PtrEventItem>& items);
     void getClipboard(Gtk::SelectionData& data, guint type);
     void clearClipboard();
@@ -28,23 +28,27 @@ class TestArchivProvider
 : public ArchivFileProvider
 {
 public:
-    TestArchivProvider(const Glib::RefPtr<Gio::File>& dir)
+    TestArchivProvider(const Glib::RefPtr<Gio::File>& dir
+                     , const std::vector<std::string>& suffixes = {".cpp", ".hpp"})
     : ArchivFileProvider(dir, true)
+    , m_suffixes{suffixes}
     {
     }
     virtual ~TestArchivProvider() = default;
     virtual bool isFilterEntry(const Glib::RefPtr<Gio::File>& file) override
     {
-        if (file->get_basename().ends_with(".cpp")
-         || file->get_basename().ends_with(".hpp")) {
-            ++m_createEntries;
-            std::cout << "TestArchivProvider::isFilterEntry using " << file->get_path() << std::endl;
-            return true;
+        for (auto& suffix : m_suffixes) {
+            if (file->get_basename().ends_with(suffix)) {
+                ++m_createEntries;
+                std::cout << "TestArchivProvider::isFilterEntry using " << file->get_path() << std::endl;
+                return true;
+            }
         }
         return false;
     }
 
     int m_createEntries{0};
+    std::vector<std::string> m_suffixes;
 
 };
 
@@ -109,6 +113,187 @@ ArchivTest::readWrite()
     return true;
 }
 
+// pack a archive into a archive and read it without extracting
+bool
+ArchivTest::readNested()
+{
+    m_entries = 0;
+    m_final = 0;
+    auto dir = Gio::File::create_for_path("nested");
+    if (!dir->query_exists()) {
+        dir->make_directory();
+    }
+    auto inner = dir->get_child("inner.tgz");
+    Archiv archive_inner(inner);
+    archive_inner.addWriteFormat(ARCHIVE_COMPRESSION_GZIP);
+    archive_inner.addWriteFormat(ARCHIVE_FORMAT_TAR_PAX_RESTRICTED);
+    TestArchivProvider testArchivProvider{Gio::File::create_for_path("..")};
+    archive_inner.write(&testArchivProvider);
+
+    auto outer = Gio::File::create_for_path("outer.zip");
+    Archiv archive_outer(outer);
+    archive_outer.addWriteFormat(ARCHIVE_FORMAT_ZIP);
+    TestArchivProvider outerArchivProvider{dir, {".tgz"}};
+    archive_outer.write(&outerArchivProvider);
+    bool ret = true;
+    Archiv archive(outer);
+    std::vector<Glib::ustring> nested{"inner.tgz"};
+    archive.setNested(nested);
+    try {
+        archive.read(this);
+    }
+    catch (const ArchivException& exc) {
+        std::cout << exc.what() << std::endl;
+        ret = false;
+    }
+    inner->remove();
+    dir->remove();
+    outer->remove();
+    if (testArchivProvider.m_createEntries != m_entries
+     || m_entries != m_final) {
+        std::cout << "Nested created " << testArchivProvider.m_createEntries
+                  << " or the internal count " << m_entries
+                  << " and summary " << m_final
+                  << " do not match!" << std::endl;
+        return false;
+    }
+    return ret;
+}
+
+void
+ArchivTest::writeText(const Glib::RefPtr<Gio::File>& file, const std::string& text, guint64 modified)
+{
+    std::string etag;
+    file->replace_contents(text, "", etag, false, Gio::FileCreateFlags::FILE_CREATE_REPLACE_DESTINATION);
+    file->set_attribute_uint64(G_FILE_ATTRIBUTE_TIME_MODIFIED, modified, Gio::FileQueryInfoFlags::FILE_QUERY_INFO_NONE);
+}
+
+// write a archive, change the source and update only the changed files
+bool
+ArchivTest::update(int format, int expected)
+{
+    m_entries = 0;
+    m_final = 0;
+    auto dir = Gio::File::create_for_path("update");
+    if (!dir->query_exists()) {
+        dir->make_directory();
+    }
+    auto modified = static_cast<guint64>(Glib::DateTime::create_now_utc().to_unix()) - 3600l;
+    auto fileA = dir->get_child("a.txt");
+    writeText(fileA, "first", modified);
+    auto fileB = dir->get_child("b.txt");
+    writeText(fileB, "second", modified);
+    auto file = Gio::File::create_for_path(format == ARCHIVE_FORMAT_ZIP ? "update.zip" : "update.tar");
+    Archiv archive_write(file);
+    archive_write.addWriteFormat(format);
+    TestArchivProvider writeProvider{dir, {".txt"}};
+    archive_write.write(&writeProvider);
+
+    writeText(fileA, "first changed", modified + 60l);
+    auto fileC = dir->get_child("c.txt");
+    writeText(fileC, "third", modified);
+    bool ret = true;
+    try {
+        Archiv archive_update(file);
+        TestArchivProvider updateProvider{dir, {".txt"}};
+        archive_update.update(&updateProvider);
+
+        Archiv archive(file);
+        archive.read(this);
+    }
+    catch (const ArchivException& exc) {
+        std::cout << exc.what() << std::endl;
+        ret = false;
+    }
+    fileA->remove();
+    fileB->remove();
+    fileC->remove();
+    dir->remove();
+    file->remove();
+    if (m_entries != expected
+     || m_entries != m_final) {
+        std::cout << "Update expected " << expected
+                  << " the internal count " << m_entries
+                  << " and summary " << m_final
+                  << " do not match!" << std::endl;
+        return false;
+    }
+    return ret;
+}
+
+bool
+ArchivTest::updateTest()
+{
+    // tar appends the changed file, so it is listed twice
+    return update(ARCHIVE_FORMAT_TAR_PAX_RESTRICTED, 4)
+        && update(ARCHIVE_FORMAT_ZIP, 3);
+}
+
+void
+ArchivTest::removeAll(const Glib::RefPtr<Gio::File>& dir)
+{
+    auto entries = dir->enumerate_children(G_FILE_ATTRIBUTE_STANDARD_NAME "," G_FILE_ATTRIBUTE_STANDARD_TYPE
+                                         , Gio::FileQueryInfoFlags::FILE_QUERY_INFO_NOFOLLOW_SYMLINKS);
+    while (auto info = entries->next_file()) {
+        auto child = dir->get_child(info->get_name());
+        if (info->get_file_type() == Gio::FileType::FILE_TYPE_DIRECTORY) {
+            removeAll(child);
+        }
+        else {
+            child->remove();
+        }
+    }
+    entries->close();
+    dir->remove();
+}
+
+// two snapshots of the same tree, the second shall not add any chunk
+bool
+ArchivTest::snapshotTest()
+{
+    auto dir = Gio::File::create_for_path("snapshot");
+    if (!dir->query_exists()) {
+        dir->make_directory();
+    }
+    auto src = Gio::File::create_for_path("..");
+    auto first = dir->get_child("first.snap");
+    ArchivSnapshot snapshot_first(first);
+    TestArchivProvider firstProvider{src};
+    auto index = dir->get_child(ArchivSnapshot::INDEX_NAME);
+    bool ret = true;
+    try {
+        snapshot_first.write(&firstProvider);
+        auto indexSize = index->query_info(G_FILE_ATTRIBUTE_STANDARD_SIZE)->get_size();
+
+        auto second = dir->get_child("second.snap");
+        ArchivSnapshot snapshot_second(second);
+        TestArchivProvider secondProvider{src};
+        snapshot_second.write(&secondProvider);
+        if (indexSize != index->query_info(G_FILE_ATTRIBUTE_STANDARD_SIZE)->get_size()) {
+            std::cout << "Snapshot index grew for unchanged tree " << indexSize << std::endl;
+            ret = false;
+        }
+
+        m_entries = 0;
+        m_final = 0;
+        auto archiv = Archiv::create(second);
+        archiv->read(this);
+        if (secondProvider.m_createEntries != m_entries
+         || m_entries != m_final) {
+            std::cout << "Snapshot created " << secondProvider.m_createEntries
+                      << " or the internal count " << m_entries
+                      << " and summary " << m_final
+                      << " do not match!" << std::endl;
+            ret = false;
+        }
+    }
+    catch (const ArchivException& exc) {
+        std::cout << exc.what() << std::endl;
+        ret = false;
+    }
+    removeAll(dir);
+    return ret;
+}
 
 void
 ArchivTest::archivUpdate(const std::shared_ptr<ArchivEntry>& entry)
@@ -152,6 +337,15 @@ int main(int argc, char** argv)
     if (!archivTest.readWrite()) {
         return 2;
     }
+    if (!archivTest.readNested()) {
+        return 3;
+    }
+    if (!archivTest.updateTest()) {
+        return 4;
+    }
+    if (!archivTest.snapshotTest()) {
+        return 5;
+    }
 
     return 0;
 }
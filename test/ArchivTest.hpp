@@ -19,6 +19,7 @@
 #pragma once
 
 #include "Archiv.hpp"
+#include "ArchivSnapshot.hpp"
 
 
 class ArchivTest
@@ -31,10 +32,17 @@ public:
 
     bool readTest();
     bool readWrite();
+    bool readNested();
+    bool updateTest();
+    bool snapshotTest();
     bool testList();
     void archivUpdate(const std::shared_ptr<ArchivEntry>& entry) override;
     void archivDone(ArchivSummary archivSummary, const Glib::ustring& errMsg) override;
 private:
+    bool update(int format, int expected);
+    void removeAll(const Glib::RefPtr<Gio::File>& dir);
+    void writeText(const Glib::RefPtr<Gio::File>& file, const std::string& text, guint64 modified);
+
     int m_entries{0};
     int m_final{0};
 };
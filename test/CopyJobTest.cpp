@@ -0,0 +1,389 @@
+/* -*- Mode: c++; c-basic-offset: 4; tab-width: 4; coding: utf-8; -*-  */
+/*
+ * Copyright (C) 2025 RPf 
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// this is a check the output test
+
+#include <iostream>
+#include <glibmm.h>
+#include <giomm.h>
+#include <glib/gstdio.h>
+#include <unistd.h>
+#include <psc_i18n.hpp>
+
+#include "CopyMode.hpp"
+#include "CopyJobTest.hpp"
+
+CopyJobTest::CopyJobTest()
+: m_mainLoop{Glib::MainLoop::create(false)}
+, m_base{Gio::File::create_for_path("copytest")}
+, m_modified{static_cast<guint64>(Glib::DateTime::create_now_utc().to_unix()) - 3600l}
+{
+}
+
+bool
+CopyJobTest::run(const std::vector<Glib::RefPtr<Gio::File>>& sources
+               , const Glib::RefPtr<Gio::File>& dir
+               , bool move
+               , const Glib::ustring& modeId
+               , bool resume)
+{
+    m_items.clear();
+    m_failed = 0;
+    CopyJob copyJob(sources, dir, move, CopyMode::create(modeId), this);
+    copyJob.setResume(resume);
+    copyJob.start(2u);
+    m_mainLoop->run();      // until done, so the workers report
+    return m_failed == 0;
+}
+
+Glib::RefPtr<Gio::File>
+CopyJobTest::createDir(const Glib::RefPtr<Gio::File>& dir)
+{
+    if (!dir->query_exists()) {
+        dir->make_directory_with_parents();
+    }
+    return dir;
+}
+
+void
+CopyJobTest::removeAll(const Glib::RefPtr<Gio::File>& dir)
+{
+    if (dir->query_file_type(Gio::FileQueryInfoFlags::FILE_QUERY_INFO_NOFOLLOW_SYMLINKS) != Gio::FileType::FILE_TYPE_DIRECTORY) {
+        return;
+    }
+    auto entries = dir->enumerate_children(G_FILE_ATTRIBUTE_STANDARD_NAME "," G_FILE_ATTRIBUTE_STANDARD_TYPE
+                                         , Gio::FileQueryInfoFlags::FILE_QUERY_INFO_NOFOLLOW_SYMLINKS);
+    while (auto info = entries->next_file()) {
+        auto child = dir->get_child(info->get_name());
+        if (info->get_file_type() == Gio::FileType::FILE_TYPE_DIRECTORY) {
+            removeAll(child);
+        }
+        else {
+            child->remove();
+        }
+    }
+    entries->close();
+    dir->remove();
+}
+
+void
+CopyJobTest::writeText(const Glib::RefPtr<Gio::File>& file, const std::string& text, guint64 modified)
+{
+    std::string etag;
+    file->replace_contents(text, "", etag, false, Gio::FileCreateFlags::FILE_CREATE_REPLACE_DESTINATION);
+    file->set_attribute_uint64(G_FILE_ATTRIBUTE_TIME_MODIFIED, modified, Gio::FileQueryInfoFlags::FILE_QUERY_INFO_NONE);
+}
+
+std::string
+CopyJobTest::readText(const Glib::RefPtr<Gio::File>& file)
+{
+    return Glib::file_get_contents(file->get_path());
+}
+
+PtrCopyItem
+CopyJobTest::getItem(const Glib::RefPtr<Gio::File>& target)
+{
+    auto entry = m_items.find(target->get_path());
+    if (entry == m_items.end()) {
+        std::cout << "No item for " << target->get_path() << std::endl;
+        return PtrCopyItem();
+    }
+    return entry->second;
+}
+
+// a move on the same filesystem is a rename
+bool
+CopyJobTest::moveTest()
+{
+    auto src = createDir(m_base->get_child("src"));
+    auto dst = createDir(m_base->get_child("dst"));
+    auto file = src->get_child("m.txt");
+    writeText(file, "move", m_modified);
+    bool ret = run({file}, dst, true, "no");
+    auto target = dst->get_child("m.txt");
+    auto item = getItem(target);
+    if (!ret
+     || file->query_exists()
+     || readText(target) != "move"
+     || !item
+     || item->getStrategy() != CopyStrategy::Rename) {
+        std::cout << "Move did not rename " << target->get_path() << std::endl;
+        ret = false;
+    }
+    removeAll(m_base);
+    return ret;
+}
+
+// a directory that exists is merged, the source keeps what was not moved
+bool
+CopyJobTest::mergeTest()
+{
+    auto src = createDir(m_base->get_child("src/d"));
+    auto dst = createDir(m_base->get_child("dst/d"));
+    writeText(src->get_child("a.txt"), "a", m_modified);
+    writeText(src->get_child("b.txt"), "b new", m_modified);
+    writeText(dst->get_child("b.txt"), "b old", m_modified);
+    bool ret = run({src}, dst->get_parent(), true, "no");
+    auto item = getItem(dst->get_child("b.txt"));
+    if (!ret
+     || readText(dst->get_child("a.txt")) != "a"
+     || src->get_child("a.txt")->query_exists()
+     || readText(dst->get_child("b.txt")) != "b old"
+     || readText(src->get_child("b.txt")) != "b new"
+     || !item
+     || item->getState() != CopyState::Skipped) {
+        std::cout << "Merge did not keep the skipped source " << src->get_path() << std::endl;
+        ret = false;
+    }
+    removeAll(m_base);
+    return ret;
+}
+
+// between filesystems a move is a copy, and the source is removed when verified
+bool
+CopyJobTest::crossDeviceTest()
+{
+    auto shm = Gio::File::create_for_path("/dev/shm");
+    auto src = createDir(m_base->get_child("src"));
+    if (!shm->query_exists()
+     || CopyJob::isSameDevice(src, shm)) {
+        std::cout << "Cross device skipped, no other filesystem" << std::endl;
+        removeAll(m_base);
+        return true;
+    }
+    auto dst = createDir(shm->get_child(Glib::ustring::sprintf("va_copytest-%d", getpid())));
+    auto file = src->get_child("x.txt");
+    writeText(file, "cross", m_modified);
+    bool ret = run({file}, dst, true, "no");
+    auto target = dst->get_child("x.txt");
+    auto item = getItem(target);
+    if (!ret
+     || file->query_exists()
+     || readText(target) != "cross"
+     || !item
+     || item->getState() != CopyState::Moved
+     || item->getStrategy() == CopyStrategy::Rename) {
+        std::cout << "Cross device move failed " << target->get_path() << std::endl;
+        ret = false;
+    }
+    removeAll(dst);
+    removeAll(m_base);
+    return ret;
+}
+
+// the files of a hardlink group shall stay linked
+bool
+CopyJobTest::hardlinkTest()
+{
+    auto src = createDir(m_base->get_child("src/h"));
+    auto dst = createDir(m_base->get_child("dst"));
+    auto one = src->get_child("one.txt");
+    writeText(one, "linked", m_modified);
+    auto two = src->get_child("two.txt");
+    if (link(one->get_path().c_str(), two->get_path().c_str()) != 0) {
+        std::cout << "Hardlink skipped, not supported" << std::endl;
+        removeAll(m_base);
+        return true;
+    }
+    bool ret = run({src}, dst, false, "no");
+    GStatBuf statOne;
+    GStatBuf statTwo;
+    if (!ret
+     || g_lstat(dst->get_child("h/one.txt")->get_path().c_str(), &statOne) != 0
+     || g_lstat(dst->get_child("h/two.txt")->get_path().c_str(), &statTwo) != 0
+     || statOne.st_ino != statTwo.st_ino
+     || readText(dst->get_child("h/two.txt")) != "linked") {
+        std::cout << "Hardlink not kept " << dst->get_path() << std::endl;
+        ret = false;
+    }
+    removeAll(m_base);
+    return ret;
+}
+
+// a target that links to the source is replaced, not written through
+bool
+CopyJobTest::symlinkTest()
+{
+    auto src = createDir(m_base->get_child("src"));
+    auto dst = createDir(m_base->get_child("dst"));
+    auto file = src->get_child("s.txt");
+    writeText(file, "source", m_modified);
+    auto target = dst->get_child("s.txt");
+    target->make_symbolic_link(file->get_path());
+    bool ret = run({file}, dst, false, "all");
+    if (!ret
+     || readText(file) != "source"
+     || target->query_file_type(Gio::FileQueryInfoFlags::FILE_QUERY_INFO_NOFOLLOW_SYMLINKS) != Gio::FileType::FILE_TYPE_REGULAR
+     || readText(target) != "source") {
+        std::cout << "Symlink target not replaced " << target->get_path() << std::endl;
+        ret = false;
+    }
+    removeAll(m_base);
+    return ret;
+}
+
+// only the changed block is written, a hard linked target is replaced
+bool
+CopyJobTest::deltaTest()
+{
+    auto src = createDir(m_base->get_child("src"));
+    auto dst = createDir(m_base->get_child("dst"));
+    std::string content(3u * CopyWorker::DELTA_BLOCK + 100u, '\0');
+    for (size_t i = 0; i < content.size(); ++i) {
+        content[i] = static_cast<char>(i % 251u);
+    }
+    auto file = src->get_child("big.bin");
+    writeText(file, content, m_modified);
+    bool ret = run({file}, dst, false, "no");
+    content[CopyWorker::DELTA_BLOCK + 10u] ^= 0x55;
+    writeText(file, content, m_modified + 60l);
+    ret = ret && run({file}, dst, false, "delta");
+    auto target = dst->get_child("big.bin");
+    auto item = getItem(target);
+    auto expected = Glib::ustring::sprintf(_("%s written"), Glib::format_size(CopyWorker::DELTA_BLOCK));
+    if (!ret
+     || readText(target) != content
+     || !item
+     || item->getStrategy() != CopyStrategy::Delta
+     || item->getMessage() != expected) {
+        std::cout << "Delta did not update " << target->get_path()
+                  << " " << (item ? item->getMessage() : Glib::ustring()) << std::endl;
+        ret = false;
+    }
+    // a hard linked target is replaced, so the other name keeps its content
+    auto linked = dst->get_child("big.link");
+    if (ret
+     && link(target->get_path().c_str(), linked->get_path().c_str()) != 0) {
+        std::cout << "Unable to link " << linked->get_path() << std::endl;
+        ret = false;
+    }
+    auto previous = content;
+    content[10u] ^= 0x55;
+    writeText(file, content, m_modified + 120l);
+    ret = ret && run({file}, dst, false, "delta");
+    item = getItem(target);
+    if (!ret
+     || readText(target) != content
+     || readText(linked) != previous
+     || !item
+     || item->getStrategy() == CopyStrategy::Delta) {
+        std::cout << "Delta changed hard link " << linked->get_path() << std::endl;
+        ret = false;
+    }
+    removeAll(m_base);
+    return ret;
+}
+
+// a target that was in flight is completed, even if the mode keeps existing targets
+bool
+CopyJobTest::resumeTest()
+{
+    auto src = createDir(m_base->get_child("src"));
+    auto dst = createDir(m_base->get_child("dst"));
+    std::string content(2u * CopyWorker::DELTA_BLOCK, 'r');
+    auto file = src->get_child("r.txt");
+    writeText(file, content, m_modified);
+    auto target = dst->get_child("r.txt");
+    writeText(target, content.substr(0, CopyWorker::DELTA_BLOCK), m_modified + 60l);
+    auto part = dst->get_child(std::string(".r.txt") + CopyItem::PART_SUFFIX);
+    writeText(part, "", m_modified);
+    bool ret = run({file}, dst, false, "no", true);
+    if (!ret
+     || readText(target) != content
+     || part->query_exists()) {
+        std::cout << "Resume did not complete " << target->get_path() << std::endl;
+        ret = false;
+    }
+    removeAll(m_base);
+    return ret;
+}
+
+void
+CopyJobTest::copyItems(const std::vector<PtrCopyItem>& items)
+{
+    for (auto& item : items) {
+        m_items.insert_or_assign(item->getTarget()->get_path(), item);
+        std::cout << "item " << item->getTarget()->get_path()
+                  << " state " << static_cast<int>(item->getState())
+                  << " strategy " << CopyWorker::getStrategyName(item->getStrategy())
+                  << " " << item->getMessage() << std::endl;
+    }
+}
+
+void
+CopyJobTest::copyProgress(const CopyProgress& progress)
+{
+}
+
+void
+CopyJobTest::copyConflicts(const std::vector<PtrCopyItem>& items)
+{
+    std::cout << "Unexpected conflicts " << items.size() << std::endl;
+}
+
+bool
+CopyJobTest::copyFailed(const PtrCopyItem& item)
+{
+    ++m_failed;
+    std::cout << "Failed " << item->getTarget()->get_path()
+              << " " << item->getMessage() << std::endl;
+    return true;
+}
+
+void
+CopyJobTest::copyDone(const Glib::ustring& msg)
+{
+    if (!msg.empty()) {
+        std::cout << "Error " << msg << "!!!" << std::endl;
+        ++m_failed;
+    }
+    m_mainLoop->quit();
+}
+
+
+int main(int argc, char** argv)
+{
+    std::setlocale(LC_ALL, "");      // make locale dependent, and make glib accept u8 const !!!
+    Glib::init();
+    Gio::init();
+
+    CopyJobTest copyJobTest;
+    if (!copyJobTest.moveTest()) {
+        return 1;
+    }
+    if (!copyJobTest.mergeTest()) {
+        return 2;
+    }
+    if (!copyJobTest.crossDeviceTest()) {
+        return 3;
+    }
+    if (!copyJobTest.hardlinkTest()) {
+        return 4;
+    }
+    if (!copyJobTest.symlinkTest()) {
+        return 5;
+    }
+    if (!copyJobTest.deltaTest()) {
+        return 6;
+    }
+    if (!copyJobTest.resumeTest()) {
+        return 7;
+    }
+
+    return 0;
+}
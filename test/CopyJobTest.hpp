@@ -0,0 +1,70 @@
+/* -*- Mode: c++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * Copyright (C) 2025 RPf 
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <glibmm.h>
+#include <giomm.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "CopyJob.hpp"
+
+class CopyJobTest
+: public CopyListener
+{
+public:
+    CopyJobTest();
+    explicit CopyJobTest(const CopyJobTest& orig) = delete;
+    virtual ~CopyJobTest() = default;
+
+    bool moveTest();
+    bool mergeTest();
+    bool crossDeviceTest();
+    bool hardlinkTest();
+    bool symlinkTest();
+    bool deltaTest();
+    bool resumeTest();
+
+    void copyItems(const std::vector<PtrCopyItem>& items) override;
+    void copyProgress(const CopyProgress& progress) override;
+    void copyConflicts(const std::vector<PtrCopyItem>& items) override;
+    bool copyFailed(const PtrCopyItem& item) override;
+    void copyDone(const Glib::ustring& msg) override;
+protected:
+    // run a job until done, @return false if any item failed
+    bool run(const std::vector<Glib::RefPtr<Gio::File>>& sources
+           , const Glib::RefPtr<Gio::File>& dir
+           , bool move
+           , const Glib::ustring& modeId
+           , bool resume = false);
+    Glib::RefPtr<Gio::File> createDir(const Glib::RefPtr<Gio::File>& dir);
+    void removeAll(const Glib::RefPtr<Gio::File>& dir);
+    void writeText(const Glib::RefPtr<Gio::File>& file, const std::string& text, guint64 modified);
+    std::string readText(const Glib::RefPtr<Gio::File>& file);
+    PtrCopyItem getItem(const Glib::RefPtr<Gio::File>& target);
+
+private:
+    Glib::RefPtr<Glib::MainLoop> m_mainLoop;
+    Glib::RefPtr<Gio::File> m_base;
+    std::map<std::string, PtrCopyItem> m_items;     // by target path
+    size_t m_failed{0};
+    guint64 m_modified;
+};
+
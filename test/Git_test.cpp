@@ -21,10 +21,12 @@
 #include <cstdlib>
 #include <cstring>
 #include <cmath>
+#include <filesystem>
 #include <git2.h>
 #include <giomm.h>
 
 #include "GitRepository.hpp"
+#include "GitStatusMonitor.hpp"
 #include "Git_test.hpp"
 #include "varsel_config.h"
 
@@ -84,6 +86,195 @@ Git_test::test_something()
     return true;
 }
 
+bool
+Git_test::treeCpp()
+{
+    std::cout << "Git_test::treeCpp ----------" << std::endl;
+    try {
+        psc::git::Repository repo(TOPSRCDIR);
+        auto tree = repo.resolveTree("HEAD");
+        auto entries = repo.getTreeEntries(tree);
+        for (auto& entry : entries) {
+            if (entry.name == "meson.build"
+             && entry.type == GIT_OBJECT_BLOB) {
+                auto content = repo.readBlob(entry.oid);
+                std::cout << "meson.build " << content.size() << " bytes from HEAD" << std::endl;
+                return !content.empty();
+            }
+        }
+        std::cout << "No meson.build in HEAD tree with " << entries.size() << " entries" << std::endl;
+    }
+    catch (const psc::git::GitException& exc) {
+        std::cout << "Error " << exc.what() << std::endl;
+    }
+    return false;
+}
+
+bool
+Git_test::cacheCpp()
+{
+    std::cout << "Git_test::cacheCpp ----------" << std::endl;
+    // a subdirectory has to find the same repository
+    auto repository = psc::git::RepositoryCache::get(TOPSRCDIR);
+    auto subRepository = psc::git::RepositoryCache::get(std::string(TOPSRCDIR) + "/srcList");
+    if (!repository || repository != subRepository) {
+        std::cout << "Expected shared repository for " << TOPSRCDIR << std::endl;
+        return false;
+    }
+    auto workdir = psc::git::RepositoryCache::getWorkdir(std::string(TOPSRCDIR) + "/test");
+    std::cout << "Workdir " << workdir << std::endl;
+    return workdir == repository->getWorkdir();
+}
+
+// counts the progress, cancels after cancelAfter calls if set
+class TestFetchListener
+: public psc::git::FetchListener
+{
+public:
+    int fetchProgress(const git_indexer_progress *stats) override
+    {
+        ++calls;
+        return (cancelAfter > 0 && calls >= cancelAfter) ? -1 : 0;
+    }
+    int calls{0};
+    int cancelAfter{0};
+};
+
+bool
+Git_test::cloneCpp()
+{
+    std::cout << "Git_test::cloneCpp ----------" << std::endl;
+    auto tmp = Glib::build_filename(Glib::get_tmp_dir(), "varsel-clone-test");
+    std::filesystem::remove_all(tmp);
+    auto url = "file://" + std::string(TOPSRCDIR);
+    bool ret{true};
+    try {
+        TestFetchListener listener;
+        psc::git::Repository repo(Glib::build_filename(tmp, "clone"), false);
+        repo.setFetchListener(&listener);
+        repo.clone(url);
+        std::cout << "Cloned " << url << " progress calls " << listener.calls
+                  << " head " << repo.getHeadId() << std::endl;
+        ret = !repo.getHeadId().empty();
+    }
+    catch (const psc::git::GitException& exc) {
+        std::cout << "Error " << exc.what() << std::endl;
+        ret = false;
+    }
+    if (ret) {
+        TestFetchListener listener;
+        listener.cancelAfter = 1;
+        auto canceled = Glib::build_filename(tmp, "canceled");
+        try {
+            psc::git::Repository repo(canceled, false);
+            repo.setFetchListener(&listener);
+            repo.clone(url);
+            std::cout << "Clone not canceled progress calls " << listener.calls << std::endl;
+            ret = false;
+        }
+        catch (const psc::git::GitException& exc) {
+            // libgit2 reports the value returned by our callback
+            std::string msg{exc.what()};
+            std::cout << "Canceled " << msg << " progress calls " << listener.calls << std::endl;
+            ret = listener.calls >= 1
+               && msg.find("callback returned -1") != std::string::npos;
+        }
+        // the incomplete clone must not be usable
+        if (git_repository_open_ext(nullptr, canceled.c_str(), GIT_REPOSITORY_OPEN_NO_SEARCH, nullptr) == 0) {
+            std::cout << "Canceled clone left a repository " << canceled << std::endl;
+            ret = false;
+        }
+    }
+    std::filesystem::remove_all(tmp);
+    return ret;
+}
+
+// remembers the reported paths, quits the loop when the expected path was reported
+class TestMonitorListener
+: public psc::git::StatusMonitorListener
+{
+public:
+    TestMonitorListener(const Glib::RefPtr<Glib::MainLoop>& mainLoop, const std::string& expected)
+    : m_mainLoop{mainLoop}
+    , m_expected{expected}
+    {
+    }
+    void statusChanged(const std::string& path, psc::git::File& file) override
+    {
+        std::cout << "Changed " << path << " " << file.getWorkdir().to_string() << std::endl;
+        changed.insert(path);
+        if (path == m_expected) {
+            m_mainLoop->quit();
+        }
+    }
+    void statusRemoved(const std::string& path) override
+    {
+        std::cout << "Removed " << path << std::endl;
+    }
+    void statusReset() override
+    {
+        ++resets;
+    }
+    void statusDegraded(const std::string& reason) override
+    {
+        std::cout << "Degraded " << reason << std::endl;
+    }
+    std::set<std::string> changed;
+    int resets{0};
+private:
+    Glib::RefPtr<Glib::MainLoop> m_mainLoop;
+    std::string m_expected;
+};
+
+bool
+Git_test::monitorCpp()
+{
+    std::cout << "Git_test::monitorCpp ----------" << std::endl;
+    auto tmp = Glib::build_filename(Glib::get_tmp_dir(), "varsel-monitor-test");
+    std::filesystem::remove_all(tmp);
+    git_repository* gitRepo{nullptr};
+    if (git_repository_init(&gitRepo, tmp.c_str(), 0) != 0) {
+        std::cout << "Unable to init " << tmp << std::endl;
+        return false;
+    }
+    git_repository_free(gitRepo);
+    bool ret{true};
+    try {
+        auto mainLoop = Glib::MainLoop::create(false);
+        TestMonitorListener listener(mainLoop, "changed.txt");
+        psc::git::StatusMonitor monitor(tmp, psc::git::StatusOptions());
+        monitor.setListener(&listener);
+        monitor.start();
+        // wait for the watches (added in background) before changing
+        Glib::signal_timeout().connect_once(
+            [&tmp] {
+                Glib::file_set_contents(Glib::build_filename(tmp, "changed.txt"), "changed");
+            }, 500);
+        auto timeout = Glib::signal_timeout().connect_seconds(
+            [&mainLoop] {
+                mainLoop->quit();
+                return false;
+            }, 10);
+        mainLoop->run();
+        timeout.disconnect();
+        monitor.stop();
+        ret = listener.changed.contains("changed.txt")
+           && listener.resets == 0;
+        std::cout << "Changes " << listener.changed.size() << " resets " << listener.resets << std::endl;
+    }
+    catch (const Glib::Error& err) {
+        std::cout << "Error " << err.what() << std::endl;
+        ret = false;
+    }
+    catch (const psc::git::GitException& exc) {
+        std::cout << "Error " << exc.what() << std::endl;
+        ret = false;
+    }
+    psc::git::RepositoryCache::clear();
+    std::filesystem::remove_all(tmp);
+    return ret;
+}
+
 int main(int argc, char** argv)
 {
     std::setlocale(LC_ALL, "");      // make locale dependent, and make glib accept u8 const !!!
@@ -95,6 +286,18 @@ int main(int argc, char** argv)
     if (!git_test.test_something()) {
         return 3;
     }
+    if (!git_test.treeCpp()) {
+        return 4;
+    }
+    if (!git_test.cacheCpp()) {
+        return 5;
+    }
+    if (!git_test.cloneCpp()) {
+        return 6;
+    }
+    if (!git_test.monitorCpp()) {
+        return 7;
+    }
 
 
     return 0;
@@ -27,6 +27,10 @@ public:
 
     bool reposCpp();
     bool test_something();
+    bool treeCpp();
+    bool cacheCpp();
+    bool cloneCpp();
+    bool monitorCpp();
 private:
 
 };